@@ -178,6 +178,7 @@ public:
    void setData(void *inData, int inElements)
    {
       mBase = (char *)inData;
+      mOffset = 0;
       length = inElements;
       mAlloc = inElements;
       HX_OBJ_WB_PESSIMISTIC_GET(this);
@@ -186,6 +187,7 @@ public:
    void setUnmanagedData(void *inData, int inElements)
    {
       mBase = (char *)inData;
+      mOffset = 0;
       length = inElements;
       mAlloc = -1;
    }
@@ -230,6 +232,7 @@ public:
    inline void __unsafeStringReference(String inString)
    {
       mBase = (char *)inString.raw_ptr();
+      mOffset = 0;
       length = inString.length / GetElementSize();
       mAlloc = length;
       HX_OBJ_WB_PESSIMISTIC_GET(this);
@@ -311,6 +314,9 @@ public:
 
    void Realloc(int inLen) const;
 
+   // Move the elements back to the start of the allocation
+   void ResetOffset() const;
+
    inline void EnsureSize(int inLen) const
    {
       if (inLen>length)
@@ -365,7 +371,11 @@ public:
    static inline int lengthOffset() { return (int)offsetof(ArrayBase,length); }
 
 protected:
+   // Elements available from mBase
    mutable int mAlloc;
+   // Bytes between the start of the allocation and mBase - shift() moves mBase forward
+   //  rather than moving the elements, and unshift() reuses the space.
+   mutable int mOffset;
    mutable char  *mBase;
 };
 
@@ -440,6 +450,7 @@ template<> struct ArrayClassId< ::cpp::Int64> { enum { id=hx::clsIdArrayInt64 };
 
 // sort...
 #include <algorithm>
+#include <vector>
 
 namespace hx
 {
@@ -450,6 +461,139 @@ template<>
 inline bool arrayElemEq<Dynamic>(const Dynamic &a, const Dynamic &b) {
    return hx::DynamicEq(a,b);
 }
+
+// LSD radix sorts for numeric arrays - stable, and no comparisons at all
+HXCPP_EXTERN_CLASS_ATTRIBUTES void ArrayRadixSort(int *ioData, int inLength, bool inDescending);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void ArrayRadixSort(::cpp::Int64 *ioData, int inLength, bool inDescending);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void ArrayRadixSort(float *ioData, int inLength, bool inDescending);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void ArrayRadixSort(double *ioData, int inLength, bool inDescending);
+
+enum { RADIX_SORT_MIN = 256, PARALLEL_SORT_MIN = 1<<16 };
+
+template<typename T>
+inline bool TryRadixSort(T *ioData, int inLength, bool inDescending) { return false; }
+#define HX_ARRAY_RADIX_SORT(T) \
+inline bool TryRadixSort(T *ioData, int inLength, bool inDescending) \
+{ \
+   if (inLength<RADIX_SORT_MIN) return false; \
+   ArrayRadixSort(ioData, inLength, inDescending); \
+   return true; \
+}
+HX_ARRAY_RADIX_SORT(int)
+HX_ARRAY_RADIX_SORT(::cpp::Int64)
+HX_ARRAY_RADIX_SORT(float)
+HX_ARRAY_RADIX_SORT(double)
+#undef HX_ARRAY_RADIX_SORT
+
+// Calls inTask(inContext, i) for i in 0...inTasks, spread over up to inThreads threads
+//  including the caller.  The helper threads are registered with the GC for the duration.
+// If a task throws, no more tasks are started, and the first exception is rethrown on the
+//  caller once every helper has stopped.
+HXCPP_EXTERN_CLASS_ATTRIBUTES void ParallelFor(int inTasks, void (*inTask)(void *,int), void *inContext, int inThreads);
+HXCPP_EXTERN_CLASS_ATTRIBUTES int ParallelSortThreads();
+
+// Merge sort of plain-data elements: chunks are sorted on separate threads, then merged in pairs.
+// Works on a copy outside the GC heap, so the comparator may allocate (and a moving GC can run).
+template<typename T, typename LESS>
+struct ParallelSorter
+{
+   T    *data;
+   T    *buffer;
+   int  length;
+   int  chunks;
+   int  width;
+   LESS less;
+
+   ParallelSorter(LESS inLess) : data(0), buffer(0), less(inLess) { }
+   ~ParallelSorter()
+   {
+      free(data);
+      free(buffer);
+   }
+
+   static void sortChunk(void *inSorter, int inChunk)
+   {
+      ParallelSorter *s = (ParallelSorter *)inSorter;
+      int begin = (int)((long long)s->length*inChunk/s->chunks);
+      int end = (int)((long long)s->length*(inChunk+1)/s->chunks);
+      std::stable_sort(s->data + begin, s->data + end, s->less);
+   }
+
+   static void mergePair(void *inSorter, int inPair)
+   {
+      ParallelSorter *s = (ParallelSorter *)inSorter;
+      int first = inPair*s->width*2;
+      int begin = (int)((long long)s->length*first/s->chunks);
+      int mid = (int)((long long)s->length*std::min(first+s->width,s->chunks)/s->chunks);
+      int end = (int)((long long)s->length*std::min(first+s->width*2,s->chunks)/s->chunks);
+      std::merge(s->data+begin, s->data+mid, s->data+mid, s->data+end, s->buffer+begin, s->less);
+   }
+
+   void sort(T *ioData, int inLength)
+   {
+      int threads = ParallelSortThreads();
+      chunks = 1;
+      while(chunks<threads && chunks<16)
+         chunks<<=1;
+      length = inLength;
+      data = (T *)malloc(sizeof(T)*inLength);
+      buffer = (T *)malloc(sizeof(T)*inLength);
+      if (chunks<2 || !data || !buffer)
+      {
+         std::stable_sort(ioData, ioData+inLength, less);
+         return;
+      }
+      // If the comparator throws, ioData is left as it was and the destructor frees the copies
+      memcpy(data, ioData, sizeof(T)*inLength);
+      ParallelFor(chunks, sortChunk, this, threads);
+      for(width=1; width<chunks; width*=2)
+      {
+         ParallelFor(chunks/(width*2), mergePair, this, threads);
+         std::swap(data,buffer);
+      }
+      memcpy(ioData, data, sizeof(T)*inLength);
+   }
+};
+
+template<typename T, typename LESS>
+struct IndexLess
+{
+   const T *data;
+   LESS    less;
+   IndexLess(const T *inData, LESS inLess) : data(inData), less(inLess) { }
+   inline bool operator()(int inA, int inB) const { return less(data[inA],data[inB]); }
+};
+
+// Stable sort that keeps references where the GC can see them: the indices are sorted,
+//  then the elements are swapped into place within the array.
+template<typename T, typename LESS>
+void IndexStableSort(T *ioData, int inLength, LESS inLess)
+{
+   std::vector<int> index(inLength);
+   for(int i=0;i<inLength;i++)
+      index[i] = i;
+   std::stable_sort(index.begin(), index.end(), IndexLess<T,LESS>(ioData,inLess));
+   for(int i=0;i<inLength;i++)
+   {
+      int from = index[i];
+      while(from < i)
+         from = index[from];
+      if (from!=i)
+      {
+         std::swap(ioData[i],ioData[from]);
+         index[i] = from;
+      }
+   }
+}
+
+// Adapts a native comparator returning <0, 0, >0 (eg, a cpp.Callable) to a "less" predicate
+template<typename T, typename COMPARE>
+struct NativeLess
+{
+   mutable COMPARE compare;
+   NativeLess(COMPARE inCompare) : compare(inCompare) { }
+   inline bool operator()(const T &inA, const T &inB) const { return compare(inA,inB) < 0; }
+};
 }
 
 
@@ -543,18 +687,36 @@ public:
 
    void __Mark(hx::MarkContext *__inCtx)
    {
-      if (mAlloc>0) hx::MarkAlloc((void *)mBase, __inCtx );
+      #ifdef HXCPP_GC_CONCURRENT
+      // May be marked while another thread grows the array - the buffer is replaced before
+      //  the length increases, so read the length first.  mOffset is always 0 in this mode.
+      int len = *(volatile int *)&length;
+      char *base = *(char * volatile *)&mBase;
+      if (mAlloc>0) hx::MarkAlloc((void *)base, __inCtx );
+      if (len && hx::ContainsPointers<ELEM_>())
+      {
+         ELEM_ *ptr = (ELEM_ *)base;
+         HX_MARK_MEMBER_ARRAY(ptr,len);
+      }
+      #else
+      if (mAlloc>0) hx::MarkAlloc((void *)(mBase - mOffset), __inCtx );
       if (length && hx::ContainsPointers<ELEM_>())
       {
          ELEM_ *ptr = (ELEM_ *)mBase;
          HX_MARK_MEMBER_ARRAY(ptr,length);
       }
+      #endif
    }
 
    #ifdef HXCPP_VISIT_ALLOCS
    void __Visit(hx::VisitContext *__inCtx)
    {
-      if (mAlloc>0) __inCtx->visitAlloc((void **)&mBase);
+      if (mAlloc>0)
+      {
+         char *alloc = mBase - mOffset;
+         __inCtx->visitAlloc((void **)&alloc);
+         mBase = alloc + mOffset;
+      }
       if (hx::ContainsPointers<ELEM_>())
       {
          ELEM_ *ptr = (ELEM_ *)mBase;
@@ -760,17 +922,34 @@ public:
       }
    }
 
-   // Will do random pointer sorting for object pointers
+   // Will do random pointer sorting for object pointers.  Numeric arrays use a radix sort.
    inline void sortAscending()
    {
       ELEM_ *e = (ELEM_ *)mBase;
-      std::sort(e, e+length);
+      if (!hx::TryRadixSort(e, length, false))
+         std::sort(e, e+length);
    }
    static inline bool greaterThan(const ELEM_ &inA, const ELEM_ &inB) { return inB < inA; }
    inline void sortDescending()
    {
       ELEM_ *e = (ELEM_ *)mBase;
-      std::sort(e, e+length, greaterThan);
+      if (!hx::TryRadixSort(e, length, true))
+         std::sort(e, e+length, greaterThan);
+   }
+
+   // Sort with a native comparator, such as a cpp.Callable, without going through Dynamic.
+   // Large plain-data arrays are sorted on several threads, which call the comparator too.
+   template<typename COMPARE>
+   void sortNative(COMPARE inCompare)
+   {
+      ELEM_ *e = (ELEM_ *)mBase;
+      hx::NativeLess<ELEM_,COMPARE> less(inCompare);
+      if (hx::ContainsPointers<ELEM_>())
+         hx::IndexStableSort(e, length, less);
+      else if (length>=hx::PARALLEL_SORT_MIN)
+         hx::ParallelSorter<ELEM_, hx::NativeLess<ELEM_,COMPARE> >(less).sort(e, length);
+      else
+         std::stable_sort(e, e+length, less);
    }
 
 
@@ -1167,6 +1346,24 @@ inline typename ARRAY::Elem _hx_array_unsafe_get(ARRAY inArray, int inIndex)
    return inArray->__unsafe_get(inIndex);
 }
 
+template<typename ARRAY>
+inline void _hx_array_sort_ascending(ARRAY inArray)
+{
+   inArray->sortAscending();
+}
+
+template<typename ARRAY>
+inline void _hx_array_sort_descending(ARRAY inArray)
+{
+   inArray->sortDescending();
+}
+
+template<typename ARRAY,typename COMPARE>
+inline void _hx_array_sort_native(ARRAY inArray, COMPARE inCompare)
+{
+   inArray->sortNative(inCompare);
+}
+
 
 
 // Include again, for functions that required Array definition
@@ -93,6 +93,7 @@ public:
       return (VariantKey *)(this + 1);
    }
    inline int findFixed(const ::String &inKey,bool inSkip5 = false);
+   inline int findCached(const ::String &inKey,int inSlot);
 
 
 
@@ -120,6 +121,11 @@ public:
    virtual void __GetFields(Array<String> &outFields);
    Dynamic *__GetFieldMap() { return &mFields; }
 
+   // Used by hx::FieldCache - ioSlot is the fixed slot where inString was last
+   //  found, which is checked before searching.  It is updated on a hit.
+   hx::Val __CachedField(const String &inString, int &ioSlot);
+   hx::Val __CachedSetField(const String &inString,const hx::Val &inValue, int &ioSlot);
+
    virtual int __GetType() const { return vtObject; }
 
    hx::Anon_obj *Add(const String &inName,const Dynamic &inValue,bool inSetThisPointer=true);
@@ -148,6 +154,39 @@ Anon SourceInfo(String inFile, int inLine, String inClass, String inMethod);
 HXCPP_EXTERN_CLASS_ATTRIBUTES String StringFromAnonFields(hx::Object *inPtr);
 
 
+// --- hx::FieldCache ---------------------------------------------
+//
+// One-entry inline cache for a dynamic field access site.  The first access
+//  remembers where the field was found - the fixed slot of an anonymous object,
+//  or the storage offset of a member for a given class - and later accesses to
+//  objects with the same layout go straight there, without comparing names.
+// Anything the cache can not describe falls back to __Field/__SetField.
+// A cache must only ever be used with a single field name.
+
+struct FieldCacheMember;
+
+struct FieldCache
+{
+   int              anonSlot;
+   int              misses;
+   FieldCacheMember *member;
+};
+
+#define HX_FIELD_CACHE_INIT { -1, 0, 0 }
+
+HXCPP_EXTERN_CLASS_ATTRIBUTES
+hx::Val FieldCacheGet(FieldCache &ioCache, hx::Object *inObj, const String &inName, hx::PropertyAccess inCallProp);
+HXCPP_EXTERN_CLASS_ATTRIBUTES
+hx::Val FieldCacheSet(FieldCache &ioCache, hx::Object *inObj, const String &inName, const hx::Val &inValue, hx::PropertyAccess inCallProp);
+
+// Generated code declares a cache per access site, eg:
+//   HX_FIELD_CACHE(_hx_fc0)
+//   ::Dynamic x = HX_FIELD_CACHE_GET(_hx_fc0, obj, HX_CSTRING("x"), ::hx::paccDynamic);
+#define HX_FIELD_CACHE(cache) static ::hx::FieldCache cache = HX_FIELD_CACHE_INIT;
+#define HX_FIELD_CACHE_GET(cache,obj,name,prop) ::hx::FieldCacheGet(cache,(obj).mPtr,name,prop)
+#define HX_FIELD_CACHE_SET(cache,obj,name,value,prop) ::hx::FieldCacheSet(cache,(obj).mPtr,name,value,prop)
+
+
 template<typename _hx_T0>
 class AnonStruct1_obj : public hx::Object
 {
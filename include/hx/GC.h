@@ -41,7 +41,13 @@ HXCPP_EXTERN_CLASS_ATTRIBUTES void  __hxcpp_spam_collects(int inEveryNCalls);
 HXCPP_EXTERN_CLASS_ATTRIBUTES void  __hxcpp_set_minimum_working_memory(int inBytes);
 HXCPP_EXTERN_CLASS_ATTRIBUTES void  __hxcpp_set_minimum_free_space(int inBytes);
 HXCPP_EXTERN_CLASS_ATTRIBUTES void  __hxcpp_set_target_free_space_percentage(int inPercentage);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void  __hxcpp_set_concurrent_mark_start_percentage(int inPercentage);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void  __hxcpp_set_nursery_size(int inBytes);
+HXCPP_EXTERN_CLASS_ATTRIBUTES int   __hxcpp_get_nursery_size();
+HXCPP_EXTERN_CLASS_ATTRIBUTES void  __hxcpp_set_gc_threads(int inThreads);
 HXCPP_EXTERN_CLASS_ATTRIBUTES bool __hxcpp_is_const_string(const ::String &inString);
+// True once hash() is answered from the string's own slot, rather than recalculated
+HXCPP_EXTERN_CLASS_ATTRIBUTES bool __hxcpp_string_hash_is_cached(const ::String &inString);
 HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_gc_freeze(Dynamic inObject);
 
 typedef void (hx::Object::*_hx_member_finalizer)(void);
@@ -120,6 +126,9 @@ void InternalReleaseMem(void *inMem);
 
 unsigned int ObjectSizeSafe(void *inData);
 
+// Checks the block tables rather than the header, so inData may point anywhere
+bool IsAllocStart(const void *inData, int inMinSize);
+
 // Const buffers are allocated outside the GC system, and do not require marking
 // String buffers can optionally have a pre-computed hash appended with this method
 void *InternalCreateConstBuffer(const void *inData,int inSize,bool inAddStringHash=false);
@@ -164,6 +173,40 @@ extern int sgMinimumFreeSpace;
 // Also ensure that the free memory is larger than this amount of used memory
 extern int sgTargetFreeSpacePercentage;
 
+// With HXCPP_GC_CONCURRENT, start background marking once this much of the allocation
+//  budget since the last collect has been used
+extern int sgConcurrentMarkStartPercentage;
+
+// With HXCPP_GC_GENERATIONAL, do a minor collection after this many bytes of new blocks.
+//  0 waits until the heap is full
+extern int sgNurserySize;
+
+// Number of threads used for marking and reclaiming, 0 for one per core.  Takes effect
+//  at the next collection, and is limited by the platform maximum
+extern int sgGcThreads;
+
+// 1 to zero recycled blocks on the thread that allocates from them (keeping the pages local
+//  to that thread's core), 0 to use the background zeroing thread, -1 to decide from the core count
+extern int sgGcLazyZero;
+
+// One record per collection, kept when __hxcpp_gc_enable_events is on.  Times are in seconds
+struct GcEvent
+{
+   double start;
+   double end;
+   double mark;
+   double finalize;
+   double reclaim;
+   double move;
+   double bytesFreed;
+   int    blocksMoved;
+   int    threads;
+   bool   major;
+};
+
+extern bool gGcEventsEnabled;
+void GcAddEvent(const GcEvent &inEvent);
+
 
 extern HXCPP_EXTERN_CLASS_ATTRIBUTES int gByteMarkID;
 
@@ -303,8 +346,13 @@ namespace hx
 #define HX_GC_STRING_CHAR16_T      0x00200000
 // String has hash data at end
 #define HX_GC_STRING_HASH          0x00100000
+// String has a zeroed, aligned slot after the terminator where the hash is cached on first use
+#define HX_GC_STRING_HASH_SLOT     0x00400000
 
 #define HX_GC_STRING_HASH_BIT      0x10
+#define HX_GC_STRING_HASH_SLOT_BIT 0x40
+// Shorter strings hash faster than the slot can be validated
+#define HX_GC_STRING_HASH_SLOT_MIN 64
 
 #ifdef HXCPP_BIG_ENDIAN
    #define HX_GC_STRING_HASH_OFFSET        -3
@@ -440,7 +488,38 @@ typedef ImmixAllocator GcAllocator;
 typedef ImmixAllocator Ctx;
 
 
-#ifdef HXCPP_GC_GENERATIONAL
+#ifdef HXCPP_GC_CONCURRENT
+  #ifndef HXCPP_GC_GENERATIONAL
+    #error "HXCPP_GC_CONCURRENT relies on the write barriers generated for HXCPP_GC_GENERATIONAL - define both"
+  #endif
+  #ifdef HXCPP_GC_NURSERY
+    #error "HXCPP_GC_CONCURRENT can not be combined with HXCPP_GC_NURSERY"
+  #endif
+
+  // Set while the collector is marking in the background.
+  HXCPP_EXTERN_CLASS_ATTRIBUTES extern int gConcurrentMarking;
+
+  // Incremental-update barrier - while marking, storing an unmarked value into an object that
+  //  has already been marked re-queues the object so it is scanned again in the final mark.
+  #define HX_OBJ_WB_CTX(obj,value,ctx) { \
+     if (hx::gConcurrentMarking) { \
+        unsigned char &mark =  ((unsigned char *)(obj))[ HX_ENDIAN_MARK_ID_BYTE]; \
+        if (mark == hx::gByteMarkID && value && !(((unsigned int *)(value))[-1] & hx::gPrevMarkIdMask) ) { \
+            mark|=HX_GC_REMEMBERED; \
+            ctx->pushReferrer(obj); \
+     } } }
+  #define HX_OBJ_WB_PESSIMISTIC_CTX(obj,ctx) { \
+     if (hx::gConcurrentMarking) { \
+        unsigned char &mark =  ((unsigned char *)(obj))[ HX_ENDIAN_MARK_ID_BYTE]; \
+        if (mark == hx::gByteMarkID)  { \
+           mark|=HX_GC_REMEMBERED; \
+           ctx->pushReferrer(obj); \
+     } } }
+  // The background marker may reach an object before its constructor has finished
+  #define HX_OBJ_WB_NEW_MARKED_OBJECT(obj) { \
+     if (hx::gConcurrentMarking && ((unsigned char *)(obj))[ HX_ENDIAN_MARK_ID_BYTE]==hx::gByteMarkID) hx::NewMarkedObject(obj); \
+  }
+#elif defined(HXCPP_GC_GENERATIONAL)
   #define HX_OBJ_WB_CTX(obj,value,ctx) { \
         unsigned char &mark =  ((unsigned char *)(obj))[ HX_ENDIAN_MARK_ID_BYTE]; \
         if (mark == hx::gByteMarkID && value && !((unsigned char *)(value))[ HX_ENDIAN_MARK_ID_BYTE  ] ) { \
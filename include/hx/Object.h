@@ -140,6 +140,9 @@ enum
    clsIdSslConf,
    clsIdSslKey,
    clsIdZLib,
+   clsIdSocketPoller,
+   clsIdSqliteStatement,
+   clsIdMysqlStatement,
 
 };
 
@@ -12,6 +12,13 @@ namespace hx
 
 extern bool gEnableJit;
 inline void EnableJit(bool inEnable) { gEnableJit = inEnable; }
+// When >0, cppia functions are interpreted until they have been called (or looped) this many times
+extern int gJitThreshold;
+inline void SetJitThreshold(int inCount) { gJitThreshold = inCount; }
+// With a threshold, remember which functions got hot in this directory, and compile
+//  them on their first call, without the warm-up, when the same module is loaded
+//  again.  HXCPP_CPPIA_JIT_CACHE also sets it.
+void SetJitCacheDir(String inDir);
 
 #define HXCPP_CPPIA_SUPER_ARG(x) , (x)
 
@@ -194,6 +201,7 @@ void __scriptable_load_neko(String inName);
 void __scriptable_load_cppia(String inCode);
 ::hx::CppiaLoadedModule __scriptable_cppia_from_string(String inCode);
 ::hx::CppiaLoadedModule __scriptable_cppia_from_data(Array<unsigned char> inBytes);
+::hx::CppiaLoadedModule __scriptable_cppia_from_file(String inFilename);
 void __scriptable_load_neko_bytes(Array<unsigned char> inBytes);
 void __scriptable_load_abc(Array<unsigned char> inBytes);
 
@@ -484,7 +484,16 @@ struct StackContext : public hx::ImmixAllocator
       #endif
 
       mIsUnwindingException = false;
+      #if defined(HXCPP_PROFILER) && (defined(__GNUC__) || defined(__clang__))
+      // The profiler signal reads mStackFrames, so the frame must be stored before the size covers it
+      if (!mStackFrames.hasExtraCapacity(1))
+         mStackFrames.safeReserveExtra(1);
+      mStackFrames.mPtr[mStackFrames.mSize] = inFrame;
+      __asm__ __volatile__("" ::: "memory");
+      mStackFrames.mSize++;
+      #else
       mStackFrames.push(inFrame);
+      #endif
 
       #ifdef HXCPP_DEBUGGER
       if (sExecutionTrace!=exeTraceOff)
@@ -506,6 +515,11 @@ struct StackContext : public hx::ImmixAllocator
       }
 
       mStackFrames.pop_back();
+
+      #if defined(HXCPP_PROFILER) && (defined(__GNUC__) || defined(__clang__))
+      // The profiler signal reads mStackFrames, so the pop must land before the frame dies
+      __asm__ __volatile__("" ::: "memory");
+      #endif
    }
 
    void getCurrentCallStackAsStrings(Array<String> result, bool skipLast);
@@ -492,6 +492,20 @@ Array<String> __hxcpp_get_class_list();
 void __hxcpp_start_profiler(::String inDumpFile);
 void __hxcpp_stop_profiler();
 
+// --- GC events -----------------------------------------------------------------
+
+// Each record is HX_GC_EVENT_FIELDS floats:
+//  serial, major, start, end, mark, finalize, reclaim, move, bytesFreed, blocksMoved, threads
+#define HX_GC_EVENT_FIELDS 11
+
+void   __hxcpp_gc_enable_events(bool inEnable);
+// Appends the records after inSinceSerial that are still in the log, and returns the latest serial
+int    __hxcpp_gc_get_events(int inSinceSerial, Array<Float> outRecords);
+// Pause time in seconds, at percentile 0-100 (100 = longest), over all logged collections
+double __hxcpp_gc_pause_percentile(double inPercentile);
+int    __hxcpp_gc_pause_count();
+void   __hxcpp_gc_reset_pause_stats();
+
 
 // --- Memory --------------------------------------------------------------------------
 
@@ -728,6 +742,10 @@ HXCPP_EXTERN_CLASS_ATTRIBUTES bool    _hx_regexp_match(Dynamic handle, String st
 HXCPP_EXTERN_CLASS_ATTRIBUTES String  _hx_regexp_matched(Dynamic handle, int pos);
 HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_regexp_matched_pos(Dynamic handle, int match);
 HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_regexp_matched_num(Dynamic handle);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_regexp_set_cache_size(int size);
+HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_regexp_match_all(Dynamic handle, String string, int pos, int len, Array<int> offsets);
+HXCPP_EXTERN_CLASS_ATTRIBUTES String  _hx_regexp_replace(Dynamic handle, String string, String by, bool global);
+HXCPP_EXTERN_CLASS_ATTRIBUTES Array<String> _hx_regexp_split(Dynamic handle, String string, bool global);
 
 
 // haxe.zip.(Un)Compress.hx -> src/hx/libs/zlib/ZLib.cpp
@@ -741,16 +759,25 @@ HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_inflate_buffer(Dynamic handle, Array<u
 HXCPP_EXTERN_CLASS_ATTRIBUTES void _hx_inflate_end(Dynamic handle);
 
 HXCPP_EXTERN_CLASS_ATTRIBUTES void _hx_zip_set_flush_mode(Dynamic handle, String flushMode);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void _hx_zip_set_pool_size(int inSize);
+HXCPP_EXTERN_CLASS_ATTRIBUTES Array<unsigned char> _hx_gzip_compress(Array<unsigned char> src, int srcPos, int length, int level, int threads);
 
 // sys.db.Mysql.hx -> src/hx/libs/regexp/RegExp.cpp
 HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_mysql_connect(Dynamic params);
 HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_mysql_select_db(Dynamic handle,String db);
 HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_mysql_request(Dynamic handle,String req);
+HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_mysql_request_stream(Dynamic handle,String req);
+HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_mysql_prepare(Dynamic handle,String sql);
+HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_mysql_stmt_execute(Dynamic stmt,Array<Dynamic> params);
+HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_mysql_stmt_execute_batch(Dynamic stmt,Array<Dynamic> rows);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_mysql_stmt_close(Dynamic stmt);
 HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_mysql_close(Dynamic handle);
 HXCPP_EXTERN_CLASS_ATTRIBUTES String  _hx_mysql_escape(Dynamic handle,String str);
 HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_mysql_result_get_length(Dynamic handle);
 HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_mysql_result_get_nfields(Dynamic handle);
 HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_mysql_result_next(Dynamic handle);
+HXCPP_EXTERN_CLASS_ATTRIBUTES bool    _hx_mysql_result_fetch_row(Dynamic handle,Array<Dynamic> row);
+HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_mysql_result_fetch_columns(Dynamic handle,Array<Dynamic> columns,int maxRows);
 HXCPP_EXTERN_CLASS_ATTRIBUTES String  _hx_mysql_result_get(Dynamic handle,int i);
 HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_mysql_result_get_int(Dynamic handle,int i);
 HXCPP_EXTERN_CLASS_ATTRIBUTES Float   _hx_mysql_result_get_float(Dynamic handle,int i);
@@ -769,9 +796,25 @@ HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_sqlite_request(Dynamic handle,String r
 HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_sqlite_close(Dynamic handle);
 HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_sqlite_last_insert_id(Dynamic handle);
 
+HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_sqlite_prepare(Dynamic handle,String sql);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_sqlite_set_statement_cache_size(Dynamic handle,int size);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_sqlite_stmt_bind_int(Dynamic stmt,int index,int value);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_sqlite_stmt_bind_float(Dynamic stmt,int index,Float value);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_sqlite_stmt_bind_string(Dynamic stmt,int index,String value);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_sqlite_stmt_bind_bytes(Dynamic stmt,int index,Array<unsigned char> value);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_sqlite_stmt_bind_null(Dynamic stmt,int index);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_sqlite_stmt_clear_bindings(Dynamic stmt);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_sqlite_stmt_reset(Dynamic stmt);
+HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_sqlite_stmt_step(Dynamic stmt);
+HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_sqlite_stmt_changes(Dynamic stmt);
+HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_sqlite_stmt_execute_batch(Dynamic stmt,Array<Dynamic> rows);
+HXCPP_EXTERN_CLASS_ATTRIBUTES void    _hx_sqlite_stmt_close(Dynamic stmt);
+
 HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_sqlite_result_get_length(Dynamic handle);
 HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_sqlite_result_get_nfields(Dynamic handle);
 HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_sqlite_result_next(Dynamic handle);
+HXCPP_EXTERN_CLASS_ATTRIBUTES bool    _hx_sqlite_result_fetch_row(Dynamic handle,Array<Dynamic> row);
+HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_sqlite_result_fetch_columns(Dynamic handle,Array<Dynamic> columns,int maxRows);
 HXCPP_EXTERN_CLASS_ATTRIBUTES String  _hx_sqlite_result_get(Dynamic handle,int i);
 HXCPP_EXTERN_CLASS_ATTRIBUTES int     _hx_sqlite_result_get_int(Dynamic handle,int i);
 HXCPP_EXTERN_CLASS_ATTRIBUTES Float   _hx_sqlite_result_get_float(Dynamic handle,int i);
@@ -851,6 +894,12 @@ HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_std_socket_poll_alloc( int nsocks );
 HXCPP_EXTERN_CLASS_ATTRIBUTES Array<Dynamic> _hx_std_socket_poll_prepare( Dynamic pdata, Array<Dynamic> rsocks, Array<Dynamic> wsocks );
 HXCPP_EXTERN_CLASS_ATTRIBUTES void _hx_std_socket_poll_events( Dynamic pdata, double timeout );
 HXCPP_EXTERN_CLASS_ATTRIBUTES Array<Dynamic> _hx_std_socket_poll( Array<Dynamic> socks, Dynamic pdata, double timeout );
+HXCPP_EXTERN_CLASS_ATTRIBUTES Dynamic _hx_std_socket_poller_new();
+HXCPP_EXTERN_CLASS_ATTRIBUTES void _hx_std_socket_poller_add( Dynamic poller, Dynamic sock, int events );
+HXCPP_EXTERN_CLASS_ATTRIBUTES void _hx_std_socket_poller_modify( Dynamic poller, Dynamic sock, int events );
+HXCPP_EXTERN_CLASS_ATTRIBUTES void _hx_std_socket_poller_remove( Dynamic poller, Dynamic sock );
+HXCPP_EXTERN_CLASS_ATTRIBUTES int _hx_std_socket_poller_wait( Dynamic poller, Array<Dynamic> outSockets, Array<int> outEvents, double timeout );
+HXCPP_EXTERN_CLASS_ATTRIBUTES void _hx_std_socket_poller_close( Dynamic poller );
 HXCPP_EXTERN_CLASS_ATTRIBUTES int _hx_std_socket_send_to( Dynamic o, Array<unsigned char> buf, int p, int l, Dynamic inAddr );
 HXCPP_EXTERN_CLASS_ATTRIBUTES int _hx_std_socket_recv_from( Dynamic o, Array<unsigned char> buf, int p, int l, Dynamic outAddr);
 
@@ -245,11 +245,24 @@ public:
         #endif
       }
 
+      if ( __s[HX_GC_STRING_HASH_OFFSET] & HX_GC_STRING_HASH_SLOT_BIT)
+         return cachedHash();
+
       // Slow path..
       return calcHash();
    }
 
+   inline unsigned int *hashSlot() const
+   {
+      #ifdef HX_SMART_STRINGS
+      if (isUTF16Encoded())
+         return (unsigned int *)((char *)__w + ((length*2+5) & ~3));
+      #endif
+      return (unsigned int *)(__s + ((length+4) & ~3));
+   }
+
    unsigned int calcHash() const;
+   unsigned int cachedHash() const;
    unsigned int calcSubHash(int start, int length) const;
 
    #ifdef HX_SMART_STRINGS
@@ -392,6 +405,8 @@ inline int HXCPP_EXTERN_CLASS_ATTRIBUTES _hx_string_compare(String inString0, St
 }
 
 String HXCPP_EXTERN_CLASS_ATTRIBUTES _hx_utf8_to_utf16(const unsigned char *ptr, int inUtf8Len, bool addHash);
+// Same conversion into memory from inBuffer, rather than a new GC string
+HXCPP_EXTERN_CLASS_ATTRIBUTES const char16_t *_hx_utf8_to_utf16_buffer(const unsigned char *ptr, int inUtf8Len, hx::IStringAlloc *inBuffer, int *outCharLength=0);
 
 int HXCPP_EXTERN_CLASS_ATTRIBUTES _hx_utf8_char_code_at(String inString, int inIndex);
 int HXCPP_EXTERN_CLASS_ATTRIBUTES _hx_utf8_length(String inString);
@@ -298,7 +298,8 @@ public:
 
 typedef ::cpp::Variant Val;
 
-#ifdef HXCPP_GC_GENERATIONAL
+// The concurrent collector uses the generational write barriers, but not the nursery
+#if defined(HXCPP_GC_GENERATIONAL) && !defined(HXCPP_GC_CONCURRENT)
   #define HXCPP_GC_NURSERY
 #endif
 
@@ -1,6 +1,10 @@
 #include <hxcpp.h>
 #include <vector>
 #include <cpp/Pointer.h>
+#include <hx/Thread.h>
+#ifndef HX_WINDOWS
+#include <unistd.h>
+#endif
 
 #ifdef HXCPP_TELEMETRY
 extern void __hxt_new_array(void* obj, int size);
@@ -32,6 +36,7 @@ ArrayBase::ArrayBase(int inSize,int inReserve,int inElementSize,bool inAtomic)
    else
       mBase = 0;
    mAlloc = alloc;
+   mOffset = 0;
    mArrayConvertId = inAtomic ? inElementSize :
                inElementSize==sizeof(String) ? aciStringArray : aciObjectArray;
 }
@@ -40,6 +45,8 @@ ArrayBase::ArrayBase(int inSize,int inReserve,int inElementSize,bool inAtomic)
 
 void ArrayBase::reserve(int inSize) const
 {
+   if (mAlloc<inSize)
+      ResetOffset();
    if (mAlloc<inSize)
    {
       int elemSize = GetElementSize();
@@ -71,8 +78,34 @@ void ArrayBase::reserve(int inSize) const
 }
 
 
+void ArrayBase::ResetOffset() const
+{
+   if (mOffset)
+   {
+      int s = GetElementSize();
+      char *start = mBase - mOffset;
+      memmove(start, mBase, length*s);
+      // Keep the unused elements zeroed
+      memset(start + length*s, 0, mOffset);
+      mBase = start;
+      mAlloc += mOffset/s;
+      mOffset = 0;
+   }
+}
+
+
 void ArrayBase::Realloc(int inSize) const
 {
+   if (mOffset)
+   {
+      // Moving the elements down only pays for itself if it frees at least as many as it moves,
+      //  otherwise grow as well so a queue does not compact on every push
+      bool compacted = mOffset/GetElementSize() >= length;
+      ResetOffset();
+      if (compacted && inSize<=mAlloc)
+         return;
+   }
+
    // Try to detect "push" case vs resizing to big array size explicitly by looking at gap
    bool pushCase = (inSize<=mAlloc + 16);
    if (!pushCase)
@@ -212,12 +245,13 @@ void ArrayBase::__SetSizeExact(int inSize)
 {
    if (inSize==0)
    {
-      InternalReleaseMem(mBase);
+      InternalReleaseMem(mBase - mOffset);
       mBase = 0;
-      mAlloc = length = 0;
+      mAlloc = length = mOffset = 0;
    }
    else if (inSize!=length || inSize!=mAlloc)
    {
+      ResetOffset();
       int elemSize = GetElementSize();
       int bytes = inSize * elemSize;
       if (mBase)
@@ -268,6 +302,34 @@ Dynamic ArrayBase::__unsafe_set(const Dynamic &i, const Dynamic &val)
 
 void ArrayBase::Insert(int inPos)
 {
+   // The concurrent marker reads mBase without a lock, so it must always be the allocation
+   #ifndef HXCPP_GC_CONCURRENT
+   if (inPos==0 && length>0 && mAlloc>0)
+   {
+      int s = GetElementSize();
+      if (!mOffset && length>=8)
+      {
+         // Leave room in front of the elements, so repeated unshifts are amortised O(1)
+         int room = length>>1;
+         if (length+room>mAlloc)
+            Realloc(length+room);
+         memmove(mBase + room*s, mBase, length*s);
+         memset(mBase, 0, room*s);
+         mBase += room*s;
+         mOffset = room*s;
+         mAlloc -= room;
+      }
+      if (mOffset)
+      {
+         // The slot in front is already zeroed
+         mBase -= s;
+         mOffset -= s;
+         mAlloc++;
+         length++;
+         return;
+      }
+   }
+   #endif
    if (inPos>=length)
       resize(length+1);
    else
@@ -337,6 +399,27 @@ void ArrayBase::RemoveElement(int inPos)
    if (inPos<length)
    {
       int s = GetElementSize();
+      #ifndef HXCPP_GC_CONCURRENT
+      if (inPos==0 && mAlloc>0)
+      {
+         // Move the start of the array rather than the elements
+         memset(mBase, 0, s);
+         length--;
+         if (length==0)
+         {
+            mAlloc += mOffset/s;
+            mBase -= mOffset;
+            mOffset = 0;
+         }
+         else
+         {
+            mBase += s;
+            mOffset += s;
+            mAlloc--;
+         }
+         return;
+      }
+      #endif
       memmove(mBase + inPos*s, mBase+inPos*s + s, (length-inPos-1)*s );
       resize(length-1);
    }
@@ -549,6 +632,291 @@ void ArrayBase::safeSort(Dynamic inSorter, bool inIsString)
 }
 
 
+// --- Radix sort ------------------------------------------------------
+//
+// Each value is mapped to an unsigned key that orders the same way, then sorted a byte
+//  at a time, least significant first.  Bytes that are the same in every key are skipped.
+
+namespace
+{
+inline unsigned int radixKey(int inValue) { return (unsigned int)inValue ^ 0x80000000u; }
+inline unsigned long long radixKey(cpp::Int64 inValue) { return (unsigned long long)inValue ^ 0x8000000000000000ull; }
+// Negative floats sort in reverse, so flip all their bits.  Positive ones go above them.
+inline unsigned int radixKey(float inValue)
+{
+   unsigned int bits;
+   memcpy(&bits, &inValue, sizeof(bits));
+   return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+inline unsigned long long radixKey(double inValue)
+{
+   unsigned long long bits;
+   memcpy(&bits, &inValue, sizeof(bits));
+   return (bits & 0x8000000000000000ull) ? ~bits : bits | 0x8000000000000000ull;
+}
+
+template<typename T, typename KEY, bool DESCENDING>
+void TRadixSort(T *ioData, int inLength)
+{
+   enum { PASSES = sizeof(T) };
+   T *buffer = (T *)malloc(sizeof(T)*inLength);
+   if (!buffer)
+   {
+      std::stable_sort(ioData, ioData+inLength);
+      if (DESCENDING)
+         std::reverse(ioData, ioData+inLength);
+      return;
+   }
+
+   unsigned int counts[PASSES][256];
+   memset(counts, 0, sizeof(counts));
+   for(int i=0;i<inLength;i++)
+   {
+      KEY key = radixKey(ioData[i]);
+      if (DESCENDING)
+         key = ~key;
+      for(int p=0;p<PASSES;p++)
+         counts[p][(key>>(p*8)) & 0xff]++;
+   }
+
+   T *src = ioData;
+   T *dest = buffer;
+   for(int p=0;p<PASSES;p++)
+   {
+      unsigned int *count = counts[p];
+      int shift = p*8;
+      KEY first = radixKey(src[0]);
+      if (DESCENDING)
+         first = ~first;
+      if (count[(first>>shift) & 0xff]==(unsigned int)inLength)
+         continue;
+
+      unsigned int offset = 0;
+      for(int b=0;b<256;b++)
+      {
+         unsigned int n = count[b];
+         count[b] = offset;
+         offset += n;
+      }
+      for(int i=0;i<inLength;i++)
+      {
+         KEY key = radixKey(src[i]);
+         if (DESCENDING)
+            key = ~key;
+         dest[ count[(key>>shift) & 0xff]++ ] = src[i];
+      }
+      std::swap(src,dest);
+   }
+   if (src!=ioData)
+      memcpy(ioData, src, sizeof(T)*inLength);
+   free(buffer);
+}
+
+template<typename T, typename KEY>
+void TRadixSort(T *ioData, int inLength, bool inDescending)
+{
+   if (inDescending)
+      TRadixSort<T,KEY,true>(ioData, inLength);
+   else
+      TRadixSort<T,KEY,false>(ioData, inLength);
+}
+}
+
+void ArrayRadixSort(int *ioData, int inLength, bool inDescending)
+   { TRadixSort<int,unsigned int>(ioData, inLength, inDescending); }
+void ArrayRadixSort(cpp::Int64 *ioData, int inLength, bool inDescending)
+   { TRadixSort<cpp::Int64,unsigned long long>(ioData, inLength, inDescending); }
+void ArrayRadixSort(float *ioData, int inLength, bool inDescending)
+   { TRadixSort<float,unsigned int>(ioData, inLength, inDescending); }
+void ArrayRadixSort(double *ioData, int inLength, bool inDescending)
+   { TRadixSort<double,unsigned long long>(ioData, inLength, inDescending); }
+
+
+// --- Parallel sort ---------------------------------------------------
+
+namespace
+{
+struct ParallelJob
+{
+   HxMutex     mutex;
+   HxSemaphore done;
+   void        (*task)(void *,int);
+   void        *context;
+   int         tasks;
+   int         next;
+   int         running;
+   int         refs;
+   // First exception thrown by a helper, rooted while set
+   bool        failed;
+   hx::Object  *error;
+};
+
+void releaseParallelJob(ParallelJob *job)
+{
+   job->mutex.Lock();
+   bool last = --job->refs==0;
+   job->mutex.Unlock();
+   if (last)
+      delete job;
+}
+
+void runParallelTasks(ParallelJob *job)
+{
+   while(true)
+   {
+      job->mutex.Lock();
+      int idx = job->next < job->tasks ? job->next++ : -1;
+      job->mutex.Unlock();
+      if (idx<0)
+         break;
+      job->task(job->context, idx);
+   }
+}
+
+// Stop handing out tasks, and keep the first helper exception for the caller
+void failParallelJob(ParallelJob *job, Dynamic inError)
+{
+   job->mutex.Lock();
+   job->next = job->tasks;
+   if (!job->failed)
+   {
+      job->failed = true;
+      job->error = inError.mPtr;
+      hx::GCAddRoot(&job->error);
+   }
+   job->mutex.Unlock();
+}
+
+THREAD_FUNC_TYPE parallelThreadFunc(void *inJob)
+{
+   ParallelJob *job = (ParallelJob *)inJob;
+   // Tasks may call back into haxe code, so need a context
+   hx::RegisterCurrentThread(&job);
+   try
+   {
+      runParallelTasks(job);
+   }
+   catch(Dynamic &e)
+   {
+      failParallelJob(job, e);
+   }
+   catch(...)
+   {
+      failParallelJob(job, HX_CSTRING("Unknown exception in parallel task"));
+   }
+   hx::UnregisterCurrentThread();
+
+   job->mutex.Lock();
+   bool finished = --job->running==0;
+   job->mutex.Unlock();
+   if (finished)
+      job->done.Set();
+   releaseParallelJob(job);
+   THREAD_FUNC_RET
+}
+
+// Wait for the helpers and release the job, returning any helper exception
+bool finishParallelJob(ParallelJob *job, Dynamic &outError)
+{
+   job->mutex.Lock();
+   bool wait = job->running>0;
+   job->mutex.Unlock();
+   if (wait)
+   {
+      hx::EnterGCFreeZone();
+      job->done.Wait();
+      hx::ExitGCFreeZone();
+   }
+
+   bool failed = job->failed;
+   if (failed)
+   {
+      outError = job->error;
+      hx::GCRemoveRoot(&job->error);
+   }
+   releaseParallelJob(job);
+   return failed;
+}
+}
+
+int ParallelSortThreads()
+{
+   static int sCpuCount = 0;
+   if (!sCpuCount)
+   {
+      #if defined(EMSCRIPTEN)
+      sCpuCount = 1;
+      #elif defined(HX_WINDOWS) && !defined(HX_WINRT)
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      sCpuCount = (int)info.dwNumberOfProcessors;
+      #elif defined(_SC_NPROCESSORS_ONLN)
+      sCpuCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+      #endif
+      if (sCpuCount<1)
+         sCpuCount = 1;
+   }
+   return sCpuCount;
+}
+
+void ParallelFor(int inTasks, void (*inTask)(void *,int), void *inContext, int inThreads)
+{
+   if (inThreads>inTasks)
+      inThreads = inTasks;
+   if (inThreads<2)
+   {
+      for(int i=0;i<inTasks;i++)
+         inTask(inContext,i);
+      return;
+   }
+
+   ParallelJob *job = new ParallelJob();
+   job->task = inTask;
+   job->context = inContext;
+   job->tasks = inTasks;
+   job->next = 0;
+   job->running = 0;
+   job->refs = 1;
+   job->failed = false;
+   job->error = 0;
+
+   hx::GCPrepareMultiThreaded();
+   for(int t=1;t<inThreads;t++)
+   {
+      job->mutex.Lock();
+      job->running++;
+      job->refs++;
+      job->mutex.Unlock();
+      if (!HxCreateDetachedThread(parallelThreadFunc, job))
+      {
+         job->mutex.Lock();
+         job->running--;
+         job->refs--;
+         job->mutex.Unlock();
+         break;
+      }
+   }
+   // The caller takes tasks too, as a normal haxe thread.  The helpers must be finished
+   //  with inContext before this returns or throws.
+   Dynamic error;
+   try
+   {
+      runParallelTasks(job);
+   }
+   catch(...)
+   {
+      job->mutex.Lock();
+      job->next = job->tasks;
+      job->mutex.Unlock();
+      finishParallelJob(job, error);
+      throw;
+   }
+
+   if (finishParallelJob(job, error))
+      hx::Throw(error);
+}
+
+
 
 #ifdef HXCPP_VISIT_ALLOCS
 #define ARRAY_VISIT_FUNC \
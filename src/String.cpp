@@ -45,6 +45,22 @@ using namespace std;
 #include "hx/Unicase.h"
 #endif
 
+// Vector paths for skipping/copying ascii runs while transcoding
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+   #include <emmintrin.h>
+   #define HX_STRING_SSE2
+   #ifdef __AVX2__
+      #include <immintrin.h>
+      #define HX_STRING_AVX2
+   #endif
+   #ifdef _MSC_VER
+      #include <intrin.h>
+   #endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+   #include <arm_neon.h>
+   #define HX_STRING_NEON
+#endif
+
 namespace hx
 {
 char HX_DOUBLE_PATTERN[20] = "%.15g";
@@ -233,6 +249,145 @@ inline int Char16Advance(const char16_t *&ioStr,bool throwOnErr=true)
 }
 
 
+#if defined(HX_STRING_SSE2)
+static inline int LowestSetBit(unsigned int inMask)
+{
+   #ifdef _MSC_VER
+   unsigned long result;
+   _BitScanForward(&result, inMask);
+   return (int)result;
+   #else
+   return __builtin_ctz(inMask);
+   #endif
+}
+#endif
+
+// Number of leading bytes < 0x80
+static inline int Utf8AsciiRun(const unsigned char *inPtr, int inLen)
+{
+   int i = 0;
+   #if defined(HX_STRING_AVX2)
+   for(; i+32<=inLen; i+=32)
+   {
+      unsigned int mask = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(inPtr+i)));
+      if (mask)
+         return i + LowestSetBit(mask);
+   }
+   #endif
+   #if defined(HX_STRING_SSE2)
+   for(; i+16<=inLen; i+=16)
+   {
+      unsigned int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(inPtr+i)));
+      if (mask)
+         return i + LowestSetBit(mask);
+   }
+   #elif defined(HX_STRING_NEON)
+   for(; i+16<=inLen; i+=16)
+      if (vmaxvq_u8(vld1q_u8(inPtr+i))>=0x80)
+         break;
+   #else
+   for(; i+8<=inLen; i+=8)
+   {
+      unsigned int a,b;
+      memcpy(&a,inPtr+i,4);
+      memcpy(&b,inPtr+i+4,4);
+      if ((a|b) & 0x80808080)
+         break;
+   }
+   #endif
+   while(i<inLen && inPtr[i]<0x80)
+      i++;
+   return i;
+}
+
+// Number of leading chars < 0x80
+static inline int Char16AsciiRun(const char16_t *inPtr, int inLen)
+{
+   int i = 0;
+   #if defined(HX_STRING_SSE2)
+   const __m128i high = _mm_set1_epi16((short)0xff80);
+   const __m128i zero = _mm_setzero_si128();
+   for(; i+8<=inLen; i+=8)
+   {
+      __m128i v = _mm_loadu_si128((const __m128i *)(inPtr+i));
+      unsigned int ascii = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v,high),zero));
+      if (ascii!=0xffff)
+         return i + (LowestSetBit(~ascii & 0xffff)>>1);
+   }
+   #elif defined(HX_STRING_NEON)
+   for(; i+8<=inLen; i+=8)
+      if (vmaxvq_u16(vld1q_u16((const uint16_t *)(inPtr+i)))>=0x80)
+         break;
+   #endif
+   while(i<inLen && inPtr[i]<0x80)
+      i++;
+   return i;
+}
+
+static inline void WidenAscii(char16_t *outPtr, const unsigned char *inPtr, int inLen)
+{
+   int i = 0;
+   #if defined(HX_STRING_SSE2)
+   const __m128i zero = _mm_setzero_si128();
+   for(; i+16<=inLen; i+=16)
+   {
+      __m128i v = _mm_loadu_si128((const __m128i *)(inPtr+i));
+      _mm_storeu_si128((__m128i *)(outPtr+i), _mm_unpacklo_epi8(v,zero));
+      _mm_storeu_si128((__m128i *)(outPtr+i+8), _mm_unpackhi_epi8(v,zero));
+   }
+   #elif defined(HX_STRING_NEON)
+   for(; i+16<=inLen; i+=16)
+   {
+      uint8x16_t v = vld1q_u8(inPtr+i);
+      vst1q_u16((uint16_t *)(outPtr+i), vmovl_u8(vget_low_u8(v)));
+      vst1q_u16((uint16_t *)(outPtr+i+8), vmovl_high_u8(v));
+   }
+   #endif
+   for(; i<inLen; i++)
+      outPtr[i] = inPtr[i];
+}
+
+// Only valid for chars < 0x80
+static inline void NarrowAscii(char *outPtr, const char16_t *inPtr, int inLen)
+{
+   int i = 0;
+   #if defined(HX_STRING_SSE2)
+   for(; i+16<=inLen; i+=16)
+   {
+      __m128i a = _mm_loadu_si128((const __m128i *)(inPtr+i));
+      __m128i b = _mm_loadu_si128((const __m128i *)(inPtr+i+8));
+      _mm_storeu_si128((__m128i *)(outPtr+i), _mm_packus_epi16(a,b));
+   }
+   #elif defined(HX_STRING_NEON)
+   for(; i+16<=inLen; i+=16)
+   {
+      uint16x8_t a = vld1q_u16((const uint16_t *)(inPtr+i));
+      uint16x8_t b = vld1q_u16((const uint16_t *)(inPtr+i+8));
+      vst1q_u8((uint8_t *)(outPtr+i), vcombine_u8(vmovn_u16(a),vmovn_u16(b)));
+   }
+   #endif
+   for(; i<inLen; i++)
+      outPtr[i] = (char)inPtr[i];
+}
+
+static int Utf8ToUtf16Length(const unsigned char *u, const unsigned char *end)
+{
+   int char16Count = 0;
+   while(u<end)
+   {
+      if (*u<0x80)
+      {
+         int run = Utf8AsciiRun(u,end-u);
+         char16Count += run;
+         u += run;
+      }
+      else
+         char16Count += UTF16BytesCheck( DecodeAdvanceUTF8(u,end) );
+   }
+   return char16Count;
+}
+
+
 void Char16AdvanceSet(char16_t *&ioStr,int inChar)
 {
    if (inChar>=0x10000)
@@ -256,6 +411,23 @@ void Char16AdvanceSet(char16_t *&ioStr,int inChar)
       *ioStr++ = inChar;
 }
 
+static char16_t *Utf8ToUtf16Copy(const unsigned char *u, const unsigned char *end, char16_t *o)
+{
+   while(u<end)
+   {
+      if (*u<0x80)
+      {
+         int run = Utf8AsciiRun(u,end-u);
+         WidenAscii(o,u,run);
+         o += run;
+         u += run;
+      }
+      else
+         Char16AdvanceSet(o, DecodeAdvanceUTF8(u,end) );
+   }
+   return o;
+}
+
 
 template<typename T>
 char *TConvertToUTF8(const T *inStr, int *ioLen, hx::IStringAlloc *inBuffer,bool)
@@ -305,14 +477,33 @@ char *TConvertToUTF8(const char16_t *inStr, int *ioLen, hx::IStringAlloc *inBuff
    const char16_t *end = s + len;
    int chars = 0;
    while(s<end)
-      chars += UTF8Bytes( Char16Advance( s,throwInvalid ) );
+   {
+      if (*s<0x80)
+      {
+         int run = Char16AsciiRun(s,end-s);
+         chars += run;
+         s += run;
+      }
+      else
+         chars += UTF8Bytes( Char16Advance( s,throwInvalid ) );
+   }
 
    char *buf = inBuffer ? (char *)inBuffer->allocBytes(chars+1) :
                           (char *)NewGCPrivate(0,chars+1);
    char *ptr = buf;
    s = inStr;
    while(s<end)
-      UTF8EncodeAdvance(ptr,Char16Advance(s,throwInvalid));
+   {
+      if (*s<0x80)
+      {
+         int run = Char16AsciiRun(s,end-s);
+         NarrowAscii(ptr,s,run);
+         ptr += run;
+         s += run;
+      }
+      else
+         UTF8EncodeAdvance(ptr,Char16Advance(s,throwInvalid));
+   }
 
    *ptr = 0;
    if (ioLen)
@@ -323,12 +514,60 @@ char *TConvertToUTF8(const char16_t *inStr, int *ioLen, hx::IStringAlloc *inBuff
 
 char16_t *String::allocChar16Ptr(int len)
 {
-   char16_t *result = (char16_t *)hx::InternalNew( (len+1)*2, false );
-   ((unsigned int *)result)[-1] |= HX_GC_STRING_CHAR16_T;
+   char16_t *result;
+   #ifndef HXCPP_NO_STRING_HASH_CACHE
+   if (len>=HX_GC_STRING_HASH_SLOT_MIN)
+   {
+      int slot = (len*2+5) & ~3;
+      result = (char16_t *)hx::InternalNew( slot + sizeof(int), false );
+      *(unsigned int *)((char *)result + slot) = 0;
+      ((unsigned int *)result)[-1] |= HX_GC_STRING_CHAR16_T | HX_GC_STRING_HASH_SLOT;
+   }
+   else
+   #endif
+   {
+      result = (char16_t *)hx::InternalNew( (len+1)*2, false );
+      ((unsigned int *)result)[-1] |= HX_GC_STRING_CHAR16_T;
+   }
    result[len] = 0;
    return result;
 }
 
+// A string from NewString came out shorter than allocated, so its hash slot moves down
+static void shrinkString(char *inStr, int inLen)
+{
+   inStr[inLen] = '\0';
+   if (inStr[HX_GC_STRING_HASH_OFFSET] & HX_GC_STRING_HASH_SLOT_BIT)
+      *(unsigned int *)(inStr + ((inLen+4) & ~3)) = 0;
+}
+
+
+template<typename DEST, typename SRC>
+static inline void copyChars(DEST *outDest, const SRC *inSrc, int inLength)
+{
+   if (sizeof(DEST)==sizeof(SRC))
+      memcpy(outDest, inSrc, inLength*sizeof(DEST));
+   else
+      for(int i=0;i<inLength;i++)
+         outDest[i] = inSrc[i];
+}
+
+// Concatenate into a new, terminated buffer of T
+template<typename T, typename L, typename R>
+static const T *concatChars(const L *inLeft, int inLeftLength, const R *inRight, int inRightLength)
+{
+   int l = inLeftLength + inRightLength;
+   T *result;
+   if (sizeof(T)==2)
+      result = (T *)String::allocChar16Ptr(l);
+   else
+      result = (T *)hx::NewString(l);
+   copyChars(result, inLeft, inLeftLength);
+   copyChars(result + inLeftLength, inRight, inRightLength);
+   result[l] = 0;
+   return result;
+}
+
 
 template<typename T>
 static const char *GCStringDup(const T *inStr,int inLen, int *outLen=0)
@@ -352,6 +591,10 @@ static const char *GCStringDup(const T *inStr,int inLen, int *outLen=0)
          len++;
       }
    }
+   else if (sizeof(T)==2)
+   {
+      allAscii = Char16AsciiRun((const char16_t *)inStr,inLen)==inLen;
+   }
    else if (sizeof(T)>1)
    {
       for(int i=0;i<inLen;i++)
@@ -420,6 +663,8 @@ static const char *GCStringDup(const T *inStr,int inLen, int *outLen=0)
       char *result = hx::NewString( len );
       if (sizeof(T)==1)
          memcpy(result,inStr,sizeof(char)*(len));
+      else if (sizeof(T)==2)
+         NarrowAscii(result,(const char16_t *)inStr,len);
       else
          for(int i=0;i<len;i++)
             result[i] = inStr[i];
@@ -704,8 +949,17 @@ int _hx_utf8_length(String inString)
    const unsigned char *sLen = getUtf8LenArray();
    while(src<end)
    {
-      src += sLen[*src];
-      len++;
+      if (*src<0x80)
+      {
+         int run = Utf8AsciiRun(src,end-src);
+         src += run;
+         len += run;
+      }
+      else
+      {
+         src += sLen[*src];
+         len++;
+      }
    }
    if (src>end)
       hx::Throw(HX_CSTRING("Invalid UTF8"));
@@ -722,7 +976,12 @@ bool _hx_utf8_is_valid(String inString)
    const unsigned char *end = src + inString.length;
    const unsigned char *sLen = getUtf8LenArray();
    while(src<end)
-      src += sLen[*src];
+   {
+      if (*src<0x80)
+         src += Utf8AsciiRun(src,end-src);
+      else
+         src += sLen[*src];
+   }
 
    return src==end;
    #endif
@@ -775,11 +1034,8 @@ String String::create(const char *inString,int inLength)
       for(inLength=0; inString[inLength]; inLength++) { }
 
    const unsigned char *c = (const unsigned char *)inString;
-   for(int i=0;i<inLength;i++)
-   {
-      if (c[i]>127)
-         return _hx_utf8_to_utf16(c, inLength,false);
-   }
+   if (Utf8AsciiRun(c,inLength)<inLength)
+      return _hx_utf8_to_utf16(c, inLength,false);
 
    #endif
 
@@ -894,93 +1150,105 @@ void String::fromPointer(const void *p)
     result = result*223 + (int)(X)
 #endif
 
-unsigned int String::calcSubHash(int start, int inLen) const
+// The same "result*223 + c" polynomial, four bytes per step so the multiplies overlap.
+//  The values must not change - the compiler bakes them into constant strings.
+#define HASH_223_2 49729U
+#define HASH_223_3 11089567U
+#define HASH_223_4 2472973441U
+
+static inline unsigned int hashBytes(unsigned int result, const unsigned char *s, int inLen)
 {
-   unsigned int result = 0;
-   #ifdef HX_SMART_STRINGS
-   if (isUTF16Encoded())
+   int i = 0;
+   for(;i+4<=inLen;i+=4)
+      result = result*HASH_223_4 + s[i]*HASH_223_3 + s[i+1]*HASH_223_2 + s[i+2]*223U + s[i+3];
+   for(;i<inLen;i++)
+      result = result*223 + s[i];
+   return result;
+}
+
+#ifdef HX_SMART_STRINGS
+// Hash of the utf8 encoding, without encoding it
+static unsigned int hashChar16(unsigned int result, const char16_t *w, int inLen)
+{
+   int i = 0;
+   while(i<inLen)
    {
-      const char16_t *w = __w + start;
-      for(int i=0;i<inLen;i++)
+      if (i+4<=inLen && (w[i]|w[i+1]|w[i+2]|w[i+3])<0x80)
       {
-         int c = w[i];
-         if( c <= 0x7F )
-         {
-            ADD_HASH(c);
-         }
-         else if( c <= 0x7FF )
-         {
-            ADD_HASH(0xC0 | (c >> 6));
-            ADD_HASH(0x80 | (c & 63));
-         }
-         else if( c <= 0xFFFF )
-         {
-            ADD_HASH(0xE0 | (c >> 12));
-            ADD_HASH(0x80 | ((c >> 6) & 63));
-            ADD_HASH(0x80 | (c & 63));
-         }
-         else
-         {
-            ADD_HASH(0xF0 | (c >> 18));
-            ADD_HASH(0x80 | ((c >> 12) & 63));
-            ADD_HASH(0x80 | ((c >> 6) & 63) );
-            ADD_HASH(0x80 | (c & 63) );
-         }
+         result = result*HASH_223_4 + w[i]*HASH_223_3 + w[i+1]*HASH_223_2 + w[i+2]*223U + w[i+3];
+         i+=4;
+         continue;
+      }
+      int c = w[i++];
+      if( c <= 0x7F )
+      {
+         ADD_HASH(c);
+      }
+      else if( c <= 0x7FF )
+      {
+         ADD_HASH(0xC0 | (c >> 6));
+         ADD_HASH(0x80 | (c & 63));
+      }
+      else if( c <= 0xFFFF )
+      {
+         ADD_HASH(0xE0 | (c >> 12));
+         ADD_HASH(0x80 | ((c >> 6) & 63));
+         ADD_HASH(0x80 | (c & 63));
+      }
+      else
+      {
+         ADD_HASH(0xF0 | (c >> 18));
+         ADD_HASH(0x80 | ((c >> 12) & 63));
+         ADD_HASH(0x80 | ((c >> 6) & 63) );
+         ADD_HASH(0x80 | (c & 63) );
       }
    }
-   else
-   #endif
-   {
-      const unsigned char *s = (const unsigned char *)__s + start;
-      for(int i=0;i<inLen;i++)
-         result = result*223 + s[i];
-   }
-
    return result;
+}
+#endif
 
+unsigned int String::calcSubHash(int start, int inLen) const
+{
+   #ifdef HX_SMART_STRINGS
+   if (isUTF16Encoded())
+      return hashChar16(0, __w + start, inLen);
+   #endif
+   return hashBytes(0, (const unsigned char *)__s + start, inLen);
 }
 
 unsigned int String::calcHash() const
 {
-   unsigned int result = 0;
    #ifdef HX_SMART_STRINGS
    if (isUTF16Encoded())
-   {
-      for(int i=0;i<length;i++)
-      {
-         int c = __w[i];
-         if( c <= 0x7F )
-         {
-            ADD_HASH(c);
-         }
-         else if( c <= 0x7FF )
-         {
-            ADD_HASH(0xC0 | (c >> 6));
-            ADD_HASH(0x80 | (c & 63));
-         }
-         else if( c <= 0xFFFF )
-         {
-            ADD_HASH(0xE0 | (c >> 12));
-            ADD_HASH(0x80 | ((c >> 6) & 63));
-            ADD_HASH(0x80 | (c & 63));
-         }
-         else
-         {
-            ADD_HASH(0xF0 | (c >> 18));
-            ADD_HASH(0x80 | ((c >> 12) & 63));
-            ADD_HASH(0x80 | ((c >> 6) & 63) );
-            ADD_HASH(0x80 | (c & 63) );
-         }
-      }
-   }
-   else
+      return hashChar16(0, __w, length);
    #endif
-   for(int i=0;i<length;i++)
-      result = result*223 + ((unsigned char *)__s)[i];
+   return hashBytes(0, (const unsigned char *)__s, length);
+}
 
+unsigned int String::cachedHash() const
+{
+   // The header bit alone could be string data before a pointer into some other buffer,
+   //  so only use the slot of a real allocation big enough to hold it
+   unsigned int *slot = hashSlot();
+   if (!hx::IsAllocStart(__s, (int)((char *)(slot+1) - __s)))
+      return calcHash();
+
+   // 0 means not calculated yet - a string that really hashes to 0 is just recalculated
+   unsigned int result = *slot;
+   if (!result)
+      *slot = result = calcHash();
    return result;
 }
 
+bool __hxcpp_string_hash_is_cached(const ::String &inString)
+{
+   const char *s = inString.raw_ptr();
+   if (!s || !(s[HX_GC_STRING_HASH_OFFSET] & HX_GC_STRING_HASH_SLOT_BIT))
+      return false;
+   unsigned int *slot = inString.hashSlot();
+   return hx::IsAllocStart(s, (int)((char *)(slot+1) - s)) && *slot!=0;
+}
+
 
 
 // InternalCreateConstBuffer is not uft16 aware whenit come to hashes
@@ -1143,6 +1411,7 @@ String String::__URLDecode() const
       return _hx_utf8_to_utf16((const unsigned char *)decoded, d-decoded,false);
    #endif
 
+   shrinkString(decoded, d - decoded);
    return String( decoded, (d - decoded) );
 }
 
@@ -1499,27 +1768,15 @@ String _hx_utf8_to_utf16(const unsigned char *ptr, int inUtf8Len, bool addHash)
       for(int i=0;i<inUtf8Len;i++)
          hash = hash*223 + ptr[i];
 
-   int char16Count = 0;
-   const unsigned char *u = ptr;
    const unsigned char *end = ptr + inUtf8Len;
-   while(u<end)
-   {
-      int code = DecodeAdvanceUTF8(u,end);
-      char16Count += UTF16BytesCheck(code);
-   }
+   int char16Count = Utf8ToUtf16Length(ptr,end);
 
    int allocSize = 2*(char16Count+1);
    if (addHash)
       allocSize += sizeof(int);
    char16_t *str = (char16_t *)NewGCPrivate(0,allocSize);
 
-   u = ptr;
-   char16_t *o = str;
-   while(u<end)
-   {
-      int code = DecodeAdvanceUTF8(u,end);
-      Char16AdvanceSet(o,code);
-   }
+   Utf8ToUtf16Copy(ptr,end,str);
    if (addHash)
    {
       #ifdef EMSCRIPTEN
@@ -1536,6 +1793,19 @@ String _hx_utf8_to_utf16(const unsigned char *ptr, int inUtf8Len, bool addHash)
 }
 #endif
 
+const char16_t *_hx_utf8_to_utf16_buffer(const unsigned char *ptr, int inUtf8Len, hx::IStringAlloc *inBuffer, int *outCharLength)
+{
+   const unsigned char *end = ptr + inUtf8Len;
+   int char16Count = Utf8ToUtf16Length(ptr,end);
+
+   char16_t *str = (char16_t *)inBuffer->allocBytes(2*(char16Count+1));
+   Utf8ToUtf16Copy(ptr,end,str);
+   str[char16Count] = 0;
+   if (outCharLength)
+      *outCharLength = char16Count;
+   return str;
+}
+
 
 void __hxcpp_string_of_bytes(Array<unsigned char> &inBytes,String &outString,int pos,int len,bool inCopyPointer)
 {
@@ -1547,14 +1817,7 @@ void __hxcpp_string_of_bytes(Array<unsigned char> &inBytes,String &outString,int
    {
       const unsigned char *p0 = (const unsigned char *)inBytes->GetBase();
       #ifdef HX_SMART_STRINGS
-      bool hasWChar = false;
-      const unsigned char *p = p0 + pos;
-      for(int i=0;i<len;i++)
-         if (p[i]>127)
-         {
-            hasWChar = true;
-            break;
-         }
+      bool hasWChar = Utf8AsciiRun(p0+pos,len)<len;
       if (hasWChar)
       {
          outString = _hx_utf8_to_utf16(p0+pos,len,true);
@@ -1734,26 +1997,14 @@ const char16_t * String::wc_str(hx::IStringAlloc *inBuffer, int *outCharLength)
    }
    #endif
 
-   int char16Count = 0;
    const unsigned char *ptr = (const unsigned char *)__s;
-   const unsigned char *u = ptr;
-   const unsigned char *end = u + length;
-   while(u<end)
-   {
-      int code = DecodeAdvanceUTF8(u,end);
-      char16Count += UTF16BytesCheck(code);
-   }
+   const unsigned char *end = ptr + length;
+   int char16Count = Utf8ToUtf16Length(ptr,end);
 
    char16_t *str = inBuffer ? (char16_t *)inBuffer->allocBytes(2*(char16Count+1)) :
                               (char16_t *)NewGCPrivate(0,2*(char16Count+1));
 
-   u = ptr;
-   char16_t *o = str;
-   while(u<end)
-   {
-      int code = DecodeAdvanceUTF8(u,end);
-      Char16AdvanceSet(o,code);
-   }
+   char16_t *o = Utf8ToUtf16Copy(ptr,end,str);
    *o = 0;
    if (outCharLength != 0) {
       *outCharLength = char16Count;
@@ -2034,31 +2285,17 @@ String String::operator+(const String &inRHS) const
    bool ws1 = inRHS.isUTF16Encoded();
    if (ws0 || ws1)
    {
-      char16_t *result = String::allocChar16Ptr(l);
-
       if (ws0)
-         memcpy(result,__w,length*2);
-      else
-         for(int i=0;i<length;i++)
-            result[i] = __s[i];
-
-      char16_t *r2 = result + length;
-      if (ws1)
-         memcpy(r2, inRHS.__w, inRHS.length*2);
-      else
-         for(int i=0;i<inRHS.length;i++)
-            r2[i] = inRHS.__s[i];
-
-      return String(result,l);
+      {
+         if (ws1)
+            return String(concatChars<char16_t>(__w,length,inRHS.__w,inRHS.length),l);
+         return String(concatChars<char16_t>(__w,length,inRHS.__s,inRHS.length),l);
+      }
+      return String(concatChars<char16_t>(__s,length,inRHS.__w,inRHS.length),l);
    }
    #endif
 
-
-   char *result = hx::NewString(l);
-   memcpy(result,__s,length*sizeof(char));
-   memcpy(result+length,inRHS.__s,inRHS.length*sizeof(char));
-   result[l] = '\0';
-   return String(result,l);
+   return String(concatChars<char>(__s,length,inRHS.__s,inRHS.length),l);
 }
 
 
@@ -2070,39 +2307,7 @@ String &String::operator+=(const String &inRHS)
    }
    else if (inRHS.length>0)
    {
-      int l = length + inRHS.length;
-      #ifdef HX_SMART_STRINGS
-      bool ws0 = isUTF16Encoded();
-      bool ws1 = inRHS.isUTF16Encoded();
-      if (ws0 || ws1)
-      {
-         char16_t *result = String::allocChar16Ptr(l);
-
-         if (ws0)
-            memcpy(result,__w,length*2);
-         else
-            for(int i=0;i<length;i++)
-               result[i] = __s[i];
-
-         char16_t *r2 = result + length;
-         if (ws1)
-            memcpy(r2, inRHS.__w, inRHS.length*2);
-         else
-            for(int i=0;i<inRHS.length;i++)
-               r2[i] = inRHS.__s[i];
-
-         __w = result;
-      }
-      else
-      #endif
-      {
-      char *s = hx::NewString(l);
-      memcpy(s,__s,length*sizeof(char));
-      memcpy(s+length,inRHS.__s,inRHS.length*sizeof(char));
-      __s = s;
-      }
-
-      length = l;
+      *this = *this + inRHS;
    }
    return *this;
 }
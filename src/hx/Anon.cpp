@@ -226,6 +226,38 @@ hx::Val Anon_obj::__Field(const String &inName, hx::PropertyAccess inCallProp)
    return __string_hash_get(mFields,inName);
 }
 
+// Check the slot a cache last saw before falling back to a full search
+inline int Anon_obj::findCached(const ::String &inKey, int inSlot)
+{
+   if (inSlot>=0 && inSlot<mFixedFields)
+   {
+      const String &key = getFixed()[inSlot].key;
+      if (key.__s==inKey.__s)
+         return inSlot;
+      #ifdef HX_SMART_STRINGS
+      if (inKey.isAsciiEncodedQ())
+      #endif
+      if (HX_QSTR_EQ_AE(key,inKey))
+         return inSlot;
+   }
+   return findFixed(inKey);
+}
+
+hx::Val Anon_obj::__CachedField(const String &inName, int &ioSlot)
+{
+   int slot = findCached(inName, ioSlot);
+   if (slot>=0)
+   {
+      ioSlot = slot;
+      return getFixed()[slot].value;
+   }
+
+   if (!mFields.mPtr)
+      return hx::Val();
+
+   return __string_hash_get(mFields,inName);
+}
+
 bool Anon_obj::__HasField(const String &inName)
 {
    if (findFixed(inName)>=0)
@@ -283,6 +315,24 @@ hx::Val Anon_obj::__SetField(const String &inName,const hx::Val &inValue, hx::Pr
    return inValue;
 }
 
+hx::Val Anon_obj::__CachedSetField(const String &inName,const hx::Val &inValue, int &ioSlot)
+{
+   int slot = findCached(inName, ioSlot);
+   if (slot<0)
+      return __SetField(inName,inValue,HX_PROP_DYNAMIC);
+   ioSlot = slot;
+
+   #ifdef HXCPP_GC_GENERATIONAL
+   VariantKey *fixed = getFixed() + slot;
+   fixed->value=inValue;
+   if (fixed->value.type <= cpp::Variant::typeString)
+      HX_OBJ_WB_GET(this, fixed->value.valObject);
+   #else
+   getFixed()[slot].value=inValue;
+   #endif
+   return inValue;
+}
+
 Anon_obj *Anon_obj::Add(const String &inName,const Dynamic &inValue,bool inSetThisPointer)
 {
    // TODO - fixed
@@ -405,6 +455,160 @@ Anon SourceInfo(String inFile, int inLine, String inClass, String inMethod)
    return result;
 }
 
+// -- FieldCache -------------------------------------------------
+
+enum { FIELD_CACHE_MAX_MISSES = 16 };
+
+#ifdef HXCPP_SCRIPTABLE
+// Entries are filled in before being published with a release store and read
+//  with an acquire load, so readers on other threads see either the old entry or
+//  a complete new one.  Replaced entries are not freed, which is bounded by
+//  FIELD_CACHE_MAX_MISSES per site.
+struct FieldCacheMember
+{
+   hx::Class_obj *cls;
+   int           offset;
+   FieldStorage  type;
+   bool          canGet;
+   bool          canSet;
+};
+
+static bool classHasMember(hx::Class_obj *inClass, const String &inName)
+{
+   for(hx::Class_obj *cls = inClass; cls; cls = cls->mSuper ? cls->mSuper->mPtr : 0)
+   {
+      Array<String> &members = cls->mMembers;
+      if (members.mPtr)
+         for(int i=0;i<members->length;i++)
+            if (members[i]==inName)
+               return true;
+   }
+   return false;
+}
+
+static inline FieldCacheMember *loadCachedMember(FieldCache &ioCache)
+{
+   #if defined(HX_GCC_ATOMICS)
+   return __atomic_load_n(&ioCache.member, __ATOMIC_ACQUIRE);
+   #else
+   return *(FieldCacheMember * volatile *)&ioCache.member;
+   #endif
+}
+
+static inline void publishCachedMember(FieldCache &ioCache, FieldCacheMember *inMember)
+{
+   #if defined(HX_GCC_ATOMICS)
+   __atomic_store_n(&ioCache.member, inMember, __ATOMIC_RELEASE);
+   #elif defined(HX_MSVC_ATOMICS)
+   _InterlockedExchangePointer((void * volatile *)&ioCache.member, inMember);
+   #else
+   *(FieldCacheMember * volatile *)&ioCache.member = inMember;
+   #endif
+}
+
+// Only plain storage of host classes can be read directly - script classes
+//  and fields with accessors go through __Field so getters still run.
+static FieldCacheMember *findCachedMember(FieldCache &ioCache, hx::Object *inObj, const String &inName)
+{
+   hx::Class_obj *cls = inObj->__GetClass().mPtr;
+   FieldCacheMember *member = loadCachedMember(ioCache);
+   if (member && member->cls==cls)
+      return member;
+
+   if (!cls || ioCache.misses>=FIELD_CACHE_MAX_MISSES || inObj->__GetScriptVTable())
+      return 0;
+   ioCache.misses++;
+
+   const StorageInfo *store = cls->GetMemberStorage(inName);
+   if (!store)
+      return 0;
+   switch(store->type)
+   {
+      case fsBool: case fsInt: case fsFloat: case fsString: case fsObject:
+         break;
+      default:
+         return 0;
+   }
+
+   member = new FieldCacheMember();
+   member->cls = cls;
+   member->offset = store->offset;
+   member->type = store->type;
+   member->canGet = !classHasMember(cls, HX_CSTRING("get_") + inName);
+   // Object storage is declared with a concrete type (Array<Int>, a class, ...) that
+   //  may need a conversion, so only __SetField can store into it.
+   member->canSet = store->type!=fsObject && !classHasMember(cls, HX_CSTRING("set_") + inName);
+   publishCachedMember(ioCache, member);
+   return member;
+}
+#endif
+
+hx::Val FieldCacheGet(FieldCache &ioCache, hx::Object *inObj, const String &inName, hx::PropertyAccess inCallProp)
+{
+   if (!inObj)
+   {
+      NullReference("Object", false);
+      return hx::Val();
+   }
+
+   if (inObj->__GetClass().mPtr==Anon_obj::__mClass.mPtr)
+      return static_cast<Anon_obj *>(inObj)->__CachedField(inName, ioCache.anonSlot);
+
+   #ifdef HXCPP_SCRIPTABLE
+   FieldCacheMember *member = findCachedMember(ioCache, inObj, inName);
+   if (member && member->canGet)
+   {
+      char *field = (char *)inObj + member->offset;
+      switch(member->type)
+      {
+         case fsBool: return *(bool *)field;
+         case fsInt: return *(int *)field;
+         case fsFloat: return *(Float *)field;
+         case fsString: return *(String *)field;
+         default: return *(hx::Object **)field;
+      }
+   }
+   #endif
+
+   return inObj->__Field(inName, inCallProp);
+}
+
+hx::Val FieldCacheSet(FieldCache &ioCache, hx::Object *inObj, const String &inName, const hx::Val &inValue, hx::PropertyAccess inCallProp)
+{
+   if (!inObj)
+   {
+      NullReference("Object", false);
+      return inValue;
+   }
+
+   if (inObj->__GetClass().mPtr==Anon_obj::__mClass.mPtr)
+      return static_cast<Anon_obj *>(inObj)->__CachedSetField(inName, inValue, ioCache.anonSlot);
+
+   #ifdef HXCPP_SCRIPTABLE
+   FieldCacheMember *member = findCachedMember(ioCache, inObj, inName);
+   if (member && member->canSet)
+   {
+      char *field = (char *)inObj + member->offset;
+      switch(member->type)
+      {
+         case fsBool: *(bool *)field = inValue.asInt(); break;
+         case fsInt: *(int *)field = inValue.asInt(); break;
+         case fsFloat: *(Float *)field = inValue.asDouble(); break;
+         case fsString:
+            *(String *)field = inValue.asString();
+            HX_OBJ_WB_GET(inObj, ((String *)field)->raw_ref());
+            break;
+         default: ;
+      }
+      return inValue;
+   }
+   #endif
+
+   return inObj->__SetField(inName, inValue, inCallProp);
+}
+
+
+
 String StringFromAnonFields(hx::Object *inPtr)
 {
    Array<String> fields = Array_obj<String>::__new();
@@ -1,6 +1,12 @@
 #include <hxcpp.h>
 #include "Hash.h"
 
+#ifdef HXCPP_FLAT_HASH
+#define HX_MAP_HASH hx::FlatHash
+#else
+#define HX_MAP_HASH hx::Hash
+#endif
+
 
 using namespace hx;
 
@@ -21,11 +27,11 @@ int __root_hash_size(Dynamic &rtHash)
 namespace
 {
 typedef hx::HashBase<int>                   IntHashBase;
-typedef hx::Hash< TIntElement<Dynamic> >    IntHashObject;
-typedef hx::Hash< TIntElement<int> >        IntHashInt;
-typedef hx::Hash< TIntElement<Float> >      IntHashFloat;
-typedef hx::Hash< TIntElement<String> >     IntHashString;
-typedef hx::Hash< TIntElement<cpp::Int64> > IntHashInt64;
+typedef HX_MAP_HASH< TIntElement<Dynamic> >    IntHashObject;
+typedef HX_MAP_HASH< TIntElement<int> >        IntHashInt;
+typedef HX_MAP_HASH< TIntElement<Float> >      IntHashFloat;
+typedef HX_MAP_HASH< TIntElement<String> >     IntHashString;
+typedef HX_MAP_HASH< TIntElement<cpp::Int64> > IntHashInt64;
 }
 
 void __int_hash_set(HX_MAP_THIS_ARG,int inKey,const Dynamic &value)
@@ -300,11 +306,11 @@ void __int_hash_clear(Dynamic &ioHash)
 namespace
 {
 typedef hx::HashBase<cpp::Int64>              Int64HashBase;
-typedef hx::Hash< TInt64Element<Dynamic> >    Int64HashObject;
-typedef hx::Hash< TInt64Element<int> >        Int64HashInt;
-typedef hx::Hash< TInt64Element<Float> >      Int64HashFloat;
-typedef hx::Hash< TInt64Element<String> >     Int64HashString;
-typedef hx::Hash< TInt64Element<cpp::Int64> > Int64HashInt64;
+typedef HX_MAP_HASH< TInt64Element<Dynamic> >    Int64HashObject;
+typedef HX_MAP_HASH< TInt64Element<int> >        Int64HashInt;
+typedef HX_MAP_HASH< TInt64Element<Float> >      Int64HashFloat;
+typedef HX_MAP_HASH< TInt64Element<String> >     Int64HashString;
+typedef HX_MAP_HASH< TInt64Element<cpp::Int64> > Int64HashInt64;
 }
 
 void __int64_hash_set(HX_MAP_THIS_ARG, cpp::Int64 inKey, const Dynamic &value)
@@ -569,11 +575,11 @@ void __int64_hash_clear(Dynamic &ioHash)
 namespace
 {
 typedef hx::HashBase<String>                    StringHashBase;
-typedef hx::Hash< TStringElement<Dynamic> >     StringHashObject;
-typedef hx::Hash< TStringElement<int> >         StringHashInt;
-typedef hx::Hash< TStringElement<Float> >       StringHashFloat;
-typedef hx::Hash< TStringElement<String> >      StringHashString;
-typedef hx::Hash< TStringElement<cpp::Int64> >  StringHashInt64;
+typedef HX_MAP_HASH< TStringElement<Dynamic> >     StringHashObject;
+typedef HX_MAP_HASH< TStringElement<int> >         StringHashInt;
+typedef HX_MAP_HASH< TStringElement<Float> >       StringHashFloat;
+typedef HX_MAP_HASH< TStringElement<String> >      StringHashString;
+typedef HX_MAP_HASH< TStringElement<cpp::Int64> >  StringHashInt64;
 }
 
 
@@ -923,17 +929,17 @@ namespace
 {
 typedef hx::HashBase<Dynamic>                DynamicHashBase;
 
-typedef hx::Hash< TDynamicElement<Dynamic,false> > DynamicHashObject;
-typedef hx::Hash< TDynamicElement<int,false> >    DynamicHashInt;
-typedef hx::Hash< TDynamicElement<Float,false> >   DynamicHashFloat;
-typedef hx::Hash< TDynamicElement<String,false> >  DynamicHashString;
-typedef hx::Hash< TDynamicElement<cpp::Int64,false> >  DynamicHashInt64;
-
-typedef hx::Hash< TDynamicElement<Dynamic,true> > WeakDynamicHashObject;
-typedef hx::Hash< TDynamicElement<int,true> >    WeakDynamicHashInt;
-typedef hx::Hash< TDynamicElement<Float,true> >   WeakDynamicHashFloat;
-typedef hx::Hash< TDynamicElement<String,true> >  WeakDynamicHashString;
-typedef hx::Hash< TDynamicElement<cpp::Int64,true> >  WeakDynamicHashInt64;
+typedef HX_MAP_HASH< TDynamicElement<Dynamic,false> > DynamicHashObject;
+typedef HX_MAP_HASH< TDynamicElement<int,false> >    DynamicHashInt;
+typedef HX_MAP_HASH< TDynamicElement<Float,false> >   DynamicHashFloat;
+typedef HX_MAP_HASH< TDynamicElement<String,false> >  DynamicHashString;
+typedef HX_MAP_HASH< TDynamicElement<cpp::Int64,false> >  DynamicHashInt64;
+
+typedef HX_MAP_HASH< TDynamicElement<Dynamic,true> > WeakDynamicHashObject;
+typedef HX_MAP_HASH< TDynamicElement<int,true> >    WeakDynamicHashInt;
+typedef HX_MAP_HASH< TDynamicElement<Float,true> >   WeakDynamicHashFloat;
+typedef HX_MAP_HASH< TDynamicElement<String,true> >  WeakDynamicHashString;
+typedef HX_MAP_HASH< TDynamicElement<cpp::Int64,true> >  WeakDynamicHashInt64;
 
 #define toRealObject(x)
 }
@@ -1,6 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef HXCPP_FLAT_HASH
+   #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+      #include <emmintrin.h>
+      #define HX_FLAT_HASH_SSE2
+   #endif
+   #ifdef _MSC_VER
+      #include <intrin.h>
+   #endif
+#endif
+
 #ifdef HXCPP_TELEMETRY
 extern void __hxt_new_hash(void* obj, int size);
 #endif
@@ -601,7 +611,10 @@ struct Hash : public HashBase< typename ELEMENT::Key >
       el->next = bucket[hash&mask];
       bucket[hash&mask] = el;
 
-      #ifdef HXCPP_GC_GENERATIONAL
+      #if defined(HXCPP_GC_CONCURRENT)
+      // The new element is not marked yet
+      HX_OBJ_WB_PESSIMISTIC_GET(this);
+      #elif defined(HXCPP_GC_GENERATIONAL)
       unsigned char &mark =  ((unsigned char *)(this))[ HX_ENDIAN_MARK_ID_BYTE];
       if (mark == hx::gByteMarkID)
       {
@@ -654,7 +667,8 @@ struct Hash : public HashBase< typename ELEMENT::Key >
 
       Converter(NEW *inResult) : result(inResult) { }
 
-      void operator()(typename Hash::Element *elem)
+      template<typename ELEM>
+      void operator()(ELEM *elem)
       {
          result->set(elem->key,elem->value);
       }
@@ -686,7 +700,8 @@ struct Hash : public HashBase< typename ELEMENT::Key >
       {
          array = Array<Key>(0,inReserve);
       }
-      void operator()(typename Hash::Element *elem)
+      template<typename ELEM>
+      void operator()(ELEM *elem)
       {
          array->push(elem->key);
       }
@@ -708,7 +723,8 @@ struct Hash : public HashBase< typename ELEMENT::Key >
          array = Array<ArrayValue>(0,inReserve);
       }
 
-      void operator()(typename Hash::Element *elem)
+      template<typename ELEM>
+      void operator()(ELEM *elem)
       {
          array->push(elem->value);
       }
@@ -739,7 +755,8 @@ struct Hash : public HashBase< typename ELEMENT::Key >
             #endif
          }
       }
-      void operator()(typename Hash::Element *elem)
+      template<typename ELEM>
+      void operator()(ELEM *elem)
       {
          if (array->length>1)
             array->push(HX_CSTRING(", "));
@@ -823,5 +840,528 @@ struct Hash : public HashBase< typename ELEMENT::Key >
 };
 
 
+
+#ifdef HXCPP_FLAT_HASH
+
+// --- FlatHash ---------------------------------------------------
+//
+// Open-addressing alternative to Hash, used by the maps when HXCPP_FLAT_HASH is defined.
+// Entries are stored inline in a single table - a control byte per slot followed by the
+//  slots themselves - so lookups do not chase element pointers, and inserts do not allocate.
+// Control bytes are either Empty, Deleted, or 7 bits of the entry hash, and are compared
+//  a group of 16 at a time (SwissTable style).
+
+enum
+{
+   flatEmpty     = 0x80,
+   flatDeleted   = 0xfe,
+   flatGroupBits = 4,
+   flatGroupSize = 1<<flatGroupBits,
+   // Capacity + alignment for the slots
+   flatHeader    = 16,
+};
+
+inline int FlatLowestBit(unsigned int inMask)
+{
+   #if defined(_MSC_VER)
+   unsigned long result;
+   _BitScanForward(&result, inMask);
+   return result;
+   #else
+   return __builtin_ctz(inMask);
+   #endif
+}
+
+struct FlatGroup
+{
+   #ifdef HX_FLAT_HASH_SSE2
+   __m128i ctrl;
+
+   inline FlatGroup(const unsigned char *inCtrl) : ctrl(_mm_loadu_si128((const __m128i *)inCtrl)) { }
+
+   // Bit n set if byte n matches
+   inline unsigned int match(unsigned char inH2) const
+   {
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)inH2)));
+   }
+   inline unsigned int matchEmpty() const { return match(flatEmpty); }
+   // Empty or deleted have the high bit set
+   inline unsigned int matchFree() const { return _mm_movemask_epi8(ctrl); }
+   #else
+   const unsigned char *ctrl;
+
+   inline FlatGroup(const unsigned char *inCtrl) : ctrl(inCtrl) { }
+
+   inline unsigned int match(unsigned char inH2) const
+   {
+      unsigned int result = 0;
+      for(int i=0;i<flatGroupSize;i++)
+         if (ctrl[i]==inH2)
+            result |= 1<<i;
+      return result;
+   }
+   inline unsigned int matchEmpty() const { return match(flatEmpty); }
+   inline unsigned int matchFree() const
+   {
+      unsigned int result = 0;
+      for(int i=0;i<flatGroupSize;i++)
+         if (ctrl[i] & 0x80)
+            result |= 1<<i;
+      return result;
+   }
+   #endif
+};
+
+
+template<typename ELEMENT>
+struct FlatHash : public HashBase< typename ELEMENT::Key >
+{
+   using HashRoot::size;
+   using HashRoot::mask;
+   using HashRoot::bucketCount;
+   using HashRoot::getSize;
+
+   typedef typename ELEMENT::Key   Key;
+   typedef typename ELEMENT::Value Value;
+   typedef typename ArrayValueOf<Value>::Value ArrayValue;
+
+   typedef ELEMENT Element;
+   typedef Hash<ELEMENT> Chained;
+   enum { IgnoreHash = Element::IgnoreHash };
+
+   struct Slot
+   {
+      Value        value;
+      Key          key;
+      unsigned int hash;
+   };
+
+   // [ capacity | ctrl bytes | slots ], so the collector always sees a consistent set
+   unsigned char *table;
+   int growthLeft;
+   int groupShift;
+
+
+   FlatHash() : HashBase<Key>( StoreOf<Value>::store )
+   {
+      table = 0;
+      growthLeft = 0;
+      groupShift = 31;
+      if (ELEMENT::WeakKeys && Element::ManageKeys)
+         RegisterWeakHash(this);
+   }
+
+   static inline int capacityOf(unsigned char *inTable) { return *(int *)inTable; }
+   static inline unsigned char *ctrlOf(unsigned char *inTable) { return inTable + flatHeader; }
+   static inline Slot *slotsOf(unsigned char *inTable) { return (Slot *)(inTable + flatHeader + capacityOf(inTable)); }
+
+   inline unsigned char *ctrl() { return table + flatHeader; }
+   inline Slot *slots() { return (Slot *)(table + flatHeader + bucketCount); }
+
+   // Int keys are their own hash, so spread them before using the bits
+   static inline unsigned int mix(unsigned int inHash)
+   {
+      unsigned int h = inHash * 0x9e3779b1U;
+      return h ^ (h>>16);
+   }
+   static inline unsigned char h2Of(unsigned int inMixed) { return inMixed & 0x7f; }
+   inline int firstGroup(unsigned int inMixed) { return (inMixed>>groupShift) & mask; }
+
+   template<typename T>
+   bool TIsWeakRefValid(T &) { return true; }
+   bool TIsWeakRefValid(Dynamic &key) { return IsWeakRefValid(key.mPtr); }
+   bool TIsWeakRefValid(String &key) { return IsWeakRefValid(key.raw_ptr()); }
+
+
+   // Returns the slot matching inKey, or -1
+   template<typename MATCH>
+   int probe(unsigned int inHash, const MATCH &inMatch)
+   {
+      if (!table)
+         return -1;
+      unsigned int mixed = mix(inHash);
+      unsigned char h2 = h2Of(mixed);
+      unsigned char *c = ctrl();
+      Slot *s = slots();
+      int group = firstGroup(mixed);
+      for(int step=1; ; step++)
+      {
+         int base = group<<flatGroupBits;
+         FlatGroup g(c + base);
+         for(unsigned int m = g.match(h2); m; m &= m-1)
+         {
+            int idx = base + FlatLowestBit(m);
+            if ( (IgnoreHash || s[idx].hash==inHash) && inMatch==s[idx].key)
+               return idx;
+         }
+         if (g.matchEmpty())
+            return -1;
+         // Triangular steps visit every group
+         group = (group+step) & mask;
+      }
+   }
+
+   struct KeyMatch
+   {
+      const Key &key;
+      KeyMatch(const Key &inKey) : key(inKey) { }
+      inline bool operator==(const Key &inKey) const { return inKey==key; }
+   };
+
+   inline int findSlot(unsigned int inHash, const Key &inKey)
+   {
+      return probe(inHash, KeyMatch(inKey));
+   }
+
+   // First empty or deleted slot on the probe sequence
+   static int findFree(unsigned char *inCtrl, int inMask, int inGroupShift, unsigned int inMixed)
+   {
+      int group = (inMixed>>inGroupShift) & inMask;
+      for(int step=1; ; step++)
+      {
+         int base = group<<flatGroupBits;
+         unsigned int m = FlatGroup(inCtrl + base).matchFree();
+         if (m)
+            return base + FlatLowestBit(m);
+         group = (group+step) & inMask;
+      }
+   }
+
+   void resize(int inCapacity)
+   {
+      #ifdef HXCPP_TELEMETRY
+      bool is_new = table==0;
+      #endif
+      int groups = inCapacity>>flatGroupBits;
+      int newMask = groups-1;
+      int bits = 0;
+      while( (1<<bits) < groups )
+         bits++;
+      int newShift = bits ? 32-bits : 31;
+
+      int bytes = flatHeader + inCapacity + inCapacity*sizeof(Slot);
+      unsigned char *newTable = (unsigned char *)InternalNew(bytes,false);
+      *(int *)newTable = inCapacity;
+      unsigned char *newCtrl = ctrlOf(newTable);
+      Slot *newSlots = slotsOf(newTable);
+      memset(newCtrl, flatEmpty, inCapacity);
+
+      if (table)
+      {
+         unsigned char *c = ctrl();
+         Slot *s = slots();
+         for(int i=0;i<bucketCount;i++)
+            if ( !(c[i] & 0x80) )
+            {
+               unsigned int mixed = mix(s[i].hash);
+               int idx = findFree(newCtrl, newMask, newShift, mixed);
+               newCtrl[idx] = h2Of(mixed);
+               newSlots[idx] = s[i];
+            }
+      }
+
+      table = newTable;
+      HX_OBJ_WB_GET(this, table);
+      bucketCount = inCapacity;
+      mask = newMask;
+      groupShift = newShift;
+      // Keep at least 1/8 empty, so probes always terminate
+      growthLeft = inCapacity - (inCapacity>>3) - size;
+
+      #ifdef HXCPP_TELEMETRY
+      if (is_new) __hxt_new_hash(table, bytes);
+      #endif
+   }
+
+   void reserve(int inSize)
+   {
+      int capacity = flatGroupSize;
+      while( inSize > capacity - (capacity>>3) )
+         capacity<<=1;
+      if (capacity>bucketCount)
+         resize(capacity);
+   }
+
+   void grow()
+   {
+      if (!table)
+         resize(flatGroupSize);
+      // Mostly tombstones - clean up in place
+      else if (size < (bucketCount>>1))
+         resize(bucketCount);
+      else
+         resize(bucketCount<<1);
+   }
+
+   void eraseSlot(int inIdx)
+   {
+      unsigned char *c = ctrl();
+      // If the group was never full, no probe has gone past it, so the slot can be reused freely
+      if (FlatGroup(c + (inIdx & ~(flatGroupSize-1))).matchEmpty())
+      {
+         c[inIdx] = flatEmpty;
+         growthLeft++;
+      }
+      else
+         c[inIdx] = flatDeleted;
+      Slot &s = slots()[inIdx];
+      HashClear(s.key);
+      HashClear(s.value);
+      size--;
+   }
+
+   void updateAfterGc()
+   {
+      if (Element::WeakKeys && Element::ManageKeys && table)
+      {
+         unsigned char *c = ctrl();
+         Slot *s = slots();
+         for(int i=0;i<bucketCount;i++)
+            if ( !(c[i] & 0x80) && !TIsWeakRefValid(s[i].key) )
+               eraseSlot(i);
+      }
+   }
+
+   bool remove(Key inKey)
+   {
+      int idx = findSlot( HashCalcHash(inKey), inKey );
+      if (idx<0)
+         return false;
+      eraseSlot(idx);
+      return true;
+   }
+
+   bool exists(Key inKey) { return findSlot( HashCalcHash(inKey), inKey )>=0; }
+
+
+   HashBase<Key> *convertStore(HashStore inStore)
+   {
+      switch(inStore)
+      {
+         case hashInt:
+            return TConvertStore< typename ELEMENT::IntValue >();
+         case hashFloat:
+            return TConvertStore< typename ELEMENT::FloatValue >();
+         case hashString:
+            return TConvertStore< typename ELEMENT::StringValue >();
+         case hashObject:
+            return TConvertStore< typename ELEMENT::DynamicValue >();
+         case hashInt64:
+            return TConvertStore< typename ELEMENT::Int64Value >();
+         case hashNull:
+             ;
+      }
+      return 0;
+   }
+
+   template<typename NEW_ELEM>
+   HashBase<Key> *TConvertStore()
+   {
+      FlatHash<NEW_ELEM> *result = new FlatHash<NEW_ELEM>();
+
+      result->reserve(getSize());
+
+      typename Chained::template Converter< FlatHash<NEW_ELEM> > converter(result);
+
+      iterate(converter);
+
+      return result;
+   }
+
+
+   template<typename OUT_VALUE>
+   bool TQuery(Key inKey,OUT_VALUE &outValue)
+   {
+      int idx = findSlot( HashCalcHash(inKey), inKey );
+      if (idx<0)
+         return false;
+      CopyValue(outValue,slots()[idx].value);
+      return true;
+   }
+
+   bool query(Key inKey,int &outValue) { return TQuery(inKey,outValue); }
+   bool query(Key inKey,::String &outValue) { return TQuery(inKey,outValue); }
+   bool query(Key inKey,Float &outValue) { return TQuery(inKey,outValue); }
+   bool query(Key inKey,Dynamic &outValue) { return TQuery(inKey,outValue); }
+   bool query(Key inKey,cpp::Int64 &outValue) { return TQuery(inKey, outValue); }
+
+
+   Value get(Key inKey)
+   {
+      int idx = findSlot( HashCalcHash(inKey), inKey );
+      if (idx>=0)
+         return slots()[idx].value;
+      return 0;
+   }
+
+
+   template<typename Finder>
+   bool findEquivalentKey(Key &outKey, int inHash, const Finder &inFinder)
+   {
+      int idx = probe(inHash, inFinder);
+      if (idx<0)
+         return false;
+      outKey = slots()[idx].key;
+      return true;
+   }
+
+   static inline bool IsNursery(const void *inPtr)
+   {
+      return inPtr && !(((unsigned char *)inPtr)[ HX_ENDIAN_MARK_ID_BYTE]);
+   }
+
+   template<typename SET>
+   void TSet(Key inKey, const SET &inValue)
+   {
+      unsigned int hash = HashCalcHash(inKey);
+      int idx = findSlot(hash,inKey);
+      if (idx>=0)
+      {
+         Value &value = slots()[idx].value;
+         CopyValue(value,inValue);
+         if (hx::ContainsPointers<Value>())
+            HX_OBJ_WB_GET(this,hx::PointerOf(value));
+         return;
+      }
+
+      if (growthLeft<=0)
+         grow();
+
+      unsigned int mixed = mix(hash);
+      unsigned char *c = ctrl();
+      idx = findFree(c, mask, groupShift, mixed);
+      if (c[idx]==flatEmpty)
+         growthLeft--;
+
+      Slot &slot = slots()[idx];
+      slot.key = inKey;
+      slot.hash = hash;
+      CopyValue(slot.value,inValue);
+      c[idx] = h2Of(mixed);
+      size++;
+
+      #if defined(HXCPP_GC_CONCURRENT)
+      HX_OBJ_WB_PESSIMISTIC_GET(this);
+      #elif defined(HXCPP_GC_GENERATIONAL)
+      unsigned char &mark =  ((unsigned char *)(this))[ HX_ENDIAN_MARK_ID_BYTE];
+      if (mark == hx::gByteMarkID)
+      {
+         // Entries live in the table, so only the key and value can be new
+         if ( IsNursery(hx::PointerOf(slot.key)) ||
+             (hx::ContainsPointers<Value>() && IsNursery(hx::PointerOf(slot.value)) ) )
+         {
+            mark|=HX_GC_REMEMBERED;
+            (HX_CTX_GET)->pushReferrer(this);
+         }
+      }
+      #endif
+   }
+
+   void set(Key inKey, const int &inValue) { TSet(inKey, inValue); }
+   void set(Key inKey, const ::String &inValue)  { TSet(inKey, inValue); }
+   void set(Key inKey, const Float &inValue)  { TSet(inKey, inValue); }
+   void set(Key inKey, const Dynamic &inValue)  { TSet(inKey, inValue); }
+   void set(Key inKey, const null &inValue)  { TSet(inKey, inValue);  }
+   void set(Key inKey, const cpp::Int64 &inValue) { TSet(inKey, inValue); }
+
+   void clear()
+   {
+      table = 0;
+      size = 0;
+      mask = 0;
+      bucketCount = 0;
+      growthLeft = 0;
+      groupShift = 31;
+   }
+
+
+   // Visits live entries in slot order
+   template<typename F>
+   void iterate(F &inFunc)
+   {
+      if (!table)
+         return;
+      unsigned char *c = ctrl();
+      Slot *s = slots();
+      for(int i=0;i<bucketCount;i++)
+         if ( !(c[i] & 0x80) )
+            inFunc(&s[i]);
+   }
+
+   Array<Key> keys()
+   {
+      typename Chained::KeyBuilder builder(getSize());
+      iterate(builder);
+      return builder.array;
+   }
+
+   Dynamic values()
+   {
+      typename Chained::ValueBuilder builder(getSize());
+      iterate(builder);
+      return builder.array;
+   }
+
+   String toString()
+   {
+      typename Chained::StringBuilder builder(getSize());
+      iterate(builder);
+      return builder.toString();
+   }
+
+   String toStringRaw()
+   {
+      typename Chained::StringBuilder builder(getSize(),true);
+      iterate(builder);
+      return builder.toString();
+   }
+
+
+   void __Mark(hx::MarkContext *__inCtx)
+   {
+      // Read once - the capacity comes from the same table
+      unsigned char *t = table;
+      if (!t)
+         return;
+      HX_MARK_ARRAY(t);
+      if (!hx::ContainsPointers<Value>() && (Element::WeakKeys || !hx::ContainsPointers<Key>()) )
+         return;
+
+      int capacity = capacityOf(t);
+      unsigned char *c = ctrlOf(t);
+      Slot *s = slotsOf(t);
+      for(int i=0;i<capacity;i++)
+         if ( !(c[i] & 0x80) )
+         {
+            if (!Element::WeakKeys)
+            {
+               HX_MARK_MEMBER(s[i].key);
+            }
+            HX_MARK_MEMBER(s[i].value);
+         }
+   }
+
+#ifdef HXCPP_VISIT_ALLOCS
+
+   void __Visit(hx::VisitContext *__inCtx)
+   {
+      if (!table)
+         return;
+      HX_VISIT_ARRAY(table);
+      unsigned char *c = ctrl();
+      Slot *s = slots();
+      for(int i=0;i<bucketCount;i++)
+         if ( !(c[i] & 0x80) )
+         {
+            HX_VISIT_MEMBER(s[i].key);
+            HX_VISIT_MEMBER(s[i].value);
+         }
+   }
+#endif
+};
+
+#endif // HXCPP_FLAT_HASH
+
+
 } // end namespace hx
 
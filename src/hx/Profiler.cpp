@@ -1,9 +1,33 @@
 #include <hxcpp.h>
 #include <map>
 #include <vector>
+#include <string>
+#include <algorithm>
 #include <hx/Thread.h>
 #include <hx/OS.h>
 
+// Where per-thread cpu timers are available, each profiled thread gets a SIGPROF for
+//  every millisecond of cpu it uses and the stack is captured there, so leaf code and
+//  loops without calls are seen too.  A thread that is blocked uses no cpu, so its
+//  sleeps and waits are never interrupted.
+#if (defined(HX_LINUX) || defined(HX_ANDROID)) && !defined(__CYGWIN__)
+   #define HX_PROFILE_SIGNAL
+   #include <signal.h>
+   #include <pthread.h>
+   #include <errno.h>
+   #include <time.h>
+   #include <unistd.h>
+   #include <sys/syscall.h>
+   #ifndef sigev_notify_thread_id
+      #define sigev_notify_thread_id _sigev_un._tid
+   #endif
+   #if defined(__GNUC__) || defined(__clang__)
+      #define HX_SIGNAL_FENCE() __asm__ __volatile__("" ::: "memory")
+   #else
+      #define HX_SIGNAL_FENCE()
+   #endif
+#endif
+
 
 
 #ifdef HX_WINRT
@@ -33,23 +57,77 @@ namespace hx
 {
 
 // Profiler functionality separated into this class
+//
+// Each tick, the current stack is reduced to a single node id in a call tree, and the
+//  time is added to that node.  The nodes and their lookup table are allocated up-front
+//  and only grow when a new call path is seen, so sampling a known stack just walks the
+//  frames and compares pointers.
+//
+// The output format comes from the dump file extension:
+//   .folded          - "a;b;c count" lines, for flamegraph.pl and friends
+//   .pb / .pprof     - uncompressed pprof protobuf
+//   anything else    - the flat text report
+//
+// With HX_PROFILE_SIGNAL, the SIGPROF handler copies the frame names into a ring that
+//  only it writes, and the owning thread folds them into the tree on its next call
+//  (or at dump time), so nothing in the handler locks or allocates.  Samples are then
+//  cpu time.  Elsewhere, the stack is sampled when a frame is pushed and the clock
+//  thread has moved on, which gives wall time.
 class Profiler
 {
 public:
 
-    Profiler(const String &inDumpFile)
+    Profiler(const String &inDumpFile, StackContext *inContext)
         : mT0(0)
     {
         mDumpFile = inDumpFile;
+        mContext = inContext;
+
+        mNodes.reserve(INITIAL_NODES);
+        mNodes.push_back( Node(0,-1) );
+        mLookup.resize(INITIAL_NODES*2, -1);
+        mPath.reserve(256);
+
+        #ifdef HX_PROFILE_SIGNAL
+        mRing = new const char *[RING_SIZE];
+        mRingHead = mRingTail = 0;
+        mDropped = 0;
+        mHasTimer = false;
+        // The handler may interrupt a push, so make sure the frame array is not
+        //  reallocated under it for any reasonable depth
+        mContext->mStackFrames.safeReserveExtra(RESERVED_FRAMES);
+        #endif
 
-        // When a profiler exists, the profiler thread needs to exist
         gThreadMutex.Lock();
 
+        #ifdef HX_PROFILE_SIGNAL
+        if (!gSignalInstalled) {
+            struct sigaction action;
+            memset(&action, 0, sizeof(action));
+            action.sa_handler = onProfileSignal;
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            gSignalInstalled = sigaction(SIGPROF, &action, 0) == 0;
+        }
+        for (int i = 0; gSignalInstalled && i < MAX_THREADS; i++) {
+            if (!gThreads[i].profiler) {
+                gThreads[i].thread = pthread_self();
+                gThreads[i].profiler = this;
+                mHasTimer = startTimer();
+                if (!mHasTimer) {
+                    gThreads[i].profiler = 0;
+                    DBGLOG("Profiler: could not create a cpu timer for this thread\n");
+                }
+                break;
+            }
+        }
+        #else
+        // When a profiler exists, the profiler thread needs to exist
         gThreadRefCount += 1;
-
         if (gThreadRefCount == 1) {
             HxCreateDetachedThread(ProfileMainLoop, 0);
         }
+        #endif
 
         gThreadMutex.Unlock();
     }
@@ -58,13 +136,34 @@ public:
     {
         gThreadMutex.Lock();
 
+        #ifdef HX_PROFILE_SIGNAL
+        if (mHasTimer) {
+            timer_delete(mTimer);
+        }
+        // A signal that was already pending is ignored once the slot is clear
+        for (int i = 0; i < MAX_THREADS; i++) {
+            if (gThreads[i].profiler == this) {
+                gThreads[i].profiler = 0;
+            }
+        }
+        #else
         gThreadRefCount -= 1;
+        #endif
 
         gThreadMutex.Unlock();
+
+        #ifdef HX_PROFILE_SIGNAL
+        delete [] mRing;
+        #endif
     }
 
    void sample(hx::StackContext *stack)
    {
+       #ifdef HX_PROFILE_SIGNAL
+       if (mRingHead != mRingTail) {
+           drain();
+       }
+       #else
        if (mT0 == gProfileClock) {
            return;
        }
@@ -78,33 +177,22 @@ public:
        }
        mT0 = clock;
 
-       int depth = stack->getDepth();
-
-       std::map<const char *, bool> alreadySeen;
-
-       // Add children time in to each stack element
-       for (int i = 0; i < (depth - 1); i++) {
-           const char *fullName = stack->getFullNameAtDepth(i);
-           ProfileEntry &pe = mProfileStats[fullName];
-           if (!alreadySeen.count(fullName)) {
-               pe.total += delta;
-               alreadySeen[fullName] = true;
-           }
-           // For everything except the very bottom of the stack, add the time to
-           // that child's total with this entry
-           pe.children[stack->getFullNameAtDepth(i + 1)] += delta;
-       }
-
-       // Add the time into the actual function being executed
-       if (depth > 0) {
-           mProfileStats[stack->getFullNameAtDepth(depth - 1)].self += delta;
-       }
+       StackNames names = { stack };
+       addSample(names, stack->getDepth(), delta);
+       #endif
    }
 
 
 
     void DumpStats()
     {
+        #ifdef HX_PROFILE_SIGNAL
+        drain();
+        if (mDropped) {
+            DBGLOG("Profiler: dropped %d samples\n", (int)mDropped);
+        }
+        #endif
+
         FILE *out = 0;
         if (mDumpFile.length > 0)
         {
@@ -115,14 +203,414 @@ public:
             }
         }
 
+        std::string file = mDumpFile.length > 0 ? mDumpFile.c_str() : "";
+        if (endsWith(file, ".folded"))
+            dumpFolded(out);
+        else if (out && (endsWith(file, ".pb") || endsWith(file, ".pprof")))
+            dumpPprof(out);
+        else
+            dumpReport(out);
+
+        if (out) {
+            fclose(out);
+        }
+    }
+
+private:
+
+    enum { INITIAL_NODES = 4096 };
+
+    struct StackNames
+    {
+        hx::StackContext *stack;
+        const char *operator[](int inDepth) const { return stack->getFullNameAtDepth(inDepth); }
+    };
+
+    template<typename NAMES>
+    void addSample(const NAMES &inNames, int inDepth, int inDelta)
+    {
+       // Most samples share a long prefix with the previous one, so start from there
+       int same = 0;
+       int known = std::min(inDepth, (int)mPath.size());
+       while (same < known && mPath[same].name == inNames[same])
+           same++;
+
+       mPath.resize(inDepth);
+       int node = same ? mPath[same-1].node : 0;
+       for (int i = same; i < inDepth; i++) {
+           const char *fullName = inNames[i];
+           node = findChild(node, fullName);
+           mPath[i].name = fullName;
+           mPath[i].node = node;
+       }
+
+       mNodes[node].self += inDelta;
+    }
+
+    #ifdef HX_PROFILE_SIGNAL
+    // Ring entries are a depth followed by that many names, root first.  Each sample
+    //  is worth one clock tick.
+    enum { RING_SIZE = 1<<18, RING_MASK = RING_SIZE-1, MAX_SAMPLE_DEPTH = 512,
+           RESERVED_FRAMES = 4096, MAX_THREADS = 64 };
+
+    struct RingNames
+    {
+        const char **ring;
+        unsigned int start;
+        const char *operator[](int inDepth) const { return ring[(start + inDepth) & RING_MASK]; }
+    };
+
+    struct ProfiledThread
+    {
+        pthread_t thread;
+        Profiler * volatile profiler;
+    };
+
+    // Delivered to this thread only, after each millisecond of cpu it uses
+    bool startTimer()
+    {
+        struct sigevent event;
+        memset(&event, 0, sizeof(event));
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event.sigev_signo = SIGPROF;
+        event.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+        if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &mTimer) != 0) {
+            return false;
+        }
+
+        struct itimerspec interval;
+        interval.it_interval.tv_sec = 0;
+        interval.it_interval.tv_nsec = 1000000;
+        interval.it_value = interval.it_interval;
+        if (timer_settime(mTimer, 0, &interval, 0) != 0) {
+            timer_delete(mTimer);
+            return false;
+        }
+        return true;
+    }
+
+    static void onProfileSignal(int)
+    {
+        int err = errno;
+        pthread_t self = pthread_self();
+        for (int i = 0; i < MAX_THREADS; i++) {
+            Profiler *profiler = gThreads[i].profiler;
+            if (profiler && pthread_equal(gThreads[i].thread, self)) {
+                profiler->capture();
+                break;
+            }
+        }
+        errno = err;
+    }
+
+    // Signal handler context - no locks, no allocation
+    void capture()
+    {
+        hx::QuickVec<StackFrame *> &frames = mContext->mStackFrames;
+        int size = frames.size();
+        if (size == 0) {
+            return;
+        }
+        // Past the reserved capacity the interrupted push may be in the middle
+        //  of reallocating the frame array, so the buffer can not be trusted
+        if (size >= RESERVED_FRAMES - 1) {
+            mDropped++;
+            return;
+        }
+        int depth = std::min(size, (int)MAX_SAMPLE_DEPTH);
+
+        unsigned int head = mRingHead;
+        if (RING_SIZE - (head - mRingTail) < (unsigned int)depth + 1) {
+            mDropped++;
+            return;
+        }
+        mRing[head & RING_MASK] = (const char *)(size_t)depth;
+        for (int i = 0; i < depth; i++) {
+            mRing[(head + 1 + i) & RING_MASK] = frames[i]->position->fullName;
+        }
+        HX_SIGNAL_FENCE();
+        mRingHead = head + depth + 1;
+    }
+
+    void drain()
+    {
+        unsigned int head = mRingHead;
+        HX_SIGNAL_FENCE();
+        unsigned int tail = mRingTail;
+        while (tail != head) {
+            int depth = (int)(size_t)mRing[tail & RING_MASK];
+            RingNames names = { mRing, tail + 1 };
+            addSample(names, depth, 1);
+            tail += depth + 1;
+        }
+        HX_SIGNAL_FENCE();
+        mRingTail = tail;
+    }
+    #endif
+
+    struct Node
+    {
+        Node(const char *inName, int inParent)
+            : name(inName), parent(inParent), self(0)
+        {
+        }
+
+        const char *name;
+        int parent;
+        int self;
+    };
+
+    struct PathEntry
+    {
+        const char *name;
+        int node;
+    };
+
+    static bool endsWith(const std::string &inString, const char *inEnd)
+    {
+        size_t len = strlen(inEnd);
+        return inString.size() >= len &&
+               inString.compare(inString.size() - len, len, inEnd) == 0;
+    }
+
+    inline unsigned int slotOf(int inParent, const char *inName) const
+    {
+        size_t h = ((size_t)inName >> 3) * 0x9e3779b1U + (size_t)inParent * 0x85ebca6bU;
+        return (unsigned int)(h ^ (h >> 15)) & (mLookup.size() - 1);
+    }
+
+    int findChild(int inParent, const char *inName)
+    {
+        unsigned int mask = mLookup.size() - 1;
+        unsigned int slot = slotOf(inParent, inName);
+        while (true) {
+            int id = mLookup[slot];
+            if (id < 0) {
+                break;
+            }
+            if (mNodes[id].parent == inParent && mNodes[id].name == inName) {
+                return id;
+            }
+            slot = (slot + 1) & mask;
+        }
+
+        int id = mNodes.size();
+        mNodes.push_back( Node(inName, inParent) );
+        mLookup[slot] = id;
+
+        // Keep the table at most half full
+        if (mNodes.size() * 2 > mLookup.size()) {
+            mLookup.assign(mLookup.size() * 2, -1);
+            mask = mLookup.size() - 1;
+            for (int n = 1; n < (int)mNodes.size(); n++) {
+                unsigned int s = slotOf(mNodes[n].parent, mNodes[n].name);
+                while (mLookup[s] >= 0) {
+                    s = (s + 1) & mask;
+                }
+                mLookup[s] = n;
+            }
+        }
+        return id;
+    }
+
+    // Root-first names of the stack ending at inNode
+    void getStack(int inNode, std::vector<const char *> &outNames)
+    {
+        outNames.clear();
+        for (int n = inNode; n > 0; n = mNodes[n].parent) {
+            outNames.push_back(mNodes[n].name);
+        }
+        std::reverse(outNames.begin(), outNames.end());
+    }
+
+
+    void dumpFolded(FILE *out)
+    {
+        std::vector<const char *> names;
+        for (int n = 1; n < (int)mNodes.size(); n++) {
+            if (!mNodes[n].self) {
+                continue;
+            }
+            getStack(n, names);
+            std::string line;
+            for (int i = 0; i < (int)names.size(); i++) {
+                if (i) {
+                    line += ';';
+                }
+                line += names[i];
+            }
+            PROFILE_PRINT("%s %d\n", line.c_str(), mNodes[n].self);
+        }
+    }
+
+
+    // Minimal protobuf writer for the pprof profile.proto messages
+    struct ProtoBuffer
+    {
+        std::string data;
+
+        void varint(unsigned long long inValue)
+        {
+            while (inValue >= 0x80) {
+                data += (char)(inValue | 0x80);
+                inValue >>= 7;
+            }
+            data += (char)inValue;
+        }
+        void key(int inField, int inWireType) { varint((inField << 3) | inWireType); }
+        void intField(int inField, long long inValue)
+        {
+            key(inField, 0);
+            varint((unsigned long long)inValue);
+        }
+        void bytesField(int inField, const std::string &inBytes)
+        {
+            key(inField, 2);
+            varint(inBytes.size());
+            data += inBytes;
+        }
+        void packed(int inField, const std::vector<unsigned long long> &inValues)
+        {
+            ProtoBuffer values;
+            for (int i = 0; i < (int)inValues.size(); i++) {
+                values.varint(inValues[i]);
+            }
+            bytesField(inField, values.data);
+        }
+    };
+
+    void dumpPprof(FILE *out)
+    {
+        std::vector<std::string> strings;
+        std::map<std::string, int> stringIds;
+        strings.push_back("");
+        stringIds[""] = 0;
+
+        struct Strings
+        {
+            std::vector<std::string> &strings;
+            std::map<std::string, int> &ids;
+            int operator()(const char *inString)
+            {
+                std::string s(inString ? inString : "");
+                std::map<std::string, int>::iterator i = ids.find(s);
+                if (i != ids.end()) {
+                    return i->second;
+                }
+                int id = strings.size();
+                strings.push_back(s);
+                ids[s] = id;
+                return id;
+            }
+        } stringId = { strings, stringIds };
+
+        ProtoBuffer profile;
+
+        // sample_type and period_type : cpu/milliseconds
+        ProtoBuffer valueType;
+        valueType.intField(1, stringId("cpu"));
+        valueType.intField(2, stringId("milliseconds"));
+        profile.bytesField(1, valueType.data);
+
+        // One function and location per distinct name
+        std::map<const char *, int> functionIds;
+        std::vector<const char *> names;
+        std::vector<unsigned long long> locations;
+        for (int n = 1; n < (int)mNodes.size(); n++) {
+            if (!mNodes[n].self) {
+                continue;
+            }
+            locations.clear();
+            for (int p = n; p > 0; p = mNodes[p].parent) {
+                const char *name = mNodes[p].name;
+                std::map<const char *, int>::iterator f = functionIds.find(name);
+                int id;
+                if (f == functionIds.end()) {
+                    id = functionIds.size() + 1;
+                    functionIds[name] = id;
+                } else {
+                    id = f->second;
+                }
+                // Leaf first
+                locations.push_back(id);
+            }
+
+            ProtoBuffer sample;
+            sample.packed(1, locations);
+            std::vector<unsigned long long> value(1, mNodes[n].self);
+            sample.packed(2, value);
+            profile.bytesField(2, sample.data);
+        }
+
+        std::map<const char *, int>::iterator f = functionIds.begin();
+        for (; f != functionIds.end(); ++f) {
+            ProtoBuffer line;
+            line.intField(1, f->second);
+
+            ProtoBuffer location;
+            location.intField(1, f->second);
+            location.bytesField(4, line.data);
+            profile.bytesField(4, location.data);
+
+            int name = stringId(f->first);
+            ProtoBuffer function;
+            function.intField(1, f->second);
+            function.intField(2, name);
+            function.intField(3, name);
+            profile.bytesField(5, function.data);
+        }
+
+        for (int i = 0; i < (int)strings.size(); i++) {
+            profile.bytesField(6, strings[i]);
+        }
+
+        profile.bytesField(11, valueType.data);
+        profile.intField(12, 1);
+
+        fwrite(profile.data.c_str(), 1, profile.data.size(), out);
+    }
+
+
+    void dumpReport(FILE *out)
+    {
+        std::map<const char *, ProfileEntry> profileStats;
+        std::vector<const char *> names;
+
+        for (int n = 1; n < (int)mNodes.size(); n++) {
+            int delta = mNodes[n].self;
+            if (!delta) {
+                continue;
+            }
+            getStack(n, names);
+            int depth = names.size();
+
+            std::map<const char *, bool> alreadySeen;
+
+            // Add children time in to each stack element
+            for (int i = 0; i < (depth - 1); i++) {
+                const char *fullName = names[i];
+                ProfileEntry &pe = profileStats[fullName];
+                if (!alreadySeen.count(fullName)) {
+                    pe.total += delta;
+                    alreadySeen[fullName] = true;
+                }
+                // For everything except the very bottom of the stack, add the time to
+                // that child's total with this entry
+                pe.children[names[i + 1]] += delta;
+            }
+
+            // Add the time into the actual function being executed
+            profileStats[names[depth - 1]].self += delta;
+        }
+
         std::vector<ResultsEntry> results;
 
-        results.reserve(mProfileStats.size());
+        results.reserve(profileStats.size());
 
         int total = 0;
-        std::map<const char *, ProfileEntry>::iterator iter = 
-            mProfileStats.begin();
-        while (iter != mProfileStats.end()) {
+        std::map<const char *, ProfileEntry>::iterator iter =
+            profileStats.begin();
+        while (iter != profileStats.end()) {
             ProfileEntry &pe = iter->second;
             ResultsEntry re;
             re.fullName = iter->first;
@@ -134,7 +622,6 @@ public:
             internal.self = re.self;
             std::map<const char *, int>::iterator childIter =
                 pe.children.begin();
-            int childTotal = 0;
             while (childIter != pe.children.end()) {
                 ChildEntry ce;
                 ce.fullName = childIter->first;
@@ -171,14 +658,8 @@ public:
                               (100.0 * ce.self) / re.childrenPlusSelf);
             }
         }
-
-        if (out) {
-            fclose(out);
-        }
     }
 
-private:
-
     struct ProfileEntry
     {
         ProfileEntry()
@@ -209,7 +690,7 @@ private:
             return ((total > inRHS.total) ||
                     ((total == inRHS.total) && (self < inRHS.self)));
         }
-        
+
         const char *fullName;
         int self;
         std::vector<ChildEntry> children;
@@ -221,7 +702,7 @@ private:
     {
         int millis = 1;
 
-        while (gThreadRefCount > 0) { 
+        while (gThreadRefCount > 0) {
             HxSleep(millis);
 
             int count = gProfileClock + 1;
@@ -232,8 +713,24 @@ private:
     }
 
     String mDumpFile;
+    StackContext *mContext;
     int mT0;
-    std::map<const char *, ProfileEntry> mProfileStats;
+    // Node 0 is the root, above the outermost frame
+    std::vector<Node> mNodes;
+    std::vector<int> mLookup;
+    std::vector<PathEntry> mPath;
+
+    #ifdef HX_PROFILE_SIGNAL
+    const char **mRing;
+    volatile unsigned int mRingHead;
+    volatile unsigned int mRingTail;
+    volatile int mDropped;
+    timer_t mTimer;
+    bool mHasTimer;
+
+    static ProfiledThread gThreads[MAX_THREADS];
+    static bool gSignalInstalled;
+    #endif
 
     static HxMutex gThreadMutex;
     static int gThreadRefCount;
@@ -242,6 +739,10 @@ private:
 /* static */ HxMutex Profiler::gThreadMutex;
 /* static */ int Profiler::gThreadRefCount;
 /* static */ int Profiler::gProfileClock;
+#ifdef HX_PROFILE_SIGNAL
+/* static */ Profiler::ProfiledThread Profiler::gThreads[Profiler::MAX_THREADS];
+/* static */ bool Profiler::gSignalInstalled;
+#endif
 
 void profDestroy(Profiler * prof)
 {
@@ -270,7 +771,7 @@ void __hxcpp_start_profiler(String inDumpFile)
 {
    hx::StackContext *stack = hx::StackContext::getCurrent();
    delete stack->mProfiler;
-   stack->mProfiler = new hx::Profiler(inDumpFile);
+   stack->mProfiler = new hx::Profiler(inDumpFile, stack);
 }
 
 
@@ -281,6 +782,3 @@ void __hxcpp_stop_profiler()
    delete stack->mProfiler;
    stack->mProfiler = 0;
 }
-
-
-
@@ -3,6 +3,14 @@
 #include <hx/Thread.h>
 #include <time.h>
 
+#if defined(HX_LINUX) || defined(HX_ANDROID)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+// Park blocked Deque readers on a futex, rather than a semaphore
+#define HX_DEQUE_FUTEX
+#endif
+
 DECLARE_TLS_DATA(class hxThreadInfo, tlsCurrentThread);
 
 // g_threadInfoMutex allows atomic access to g_nextThreadNumber
@@ -27,9 +35,35 @@ static int g_nextThreadNumber = 1;
 
 // --- Deque ----------------------------------------------------------
 
+// Values are passed through a lock-free ring buffer (bounded multi-producer,
+//  multi-consumer queue with a sequence number per cell).
+// Values pushed to the front, or added while the ring is full, are stored in the
+//  Array under mMutex.  Pop order is: front values, ring, overflow values.
 struct Deque : public Array_obj<Dynamic>
 {
-	Deque() : Array_obj<Dynamic>(0,0) { }
+	enum { RING_SIZE = 256, RING_MASK = RING_SIZE-1 };
+
+	struct Cell
+	{
+		volatile int sequence;
+		hx::Object   *value;
+	};
+
+	Deque() : Array_obj<Dynamic>(0,0)
+	{
+		mRing = (Cell *)malloc(sizeof(Cell)*RING_SIZE);
+		for(int i=0;i<RING_SIZE;i++)
+		{
+			mRing[i].sequence = i;
+			mRing[i].value = 0;
+		}
+		mPushPos = 0;
+		mPopPos = 0;
+		mFrontCount = 0;
+		mOverflowing = 0;
+		mSleepers = 0;
+		mWakeSeq = 0;
+	}
 
 	static Deque *Create()
 	{
@@ -47,7 +81,21 @@ struct Deque : public Array_obj<Dynamic>
 		#ifdef HX_WINDOWS
 		mMutex.Clean();
 		#endif
+		#ifndef HX_DEQUE_FUTEX
 		mSemaphore.Clean();
+		#endif
+		free(mRing);
+		mRing = 0;
+	}
+
+	void __Mark(hx::MarkContext *__inCtx)
+	{
+		Array_obj<Dynamic>::__Mark(__inCtx);
+		if (mRing)
+			for(int i=0;i<RING_SIZE;i++)
+			{
+				HX_MARK_OBJECT(mRing[i].value);
+			}
 	}
 
    #ifdef HXCPP_VISIT_ALLOCS
@@ -55,89 +103,223 @@ struct Deque : public Array_obj<Dynamic>
 	{
 		Array_obj<Dynamic>::__Visit(__inCtx);
 		mFinalizer->Visit(__inCtx);
+		if (mRing)
+			for(int i=0;i<RING_SIZE;i++)
+			{
+				HX_VISIT_OBJECT(mRing[i].value);
+			}
 	}
    #endif
 
+	// Positions wrap around, so compare the difference
+	static inline int SeqDiff(int inA, int inB) { return (int)((unsigned int)inA - (unsigned int)inB); }
 
-	#ifndef HX_THREAD_SEMAPHORE_LOCKABLE
-	HxMutex     mMutex;
-	void PushBack(Dynamic inValue)
+	bool RingPush(hx::Object *inValue)
 	{
-		hx::EnterGCFreeZone();
-		AutoLock lock(mMutex);
-		hx::ExitGCFreeZone();
+		int pos = _hx_atomic_load(&mPushPos);
+		while(true)
+		{
+			Cell &cell = mRing[pos & RING_MASK];
+			int diff = SeqDiff(_hx_atomic_load(&cell.sequence), pos);
+			if (diff==0)
+			{
+				int was = _hx_atomic_compare_exchange(&mPushPos, pos, (int)((unsigned int)pos+1));
+				if (was==pos)
+				{
+					cell.value = inValue;
+					_hx_atomic_store(&cell.sequence, (int)((unsigned int)pos+1));
+					return true;
+				}
+				pos = was;
+			}
+			else if (diff<0)
+				return false; // full
+			else
+				pos = _hx_atomic_load(&mPushPos);
+		}
+	}
 
-		push(inValue);
-		mSemaphore.Set();
+	bool RingPop(hx::Object *&outValue)
+	{
+		int pos = _hx_atomic_load(&mPopPos);
+		while(true)
+		{
+			Cell &cell = mRing[pos & RING_MASK];
+			int diff = SeqDiff(_hx_atomic_load(&cell.sequence), (int)((unsigned int)pos+1));
+			if (diff==0)
+			{
+				int was = _hx_atomic_compare_exchange(&mPopPos, pos, (int)((unsigned int)pos+1));
+				if (was==pos)
+				{
+					outValue = cell.value;
+					cell.value = 0;
+					_hx_atomic_store(&cell.sequence, (int)((unsigned int)pos+RING_SIZE));
+					return true;
+				}
+				pos = was;
+			}
+			else if (diff<0)
+				return false; // empty
+			else
+				pos = _hx_atomic_load(&mPopPos);
+		}
 	}
-	void PushFront(Dynamic inValue)
+
+	void LockedPush(Dynamic inValue, bool inFront)
+	{
+		{
+			hx::EnterGCFreeZone();
+			AutoLock lock(mMutex);
+			hx::ExitGCFreeZone();
+
+			if (inFront)
+			{
+				unshift(inValue);
+				_hx_atomic_add(&mFrontCount,1);
+			}
+			// Once values have overflowed, keep adding them here to preserve the order
+			else if (mOverflowing || !RingPush(inValue.mPtr))
+			{
+				_hx_atomic_store(&mOverflowing,1);
+				push(inValue);
+			}
+			else
+			{
+				HX_OBJ_WB_GET(this,inValue.mPtr);
+			}
+		}
+		Wake();
+	}
+
+	bool LockedPop(Dynamic &outValue)
 	{
 		hx::EnterGCFreeZone();
 		AutoLock lock(mMutex);
 		hx::ExitGCFreeZone();
 
-		unshift(inValue);
-		mSemaphore.Set();
+		if (!mFrontCount)
+		{
+			// Values in the ring were added before the overflow values
+			hx::Object *obj = 0;
+			if (RingPop(obj))
+			{
+				outValue = obj;
+				return true;
+			}
+		}
+
+		if (!length)
+		{
+			_hx_atomic_store(&mOverflowing,0);
+			return false;
+		}
+
+		if (mFrontCount)
+			_hx_atomic_sub(&mFrontCount,1);
+		outValue = shift();
+		if (length==mFrontCount)
+			_hx_atomic_store(&mOverflowing,0);
+		return true;
 	}
 
-	
-	Dynamic PopFront(bool inBlock)
+	bool TryPop(Dynamic &outValue)
 	{
-		hx::EnterGCFreeZone();
-		AutoLock lock(mMutex);
-		if (!inBlock)
+		if (_hx_atomic_load(&mFrontCount) && LockedPop(outValue))
+			return true;
+
+		hx::Object *obj = 0;
+		if (RingPop(obj))
 		{
-			hx::ExitGCFreeZone();
-			return shift();
+			outValue = obj;
+			return true;
 		}
-		// Ok - wait for something on stack...
-		while(!length)
+
+		if (_hx_atomic_load(&mOverflowing))
+			return LockedPop(outValue);
+
+		return false;
+	}
+
+	void Wake()
+	{
+		if (_hx_atomic_load(&mSleepers))
 		{
-			mSemaphore.Reset();
-			lock.Unlock();
-			mSemaphore.Wait();
-			lock.Lock();
+			_hx_atomic_add(&mWakeSeq,1);
+			#ifdef HX_DEQUE_FUTEX
+			syscall(SYS_futex, &mWakeSeq, FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+			#else
+			mSemaphore.Set();
+			#endif
 		}
-		hx::ExitGCFreeZone();
-		if (length==1)
-			mSemaphore.Reset();
-		return shift();
 	}
-	#else
+
 	void PushBack(Dynamic inValue)
 	{
-		hx::EnterGCFreeZone();
-		AutoLock lock(mSemaphore);
-		hx::ExitGCFreeZone();
-		push(inValue);
-		mSemaphore.QSet();
+		if (!_hx_atomic_load(&mOverflowing) && RingPush(inValue.mPtr))
+		{
+			HX_OBJ_WB_GET(this,inValue.mPtr);
+			Wake();
+		}
+		else
+			LockedPush(inValue,false);
 	}
 	void PushFront(Dynamic inValue)
 	{
-		hx::EnterGCFreeZone();
-		AutoLock lock(mSemaphore);
-		hx::ExitGCFreeZone();
-		unshift(inValue);
-		mSemaphore.QSet();
+		LockedPush(inValue,true);
 	}
 
-	
 	Dynamic PopFront(bool inBlock)
 	{
-		hx::EnterGCFreeZone();
-		AutoLock lock(mSemaphore);
-		while(inBlock && !length)
-			mSemaphore.QWait();
-		hx::ExitGCFreeZone();
-		Dynamic result =  shift();
-		if (length)
-			mSemaphore.QSet();
+		Dynamic result;
+		while(!TryPop(result))
+		{
+			if (!inBlock)
+				return null();
+
+			// Register as a sleeper before checking again, so a push either sees us or
+			//  changes mWakeSeq before we wait on it
+			_hx_atomic_add(&mSleepers,1);
+			int seq = _hx_atomic_load(&mWakeSeq);
+			if (TryPop(result))
+			{
+				_hx_atomic_sub(&mSleepers,1);
+				break;
+			}
+
+			hx::EnterGCFreeZone();
+			#ifdef HX_DEQUE_FUTEX
+			syscall(SYS_futex, &mWakeSeq, FUTEX_WAIT_PRIVATE, seq, 0, 0, 0);
+			#else
+			if (_hx_atomic_load(&mWakeSeq)==seq)
+				mSemaphore.Wait();
+			#endif
+			hx::ExitGCFreeZone();
+			_hx_atomic_sub(&mSleepers,1);
+
+			#ifndef HX_DEQUE_FUTEX
+			// The semaphore does not count, so pass the signal on in case there is more
+			if (TryPop(result))
+			{
+				Wake();
+				break;
+			}
+			#endif
+		}
 		return result;
 	}
-	#endif
 
 	hx::InternalFinalizer *mFinalizer;
-	HxSemaphore mSemaphore;
+	HxMutex      mMutex;
+	#ifndef HX_DEQUE_FUTEX
+	HxSemaphore  mSemaphore;
+	#endif
+	Cell         *mRing;
+	volatile int mPushPos;
+	volatile int mPopPos;
+	volatile int mFrontCount;
+	volatile int mOverflowing;
+	volatile int mSleepers;
+	volatile int mWakeSeq;
 };
 
 Dynamic __hxcpp_deque_create()
@@ -27,6 +27,7 @@ namespace hx
 //#define SJLJ_RETURN 1
 
 bool gEnableJit = false;
+int gJitThreshold = 0;
 
 
 #ifdef DEBUG_RETURN_TYPE
@@ -708,6 +709,11 @@ void genFunctionCall(ScriptCallable *function, CppiaCompiler *compiler,
       {
          compiler->call( JitVal( (void *)(function->compiled)), sJitCtx );
       }
+      else if (gJitThreshold>0)
+      {
+         // May never be compiled - interpret until it is
+         compiler->callNative( (void *)ScriptCallable::runTiered, sJitCtx, JitVal((void *)function) );
+      }
       else
       {
          // Compiled later
@@ -2189,6 +2195,16 @@ struct CallMemberVTable : public CppiaExpr
    bool isBoolInt() { return boolResult; }
 
    #ifdef CPPIA_JIT
+   // Call the ScriptCallable in sJitTemp1
+   static void genVTableCall(CppiaCompiler *compiler)
+   {
+      if (gJitThreshold>0)
+         compiler->callNative( (void *)ScriptCallable::runTiered, sJitCtx, sJitTemp1 );
+      else
+         // vtable[slot].compiled
+         compiler->call(sJitTemp1.star(jtPointer, offsetof(ScriptCallable,compiled)),sJitCtx );
+   }
+
    void genCode(CppiaCompiler *compiler, const JitVal &inDest,ExprType destType)
    {
       int framePos = compiler->getCurrentFrameSize();
@@ -2247,8 +2263,7 @@ struct CallMemberVTable : public CppiaExpr
          JitTemp actualReturnType(compiler,jtInt);
          compiler->move(actualReturnType, sJitTemp1.star(jtInt, offsetof(ScriptCallable,returnType)) );
 
-         // vtable[slot].compiled
-         compiler->call(sJitTemp1.star(jtPointer, offsetof(ScriptCallable,compiled)),sJitCtx );
+         genVTableCall(compiler);
          JumpId isEqual = compiler->compare(cmpI_EQUAL, actualReturnType, (int)returnType);
          // Must be int->Float
          if (returnType==etFloat)
@@ -2263,8 +2278,7 @@ struct CallMemberVTable : public CppiaExpr
       }
       else
       {
-         // vtable[slot].compiled
-         compiler->call(sJitTemp1.star(jtPointer, offsetof(ScriptCallable,compiled)),sJitCtx );
+         genVTableCall(compiler);
       }
 
       genFunctionResult(compiler, inDest, destType, returnType, isBoolReturn);
@@ -2345,37 +2359,6 @@ struct CallGlobal : public CppiaExpr
 
 
 #ifdef CPPIA_JIT
-static int SLJIT_CALL getFieldInt( hx::Object *instance, String *name )
-{
-   TRY_NATIVE
-   return instance->__Field(*name, HX_PROP_DYNAMIC);
-   CATCH_NATIVE
-   return 0;
-}
-
-static hx::Object * SLJIT_CALL getFieldObject( hx::Object *instance, String *name )
-{
-   TRY_NATIVE
-   Dynamic ret =  instance->__Field(*name, HX_PROP_DYNAMIC);
-   return ret.mPtr;
-   CATCH_NATIVE
-   return 0;
-}
-
-static void SLJIT_CALL getFieldFloat( hx::Object *instance, String *name, double *outValue )
-{
-   TRY_NATIVE
-   *outValue = instance->__Field(*name, HX_PROP_DYNAMIC);
-   CATCH_NATIVE
-}
-
-static void SLJIT_CALL getFieldString( hx::Object *instance, String *name, String *outValue )
-{
-   TRY_NATIVE
-   *outValue = instance->__Field(*name, HX_PROP_DYNAMIC);
-   CATCH_NATIVE
-}
-
 static int SLJIT_CALL setFieldInt( hx::Object *instance, String *name, int inValue )
 {
    TRY_NATIVE
@@ -2598,6 +2581,7 @@ struct FieldByName : public CppiaDynamicExpr
    AssignOp    assign;
    CrementOp   crement;
    hx::Class   staticClass;
+   hx::FieldCache cache;
 
    
    FieldByName(CppiaExpr *inSrc, CppiaExpr *inObject, hx::Class inStaticClass,
@@ -2610,6 +2594,8 @@ struct FieldByName : public CppiaDynamicExpr
       assign = inAssign;
       crement = inCrement;
       value = inValue;
+      hx::FieldCache init = HX_FIELD_CACHE_INIT;
+      cache = init;
    }
 
    const char *getName() { return "FieldByName"; }
@@ -2630,14 +2616,14 @@ struct FieldByName : public CppiaDynamicExpr
       CPPIA_CHECK(obj);
 
       if (crement==coNone && assign==aoNone)
-         return Dynamic(obj->__Field(name,HX_PROP_DYNAMIC)).mPtr;
+         return Dynamic(hx::FieldCacheGet(cache,obj,name,HX_PROP_DYNAMIC)).mPtr;
 
       if (crement!=coNone)
       {
-         Dynamic val0 = obj->__Field(name,HX_PROP_DYNAMIC);
+         Dynamic val0 = hx::FieldCacheGet(cache,obj,name,HX_PROP_DYNAMIC);
          BCR_CHECK;
          Dynamic val1 = val0 + (crement<=coPostInc ? 1 : -1);
-         obj->__SetField(name, val1,HX_PROP_DYNAMIC);
+         hx::FieldCacheSet(cache,obj,name, val1,HX_PROP_DYNAMIC);
          BCR_CHECK;
          return crement & coPostInc ? val0.mPtr : val1.mPtr;
       }
@@ -2645,10 +2631,10 @@ struct FieldByName : public CppiaDynamicExpr
       {
          hx::Object *val = value->runObject(ctx);
          BCR_CHECK;
-         return Dynamic(obj->__SetField(name,val,HX_PROP_DYNAMIC)).mPtr;
+         return Dynamic(hx::FieldCacheSet(cache,obj,name,val,HX_PROP_DYNAMIC)).mPtr;
       }
 
-      Dynamic val0 = obj->__Field(name,HX_PROP_DYNAMIC);
+      Dynamic val0 = hx::FieldCacheGet(cache,obj,name,HX_PROP_DYNAMIC);
       BCR_CHECK;
       Dynamic val1;
 
@@ -2668,7 +2654,7 @@ struct FieldByName : public CppiaDynamicExpr
          default: ;
       }
       BCR_CHECK;
-      obj->__SetField(name,val1,HX_PROP_DYNAMIC);
+      hx::FieldCacheSet(cache,obj,name,val1,HX_PROP_DYNAMIC);
       return val1.mPtr;
    }
 
@@ -2873,6 +2859,7 @@ struct GetFieldByName : public CppiaDynamicExpr
    bool        isInterface;
    bool        isStatic;
    hx::Class       staticClass;
+   hx::FieldCache cache;
   
    GetFieldByName(CppiaStream &stream,bool isThisObject,bool inIsStatic=false)
    {
@@ -2883,6 +2870,8 @@ struct GetFieldByName : public CppiaDynamicExpr
       name.raw_ref() = 0;
       isInterface = false;
       vtableSlot = -1;
+      hx::FieldCache init = HX_FIELD_CACHE_INIT;
+      cache = init;
    }
    GetFieldByName(const CppiaExpr *inSrc, int inNameId, CppiaExpr *inObject,bool inIsStatic)
       : CppiaDynamicExpr(inSrc)
@@ -2894,6 +2883,8 @@ struct GetFieldByName : public CppiaDynamicExpr
       isInterface = false;
       name.raw_ref() = 0;
       vtableSlot = -1;
+      hx::FieldCache init = HX_FIELD_CACHE_INIT;
+      cache = init;
    }
    const char *getName() { return "GetFieldByName"; }
 
@@ -2984,10 +2975,41 @@ struct GetFieldByName : public CppiaDynamicExpr
          return createMemberClosure(instance, func);
       }
 
-      return Dynamic(instance->__Field(name,HX_PROP_DYNAMIC)).mPtr;
+      return Dynamic(hx::FieldCacheGet(cache,instance,name,HX_PROP_DYNAMIC)).mPtr;
    }
 
    #ifdef CPPIA_JIT
+   static int SLJIT_CALL getInt( hx::Object *instance, GetFieldByName *inExpr )
+   {
+      TRY_NATIVE
+      return hx::FieldCacheGet(inExpr->cache, instance, inExpr->name, HX_PROP_DYNAMIC);
+      CATCH_NATIVE
+      return 0;
+   }
+
+   static hx::Object * SLJIT_CALL getObject( hx::Object *instance, GetFieldByName *inExpr )
+   {
+      TRY_NATIVE
+      Dynamic ret = hx::FieldCacheGet(inExpr->cache, instance, inExpr->name, HX_PROP_DYNAMIC);
+      return ret.mPtr;
+      CATCH_NATIVE
+      return 0;
+   }
+
+   static void SLJIT_CALL getFloat( hx::Object *instance, GetFieldByName *inExpr, double *outValue )
+   {
+      TRY_NATIVE
+      *outValue = hx::FieldCacheGet(inExpr->cache, instance, inExpr->name, HX_PROP_DYNAMIC);
+      CATCH_NATIVE
+   }
+
+   static void SLJIT_CALL getString( hx::Object *instance, GetFieldByName *inExpr, String *outValue )
+   {
+      TRY_NATIVE
+      *outValue = hx::FieldCacheGet(inExpr->cache, instance, inExpr->name, HX_PROP_DYNAMIC);
+      CATCH_NATIVE
+   }
+
    void genCode(CppiaCompiler *compiler, const JitVal &inDest,ExprType destType)
    {
       // TODO - interfaces
@@ -3010,30 +3032,30 @@ struct GetFieldByName : public CppiaDynamicExpr
       switch(destType)
       {
          case etInt:
-            compiler->callNative( (void *)getFieldInt, sJitTemp0.as(jtPointer), (void *)&name);
+            compiler->callNative( (void *)getInt, sJitTemp0.as(jtPointer), (void *)this);
             compiler->checkException();
             compiler->move(inDest.as(jtInt), sJitReturnReg.as(jtInt));
             break;
          case etFloat:
             if (isMemoryVal(inDest))
             {
-               compiler->callNative( (void *)getFieldFloat, sJitTemp0.as(jtPointer),  (void *)&name, inDest.as(jtFloat) );
+               compiler->callNative( (void *)getFloat, sJitTemp0.as(jtPointer),  (void *)this, inDest.as(jtFloat) );
                compiler->checkException();
             }
             else
             {
                JitTemp floatResult(compiler, jtFloat);
-               compiler->callNative( (void *)getFieldFloat, sJitTemp0.as(jtPointer), &name, floatResult );
+               compiler->callNative( (void *)getFloat, sJitTemp0.as(jtPointer), (void *)this, floatResult );
                compiler->checkException();
                compiler->move(inDest.as(jtFloat), floatResult);
             }
             break;
          case etString:
-            compiler->callNative( (void *)getFieldString, sJitTemp0.as(jtPointer),  (void *)&name, inDest.as(jtString) );
+            compiler->callNative( (void *)getString, sJitTemp0.as(jtPointer),  (void *)this, inDest.as(jtString) );
             compiler->checkException();
             break;
          case etObject:
-            compiler->callNative( (void *)getFieldObject, sJitTemp0.as(jtPointer), (void *)&name);
+            compiler->callNative( (void *)getObject, sJitTemp0.as(jtPointer), (void *)this);
             compiler->checkException();
             compiler->move(inDest.as(jtPointer), sJitReturnReg.as(jtPointer));
             break;
@@ -3812,6 +3834,13 @@ inline static void * getPointerFrom(String *s) { return (void *)s->raw_ptr(); }
 #endif
 
 #if defined(HXCPP_GC_GENERATIONAL) && defined(CPPIA_JIT)
+#ifdef HXCPP_GC_CONCURRENT
+static void SLJIT_CALL concurrentWriteBarrier(hx::StackContext *inCtx, hx::Object *inObj, hx::Object *inValue)
+{
+   HX_OBJ_WB_CTX(inObj,inValue,inCtx);
+}
+#endif
+
 static void SLJIT_CALL pushWriteBarrier(hx::StackContext *inCtx, hx::Object *inObj)
 {
    unsigned char &mark =  ((unsigned char *)(inObj))[ HX_ENDIAN_MARK_ID_BYTE];
@@ -3828,6 +3857,16 @@ void genWriteBarrier(CppiaCompiler *compiler, JitReg objVal, JitVal valuePtr)
    compiler->move(sJitTemp1, objVal.star(jtByte, HX_ENDIAN_MARK_ID_BYTE) );
    JumpId newMark = compiler->compare(cmpI_NOT_EQUAL,sJitTemp1,sJitCtx.star(jtInt, offsetof(hx::StackContext,byteMarkId)));
 
+   #ifdef HXCPP_GC_CONCURRENT
+   // byteMarkId only matches while marking in the background - let the runtime check the value
+   JitTemp tmpObj(compiler, jtPointer);
+   JitTemp tmpValue(compiler, jtPointer);
+   compiler->move(tmpValue, valuePtr);
+   compiler->move(tmpObj, objVal);
+   compiler->callNative( (void *)concurrentWriteBarrier, sJitCtx, tmpObj, tmpValue );
+
+   compiler->comeFrom(newMark);
+   #else
    compiler->move(sJitTemp1, valuePtr );
 
    // Value != 0
@@ -3843,6 +3882,7 @@ void genWriteBarrier(CppiaCompiler *compiler, JitReg objVal, JitVal valuePtr)
    compiler->comeFrom(notNursery);
    compiler->comeFrom(nullValue);
    compiler->comeFrom(newMark);
+   #endif
 }
 
 
@@ -5966,6 +6006,7 @@ struct ForExpr : public CppiaVoidExpr
    CppiaStackVar var;
    CppiaExpr *init;
    CppiaExpr *loop;
+   ScriptCallable *function;
 
  
    ForExpr(CppiaStream &stream)
@@ -5973,6 +6014,7 @@ struct ForExpr : public CppiaVoidExpr
       var.fromStream(stream);
       init = createCppiaExpr(stream);
       loop = createCppiaExpr(stream);
+      function = 0;
    }
 
    const char *getName() { return "ForExpr"; }
@@ -5981,6 +6023,7 @@ struct ForExpr : public CppiaVoidExpr
       var.link(inModule);
       init = init->link(inModule);
       loop = loop->link(inModule);
+      function = inModule.linkingFunction;
       return this;
    }
 
@@ -6000,6 +6043,11 @@ struct ForExpr : public CppiaVoidExpr
       {
          var.set(ctx,getNext());
          loop->runVoid(ctx);
+         #ifdef CPPIA_JIT
+         // Back-edges count towards compiling the function for next time
+         if (function)
+            _hx_atomic_add(&function->jitCount,1);
+         #endif
 
          if (ctx->breakContReturn)
          {
@@ -6017,6 +6065,7 @@ struct WhileExpr : public CppiaVoidExpr
    bool      isWhileDo;
    CppiaExpr *condition;
    CppiaExpr *loop;
+   ScriptCallable *function;
 
  
    WhileExpr(CppiaStream &stream)
@@ -6024,6 +6073,7 @@ struct WhileExpr : public CppiaVoidExpr
       isWhileDo = stream.getInt();
       condition = createCppiaExpr(stream);
       loop = createCppiaExpr(stream);
+      function = 0;
    }
 
    const char *getName() { return "WhileExpr"; }
@@ -6031,6 +6081,7 @@ struct WhileExpr : public CppiaVoidExpr
    {
       condition = condition->link(inModule);
       loop = loop->link(inModule);
+      function = inModule.linkingFunction;
       return this;
    }
 
@@ -6044,6 +6095,10 @@ struct WhileExpr : public CppiaVoidExpr
       while(true)
       {
          loop->runVoid(ctx);
+         #ifdef CPPIA_JIT
+         if (function)
+            _hx_atomic_add(&function->jitCount,1);
+         #endif
 
          if (ctx->breakContReturn)
          {
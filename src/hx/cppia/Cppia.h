@@ -271,6 +271,15 @@ struct ScriptCallable : public CppiaDynamicExpr
    CppiaModule *data;
    #ifdef CPPIA_JIT
    CppiaFunc compiled;
+   // Calls + loop iterations while interpreted, when tiering.  Updated from any thread.
+   volatile int jitCount;
+   // Compilation threw - stay interpreted
+   bool jitFailed;
+   int argsSize;
+   // Load order within the module, used by the jit profile cache
+   int cacheId;
+   // Already listed in the module's jit profile
+   bool jitProfiled;
    #endif
 
    #ifdef HXCPP_STACK_SCRIPTABLE
@@ -303,6 +312,14 @@ struct ScriptCallable : public CppiaDynamicExpr
 
    #ifdef CPPIA_JIT
    void compile();
+   void tierUp();
+   static void SLJIT_CALL runTiered(CppiaCtx *ctx, ScriptCallable *inFunction);
+   inline void countJit()
+   {
+      if (!compiled && gJitThreshold>0 && gEnableJit && !jitFailed &&
+             _hx_atomic_add(&jitCount,1)+1>=gJitThreshold)
+         tierUp();
+   }
    void genDefaults(CppiaCompiler *compiler);
    void genArgs(CppiaCompiler *compiler, CppiaExpr *inThis, Expressions &inArgs, const JitVal &inThisVal);
    void genCode(CppiaCompiler *compiler,const JitVal &inDest=JitVal(),ExprType type=etNull);
@@ -378,17 +395,33 @@ public:
 
    StackLayout                     *layout;
    CppiaClassInfo                  *linkingClass;
+   ScriptCallable                  *linkingFunction;
    const char                      *creatingClass;
    const char                      *creatingFunction;
    int                             scriptId;
 
    ScriptCallable                  *main;
 
+   #ifdef CPPIA_JIT
+   // Every function read from the stream, in load order
+   std::vector< ScriptCallable * > callables;
+   // Functions that tiered up, in order, and where to keep them
+   std::vector< int >              jitProfile;
+   int                             jitProfileSaved;
+   std::string                     jitCacheFile;
+   unsigned long long              jitKey;
+   #endif
+
    CppiaModule();
    ~CppiaModule();
 
    void link();
    void compile();
+   #ifdef CPPIA_JIT
+   void loadJitProfile();
+   void addJitProfile(ScriptCallable *inFunction);
+   void saveJitProfile();
+   #endif
    void setDebug(CppiaExpr *outExpr, int inFileId, int inLine);
    void boot(CppiaCtx *ctx);
    void where(CppiaExpr *e);
@@ -596,6 +629,7 @@ public:
    static HaxeNativeClass *findClass(const std::string &inName);
    static HaxeNativeClass *hxObject();
    static void link();
+   static unsigned long long layoutHash(unsigned long long inHash);
 };
 
 class HaxeNativeInterface
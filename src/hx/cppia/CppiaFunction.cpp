@@ -1,6 +1,7 @@
    #include <hxcpp.h>
 #include "Cppia.h"
 #include "CppiaStream.h"
+#include <limits.h>
 
 namespace hx
 {
@@ -38,6 +39,12 @@ ScriptCallable::ScriptCallable(CppiaStream &stream)
    hasDefaults = false;
    #ifdef CPPIA_JIT
    compiled = 0;
+   jitCount = 0;
+   jitFailed = false;
+   jitProfiled = false;
+   argsSize = 0;
+   cacheId = stream.module->callables.size();
+   stream.module->callables.push_back(this);
    #endif
    for(int a=0;a<argCount;a++)
    {
@@ -63,6 +70,11 @@ ScriptCallable::ScriptCallable(CppiaExpr *inBody) : CppiaDynamicExpr(inBody)
    data = 0;
    #ifdef CPPIA_JIT
    compiled = 0;
+   jitCount = 0;
+   jitFailed = false;
+   jitProfiled = false;
+   argsSize = 0;
+   cacheId = -1;
    #endif
 }
 
@@ -136,6 +148,11 @@ ScriptCallable::ScriptCallable(CppiaModule &inModule,ScriptNamedFunction *inFunc
    #ifdef CPPIA_JIT
    // magically already compiled for us
    compiled = inFunction->execute;
+   jitCount = 0;
+   jitFailed = false;
+   jitProfiled = false;
+   argsSize = 0;
+   cacheId = -1;
    #endif
 }
 
@@ -153,6 +170,8 @@ CppiaExpr *ScriptCallable::link(CppiaModule &inModule)
    StackLayout *oldLayout = inModule.layout;
    StackLayout layout(oldLayout);
    inModule.layout = &layout;
+   ScriptCallable *oldFunction = inModule.linkingFunction;
+   inModule.linkingFunction = this;
    data = &inModule;
 
    returnType = inModule.types[ returnTypeId ]->expressionType;
@@ -160,6 +179,9 @@ CppiaExpr *ScriptCallable::link(CppiaModule &inModule)
 
    for(int a=0;a<args.size();a++)
       args[a].link(inModule, hasDefault[a]);
+   #ifdef CPPIA_JIT
+   argsSize = layout.size;
+   #endif
 
    for(int a=0;a<initVals.size();a++)
       if (hasDefault[a])
@@ -180,6 +202,7 @@ CppiaExpr *ScriptCallable::link(CppiaModule &inModule)
 
    stackSize = layout.size;
    inModule.layout = oldLayout;
+   inModule.linkingFunction = oldFunction;
 
    position.className = className;
    position.functionName = functionName;
@@ -506,12 +529,22 @@ void ScriptCallable::runFunction(CppiaCtx *ctx)
 {
 
    #ifdef CPPIA_JIT
+   countJit();
    if (compiled)
    {
+      {
       AutoFrame frame(ctx);
       //printf("Running compiled code...\n");
       compiled(ctx);
       //printf("Done.\n");
+      }
+      // Back in interpreted land, so exceptions are thrown normally
+      if (ctx->exception)
+      {
+         hx::Object *e = ctx->exception;
+         ctx->exception = 0;
+         hx::Throw( Dynamic(e) );
+      }
    }
    else
    #endif
@@ -541,12 +574,21 @@ void ScriptCallable::runFunction(CppiaCtx *ctx)
 void ScriptCallable::runFunctionClosure(CppiaCtx *ctx)
 {
    #ifdef CPPIA_JIT
+   countJit();
    if (compiled)
    {
+      {
       AutoFrame frame(ctx);
       //printf("Running compiled code...\n");
       compiled(ctx);
       //printf("Done.\n");
+      }
+      if (ctx->exception)
+      {
+         hx::Object *e = ctx->exception;
+         ctx->exception = 0;
+         hx::Throw( Dynamic(e) );
+      }
    }
    else
    #endif
@@ -635,6 +677,13 @@ static void onReturn( CppiaCompiler *inCompiler, int stackSize )
 #endif
 
 
+struct CompilerHolder
+{
+   CppiaCompiler *compiler;
+   CompilerHolder(CppiaCompiler *inCompiler) : compiler(inCompiler) { }
+   ~CompilerHolder() { delete compiler; }
+};
+
 void ScriptCallable::compile()
 {
    if (!compiled && body)
@@ -644,6 +693,8 @@ void ScriptCallable::compile()
       size += sizeof(StackFrame);
       #endif
       CppiaCompiler *compiler = CppiaCompiler::create(size);
+      // Generation can throw, eg on an unsupported expression
+      CompilerHolder holder(compiler);
 
       // First pass calculates size...
       genDefaults(compiler);
@@ -675,9 +726,48 @@ void ScriptCallable::compile()
       body->genCode(compiler);
 
       compiled = compiler->finishGeneration();
+   }
+}
+
+// Only one function is compiled at a time - other threads keep interpreting until it is done
+static volatile int sTieringBusy = 0;
 
-      delete compiler;
+void ScriptCallable::tierUp()
+{
+   if (_hx_atomic_compare_exchange(&sTieringBusy,0,1)!=0)
+      return;
+
+   if (!compiled)
+   {
+      try
+      {
+         compile();
+         if (data)
+            data->addJitProfile(this);
+      }
+      catch(...)
+      {
+         // Stay interpreted, and do not try again
+         jitFailed = true;
+      }
    }
+
+   _hx_atomic_store(&sTieringBusy,0);
+}
+
+// Called from jit code for a function that may not be compiled yet.
+// ctx->frame points to 'this' followed by the args, as for a compiled call.
+void SLJIT_CALL ScriptCallable::runTiered(CppiaCtx *ctx, ScriptCallable *inFunction)
+{
+   unsigned char *pointer = ctx->pointer;
+   unsigned char *frame = ctx->frame;
+   ctx->pointer = frame + inFunction->argsSize;
+   TRY_NATIVE
+      inFunction->runFunction(ctx);
+   CATCH_NATIVE
+   ctx->breakContReturn = 0;
+   ctx->pointer = pointer;
+   ctx->frame = frame;
 }
 #endif
 
@@ -2,6 +2,16 @@
 #include "Cppia.h"
 #include "CppiaStream.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#ifndef HX_WINDOWS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
 
 
 namespace hx
@@ -18,6 +28,25 @@ Array<Dynamic> gAllCppiaModules;
 
 std::vector<hx::Resource> scriptResources;
 
+static std::string sJitCacheDir;
+static bool sJitCacheDirSet = false;
+#ifdef CPPIA_JIT
+// Modules that keep a profile file, saved again at exit
+static std::vector<CppiaModule *> sJitProfileModules;
+
+static void saveJitProfiles()
+{
+   for(size_t i=0;i<sJitProfileModules.size();i++)
+      sJitProfileModules[i]->saveJitProfile();
+}
+#endif
+
+void SetJitCacheDir(String inDir)
+{
+   sJitCacheDir = inDir.raw_ptr() ? inDir.utf8_str() : "";
+   sJitCacheDirSet = true;
+}
+
 
 
 // --- CppiaModule ----
@@ -26,10 +55,16 @@ CppiaModule::CppiaModule()
 {
    main = 0;
    layout = 0;
+   linkingClass = 0;
+   linkingFunction = 0;
    creatingClass = 0;
    creatingFunction = 0;
    scriptId = ++sScriptId;
    strings = Array_obj<String>::__new(0,0);
+   #ifdef CPPIA_JIT
+   jitKey = 0;
+   jitProfileSaved = 0;
+   #endif
    if (sgNativeNameSlotCount>0)
       for(int i=2;i<sgNativeNameSlotCount;i++)
          interfaceSlots[sgNativeNameSlots[i]] = i;
@@ -54,6 +89,15 @@ void CppiaModule::setDebug(CppiaExpr *outExpr, int inFileId, int inLine)
 
 CppiaModule::~CppiaModule()
 {
+   #ifdef CPPIA_JIT
+   saveJitProfile();
+   for(size_t i=0;i<sJitProfileModules.size();i++)
+      if (sJitProfileModules[i]==this)
+      {
+         sJitProfileModules.erase(sJitProfileModules.begin()+i);
+         break;
+      }
+   #endif
    delete main;
    for(int i=0;i<classes.size();i++)
       delete classes[i];
@@ -94,6 +138,136 @@ void CppiaModule::compile()
    if (main)
       main->compile();
 }
+
+
+// --- Jit profile cache -------------------------
+//
+// The generated code holds the addresses of expression nodes and runtime data, so
+//  it can not be reused by another process.  Instead, the ids of the functions that
+//  tiered up are saved, and the next load of the same module compiles them straight
+//  away.  The file is only a hint - anything that does not validate is ignored.
+//
+//   "HXJP" version key callableCount count ids[count]
+
+enum { JIT_PROFILE_VERSION = 1, JIT_PROFILE_BATCH = 32 };
+
+struct JitProfileHeader
+{
+   char         magic[4];
+   int          version;
+   unsigned int keyLo;
+   unsigned int keyHi;
+   int          callableCount;
+   int          count;
+};
+
+static unsigned long long jitCacheKey(const unsigned char *inData, int inLength)
+{
+   // fnv-1a over the module, then the host details the profile depends on
+   unsigned long long hash = 14695981039346656037ULL;
+   for(int i=0;i<inLength;i++)
+      hash = (hash ^ inData[i]) * 1099511628211ULL;
+   int host[] = { HXCPP_API_LEVEL, (int)sizeof(void *), (int)sizeof(StackFrame),
+                  (int)sizeof(CppiaCtx), JIT_PROFILE_VERSION };
+   for(size_t i=0;i<sizeof(host)/sizeof(host[0]);i++)
+      hash = (hash ^ (unsigned int)host[i]) * 1099511628211ULL;
+   // The hxcpp runtime build, and the host classes the module links against
+   for(const char *build = __DATE__ " " __TIME__; *build; build++)
+      hash = (hash ^ (unsigned char)*build) * 1099511628211ULL;
+   return HaxeNativeClass::layoutHash(hash);
+}
+
+void CppiaModule::loadJitProfile()
+{
+   FILE *file = fopen(jitCacheFile.c_str(),"rb");
+   if (!file)
+      return;
+
+   unsigned long long key = jitKey;
+   JitProfileHeader header;
+   bool ok = fread(&header,sizeof(header),1,file)==1 &&
+             !memcmp(header.magic,"HXJP",4) &&
+             header.version==JIT_PROFILE_VERSION &&
+             header.keyLo==(unsigned int)key && header.keyHi==(unsigned int)(key>>32) &&
+             header.callableCount==(int)callables.size() &&
+             header.count>=0 && header.count<=header.callableCount;
+   std::vector<int> ids;
+   if (ok)
+   {
+      ids.resize(header.count);
+      ok = header.count==0 || fread(&ids[0],sizeof(int),header.count,file)==(size_t)header.count;
+   }
+   fclose(file);
+   if (!ok)
+      return;
+
+   // Nothing is compiled here, so loading costs no more than plain tiering.  Listed
+   //  functions skip the warm-up and tier up on their first call instead.
+   for(size_t i=0;i<ids.size();i++)
+   {
+      int id = ids[i];
+      if (id<0 || id>=(int)callables.size())
+         continue;
+      ScriptCallable *function = callables[id];
+      if (function->compiled || function->jitFailed || function->jitProfiled)
+         continue;
+      function->jitProfiled = true;
+      function->jitCount = gJitThreshold;
+      jitProfile.push_back(id);
+   }
+   // The file already lists these
+   jitProfileSaved = jitProfile.size();
+}
+
+void CppiaModule::addJitProfile(ScriptCallable *inFunction)
+{
+   if (jitCacheFile.empty() || inFunction->cacheId<0 || inFunction->jitProfiled)
+      return;
+   inFunction->jitProfiled = true;
+
+   // Tier-ups happen on the hot path, so the file is written in batches and at exit
+   jitProfile.push_back(inFunction->cacheId);
+   if ((int)jitProfile.size() - jitProfileSaved >= JIT_PROFILE_BATCH)
+      saveJitProfile();
+}
+
+void CppiaModule::saveJitProfile()
+{
+   if (jitCacheFile.empty() || (int)jitProfile.size()==jitProfileSaved)
+      return;
+   jitProfileSaved = jitProfile.size();
+
+   // Write a private copy and rename it, so concurrent workers never see half a file
+   char suffix[32];
+   #ifdef HX_WINDOWS
+   sprintf(suffix,".%d", (int)_getpid());
+   #else
+   sprintf(suffix,".%d", (int)getpid());
+   #endif
+   std::string temp = jitCacheFile + suffix;
+   FILE *file = fopen(temp.c_str(),"wb");
+   if (!file)
+      return;
+
+   unsigned long long key = jitKey;
+   JitProfileHeader header;
+   memcpy(header.magic,"HXJP",4);
+   header.version = JIT_PROFILE_VERSION;
+   header.keyLo = (unsigned int)key;
+   header.keyHi = (unsigned int)(key>>32);
+   header.callableCount = callables.size();
+   header.count = jitProfile.size();
+   bool ok = fwrite(&header,sizeof(header),1,file)==1 &&
+             fwrite(&jitProfile[0],sizeof(int),jitProfile.size(),file)==jitProfile.size();
+   ok = fclose(file)==0 && ok;
+
+   #ifdef HX_WINDOWS
+   if (ok)
+      remove(jitCacheFile.c_str());
+   #endif
+   if (!ok || rename(temp.c_str(), jitCacheFile.c_str())!=0)
+      remove(temp.c_str());
+}
 #endif
 
 void addScriptableClass(String inName);
@@ -367,6 +541,30 @@ CppiaLoadedModule LoadCppia(const unsigned char *inData, int inDataLength)
    CppiaModule   &cppia = *cppiaPtr;
    CppiaStream stream(cppiaPtr,inData, inDataLength);
 
+   #ifdef CPPIA_JIT
+   if (!sJitCacheDirSet)
+   {
+      const char *dir = getenv("HXCPP_CPPIA_JIT_CACHE");
+      sJitCacheDir = dir ? dir : "";
+      sJitCacheDirSet = true;
+   }
+   if (gEnableJit && gJitThreshold>0 && !sJitCacheDir.empty())
+   {
+      cppia.jitKey = jitCacheKey(inData, inDataLength);
+      char name[32];
+      sprintf(name,"cppia-%016llx.jit", cppia.jitKey);
+      char last = sJitCacheDir[sJitCacheDir.size()-1];
+      cppia.jitCacheFile = sJitCacheDir + (last=='/' || last=='\\' ? "" : "/") + name;
+      static bool saveAtExit = false;
+      if (!saveAtExit)
+      {
+         atexit(saveJitProfiles);
+         saveAtExit = true;
+      }
+      sJitProfileModules.push_back(cppiaPtr);
+   }
+   #endif
+
    String error;
    try
    {
@@ -480,7 +678,13 @@ CppiaLoadedModule LoadCppia(const unsigned char *inData, int inDataLength)
          error = String(errorString);
       }
 
-   if (gEnableJit)
+   #ifdef CPPIA_JIT
+   if (!error.raw_ptr() && !cppia.jitCacheFile.empty())
+      cppia.loadJitProfile();
+   #endif
+
+   // With a threshold, functions are compiled as they get hot instead
+   if (gEnableJit && gJitThreshold<=0)
    {
       #ifdef CPPIA_JIT
       if (!error.raw_ptr())
@@ -636,6 +840,56 @@ void __hxcpp_dbg_getScriptableClasses( Array< ::String> ioClasses )
 }
 
 
+// The loader copies everything it keeps, so the file only needs to be mapped for
+//  the duration of the load, and never has to be copied into a haxe string.
+::hx::CppiaLoadedModule __scriptable_cppia_from_file(String inFilename)
+{
+   #ifndef HX_WINDOWS
+   int fd = open(inFilename.utf8_str(), O_RDONLY);
+   if (fd<0)
+      hx::Throw( HX_CSTRING("Could not open cppia file ") + inFilename );
+
+   struct stat info;
+   if (fstat(fd,&info)!=0 || info.st_size<=0 || info.st_size>0x7fffffff)
+   {
+      close(fd);
+      hx::Throw( HX_CSTRING("Could not read cppia file ") + inFilename );
+   }
+   int length = (int)info.st_size;
+   void *mapped = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (mapped==MAP_FAILED)
+      hx::Throw( HX_CSTRING("Could not map cppia file ") + inFilename );
+
+   ::hx::CppiaLoadedModule module;
+   try
+   {
+      module = hx::LoadCppia( (const unsigned char *)mapped, length);
+   }
+   catch(...)
+   {
+      munmap(mapped, length);
+      throw;
+   }
+   munmap(mapped, length);
+   return module;
+   #else
+   FILE *file = _wfopen(inFilename.wchar_str(), L"rb");
+   if (!file)
+      hx::Throw( HX_CSTRING("Could not open cppia file ") + inFilename );
+   fseek(file,0,SEEK_END);
+   long length = ftell(file);
+   fseek(file,0,SEEK_SET);
+   std::vector<unsigned char> buffer(length>0 ? length : 1);
+   bool ok = length>0 && fread(&buffer[0],1,length,file)==(size_t)length;
+   fclose(file);
+   if (!ok)
+      hx::Throw( HX_CSTRING("Could not read cppia file ") + inFilename );
+   return hx::LoadCppia( &buffer[0], (int)length );
+   #endif
+}
+
+
 void __scriptable_load_cppia(String inCode)
 {
    const unsigned char *code = (const unsigned char *)inCode.raw_ptr();
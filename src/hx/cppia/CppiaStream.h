@@ -1,13 +1,64 @@
 #include <string>
-#include <map>
+#include <string.h>
+#include <algorithm>
 
 namespace hx
 {
 
+// Op names are looked up in static tables shared by all streams: binary ids index
+//  straight into an array, and text tokens are binary-searched in a sorted copy.
+struct CppiaOpTables
+{
+   struct OpName { int id; const char *name; };
+   enum { MAX_ID = 256 };
+
+   const char *names[MAX_ID];
+   OpName     sorted[256];
+   int        count;
+
+   static bool nameLess(const OpName &a, const OpName &b) { return strcmp(a.name,b.name)<0; }
+
+   CppiaOpTables()
+   {
+      static const OpName ops[] = {
+         #define CPPIA_OP(ident,name,id) { id, name },
+         #include "CppiaOps.inc"
+         #undef CPPIA_OP
+      };
+      count = sizeof(ops)/sizeof(ops[0]);
+      memset(names,0,sizeof(names));
+      for(int i=0;i<count;i++)
+      {
+         names[ ops[i].id ] = ops[i].name;
+         sorted[i] = ops[i];
+      }
+      std::sort(sorted, sorted+count, nameLess);
+   }
+
+   static const CppiaOpTables &get()
+   {
+      static CppiaOpTables tables;
+      return tables;
+   }
+
+   const char *nameOf(int inId) const
+   {
+      return inId>=0 && inId<MAX_ID && names[inId] ? names[inId] : "";
+   }
+
+   int idOf(const char *inName) const
+   {
+      OpName key = { 0, inName };
+      const OpName *found = std::lower_bound(sorted, sorted+count, key, nameLess);
+      if (found!=sorted+count && !strcmp(found->name,inName))
+         return found->id;
+      return 0;
+   }
+};
+
 struct CppiaStream
 {
-   std::map<int,std::string> tokenMap;
-   std::map<std::string,int> opMap;
+   const CppiaOpTables &ops;
    bool binary;
    class CppiaModule  *module;
    const char *data;
@@ -16,6 +67,7 @@ struct CppiaStream
    int pos;
 
    CppiaStream(class CppiaModule *inModule,const unsigned char *inData, int inLen)
+      : ops(CppiaOpTables::get())
    {
       binary = false;
       module = inModule;
@@ -25,33 +77,9 @@ struct CppiaStream
       pos = 1;
    }
 
-   struct OpName { int id; const char *name; };
    void setBinary(bool inBinary)
    {
       binary = inBinary;
-      OpName names[] = {
-         #define CPPIA_OP(ident,name,id) { id, name },
-         #include "CppiaOps.inc"
-         #undef CPPIA_OP
-      };
-      if (binary)
-      {
-         for(int i=0;i<sizeof(names)/sizeof(names[0]);i++)
-         {
-            OpName &name = names[i];
-            if (!tokenMap[name.id].empty())
-               throw "Double identifier";
-            tokenMap[ name.id ] = name.name;
-         }
-      }
-      else
-      {
-         for(int i=0;i<sizeof(names)/sizeof(names[0]);i++)
-         {
-            OpName &name = names[i];
-            opMap[ name.name ] = name.id;
-         }
-      }
    }
    void skipWhitespace()
    {
@@ -107,7 +135,7 @@ struct CppiaStream
       if (binary)
          return (CppiaOp) getInt();
       std::string tok = getAsciiToken();
-      CppiaOp result = (CppiaOp)opMap[tok];
+      CppiaOp result = (CppiaOp)ops.idOf(tok.c_str());
       if (result==0)
          throw "Unknown token";
       return result;
@@ -118,9 +146,7 @@ struct CppiaStream
    {
       if (!binary)
          return getAsciiToken();
-      int id = getInt();
-      //printf("Token %s\n", tokenMap[id].c_str());
-      return tokenMap[id];
+      return ops.nameOf(getInt());
    }
 
    int getAsciiInt()
@@ -186,14 +212,32 @@ struct CppiaStream
       return getBool();
    }
 
+   // Skip a run of bytes, only visiting the new-lines to keep the position right
+   void skipBytes(int inLen)
+   {
+      if (inLen<0 || inLen>max-data)
+         throw "EOF";
+      const char *end = data + inLen;
+      const char *lineStart = data;
+      while(true)
+      {
+         const char *nl = (const char *)memchr(lineStart, '\n', end-lineStart);
+         if (!nl)
+            break;
+         line++;
+         pos = 1;
+         lineStart = nl + 1;
+      }
+      pos += end-lineStart;
+      data = end;
+   }
+
    String readString(std::string *outStdStdString=0)
    {
       int len = getAsciiInt();
       skipChar();
       const char *data0 = data;
-      int hasBig = false;
-      for(int i=0;i<len;i++)
-         skipChar();
+      skipBytes(len);
       if (outStdStdString)
          *outStdStdString = std::string(data0, data);
       return String::createPermanent(data0,data-data0);
@@ -90,6 +90,49 @@ HaxeNativeClass *HaxeNativeClass::hxObject()
    return sScriptRegistered ? (*sScriptRegistered)["hx.Object"] : 0;
 }
 
+static unsigned long long hashString(unsigned long long ioHash, const char *inString)
+{
+   if (inString)
+      for(const char *s = inString; *s; s++)
+         ioHash = (ioHash ^ (unsigned char)*s) * 1099511628211ULL;
+   return (ioHash ^ 0xff) * 1099511628211ULL;
+}
+
+static unsigned long long hashFunctions(unsigned long long ioHash, ScriptNamedFunction *inFunctions)
+{
+   if (inFunctions)
+      for(ScriptNamedFunction *f=inFunctions;f->name;f++)
+      {
+         ioHash = hashString(ioHash, f->name);
+         ioHash = hashString(ioHash, f->signature);
+         ioHash = (ioHash ^ (f->isStatic ? 1 : 0)) * 1099511628211ULL;
+      }
+   return ioHash;
+}
+
+// Folds the registered host classes and interfaces - names, data offsets and function
+//  signatures - into an fnv-1a hash, so anything linked against them can tell if they changed
+unsigned long long HaxeNativeClass::layoutHash(unsigned long long inHash)
+{
+   unsigned long long hash = inHash;
+   if (sScriptRegistered)
+      for(ScriptRegisteredMap::iterator i = sScriptRegistered->begin(); i!=sScriptRegistered->end();++i)
+         if (i->second)
+         {
+            hash = hashString(hash, i->first.c_str());
+            hash = (hash ^ (unsigned int)i->second->mDataOffset) * 1099511628211ULL;
+            hash = hashFunctions(hash, i->second->functions);
+         }
+   if (sScriptRegisteredInterface)
+      for(HaxeNativeIntefaceMap::iterator i = sScriptRegisteredInterface->begin(); i!=sScriptRegisteredInterface->end();++i)
+         if (i->second)
+         {
+            hash = hashString(hash, i->first.c_str());
+            hash = hashFunctions(hash, i->second->functions);
+         }
+   return hash;
+}
+
 void HaxeNativeClass::link()
 {
    HaxeNativeClass *hxObj = hxObject();
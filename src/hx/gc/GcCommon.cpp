@@ -4,6 +4,7 @@
 #include <vector>
 #include <set>
 #include <stdlib.h>
+#include <math.h>
 
 #if defined(HXCPP_CAPTURE_x64) && !defined(__GNUC__)
 #include <windows.h>
@@ -29,12 +30,21 @@ namespace hx
 #if defined(HX_MACOS) || defined(HX_WINDOWS) || defined(HX_LINUX) || defined(__ORBIS__)
 int sgMinimumWorkingMemory       = 20*1024*1024;
 int sgMinimumFreeSpace           = 10*1024*1024;
+int sgNurserySize                = 8*1024*1024;
 #else
 int sgMinimumWorkingMemory       = 8*1024*1024;
 int sgMinimumFreeSpace           = 4*1024*1024;
+int sgNurserySize                = 2*1024*1024;
 #endif
 // Once you use more than the minimum, this kicks in...
 int sgTargetFreeSpacePercentage  = 100;
+// Only used with HXCPP_GC_CONCURRENT
+int sgConcurrentMarkStartPercentage = 50;
+// Collector worker threads, 0 for one per core
+int sgGcThreads = 0;
+// Zero free blocks on the allocating thread rather than the background zero thread.
+//  -1 does this automatically on machines with many cores
+int sgGcLazyZero = -1;
 
 
 
@@ -69,9 +79,94 @@ void CommonInitAlloc()
       if (percent>0)
          sgTargetFreeSpacePercentage = percent;
    }
+
+   const char *concurrentStart = getenv("HXCPP_GC_CONCURRENT_START");
+   if (concurrentStart)
+   {
+      int percent =  atoi(concurrentStart);
+      if (percent>0 && percent<=100)
+         sgConcurrentMarkStartPercentage = percent;
+   }
+
+   const char *nurserySize = getenv("HXCPP_GC_NURSERY_SIZE");
+   if (nurserySize && *nurserySize)
+   {
+      int mem =  atoi(nurserySize);
+      if (mem>=0)
+         sgNurserySize = mem;
+   }
+
+   const char *gcThreads = getenv("HXCPP_GC_THREADS");
+   if (gcThreads)
+   {
+      int threads =  atoi(gcThreads);
+      if (threads>0)
+         sgGcThreads = threads;
+   }
+
+   const char *lazyZero = getenv("HXCPP_GC_LAZY_ZERO");
+   if (lazyZero && *lazyZero)
+      sgGcLazyZero = atoi(lazyZero)!=0;
+
+   const char *gcEvents = getenv("HXCPP_GC_EVENTS");
+   if (gcEvents && *gcEvents && *gcEvents!='0')
+      gGcEventsEnabled = true;
    #endif
 }
 
+
+// --- GC event log ---------------------------------------------------------
+
+bool gGcEventsEnabled = false;
+
+enum { GC_EVENT_LOG_SIZE = 256, GC_PAUSE_BUCKETS = 96 };
+
+struct GcEventSlot
+{
+   volatile int serial;
+   GcEvent      event;
+};
+
+// Only the collecting thread writes, so the serial number is enough to detect
+//  a slot being reused while it is read
+static GcEventSlot  sGcEventLog[GC_EVENT_LOG_SIZE];
+static volatile int sGcEventSerial = 0;
+
+// Four buckets per doubling, bucket 0 holding everything up to 1us
+static int    sGcPauseBuckets[GC_PAUSE_BUCKETS];
+static int    sGcPauseCount = 0;
+static double sGcPauseMax = 0;
+
+static int GcPauseBucket(double inSeconds)
+{
+   double us = inSeconds*1000000.0;
+   if (us<=1.0)
+      return 0;
+   int bucket = (int)ceil( log(us)*(4.0/log(2.0)) );
+   return bucket<GC_PAUSE_BUCKETS ? bucket : GC_PAUSE_BUCKETS-1;
+}
+
+static double GcPauseBucketLimit(int inBucket)
+{
+   return pow(2.0, inBucket*0.25) * 0.000001;
+}
+
+void GcAddEvent(const GcEvent &inEvent)
+{
+   int serial = sGcEventSerial + 1;
+   GcEventSlot &slot = sGcEventLog[serial & (GC_EVENT_LOG_SIZE-1)];
+   _hx_atomic_exchange(&slot.serial, 0);
+   slot.event = inEvent;
+   _hx_atomic_exchange(&slot.serial, serial);
+   _hx_atomic_exchange(&sGcEventSerial, serial);
+
+   double pause = inEvent.end - inEvent.start;
+   sGcPauseBuckets[ GcPauseBucket(pause) ]++;
+   sGcPauseCount++;
+   if (pause>sGcPauseMax)
+      sGcPauseMax = pause;
+}
+
 } // end namespace hx
 
 
@@ -113,7 +208,18 @@ void GCAddFinalizer(hx::Object *v, finalizer f)
 
 HX_CHAR *NewString(int inLen)
 {
-   char *result =  (char *)hx::InternalNew( (inLen+1)*sizeof(char), false );
+   char *result;
+   #ifndef HXCPP_NO_STRING_HASH_CACHE
+   if (inLen>=HX_GC_STRING_HASH_SLOT_MIN)
+   {
+      int slot = (inLen+4) & ~3;
+      result =  (char *)hx::InternalNew( slot + sizeof(int), false );
+      *(unsigned int *)(result + slot) = 0;
+      ((unsigned int *)result)[-1] |= HX_GC_STRING_HASH_SLOT;
+   }
+   else
+   #endif
+   result =  (char *)hx::InternalNew( (inLen+1)*sizeof(char), false );
    result[inLen] = '\0';
 #ifdef HXCPP_TELEMETRY
    __hxt_new_string(result, inLen+1);
@@ -170,6 +276,95 @@ void  __hxcpp_set_target_free_space_percentage(int inPercentage)
    hx::sgTargetFreeSpacePercentage = inPercentage;
 }
 
+void  __hxcpp_set_concurrent_mark_start_percentage(int inPercentage)
+{
+   if (inPercentage>0 && inPercentage<=100)
+      hx::sgConcurrentMarkStartPercentage = inPercentage;
+}
+
+void  __hxcpp_set_nursery_size(int inBytes)
+{
+   if (inBytes>=0)
+      hx::sgNurserySize = inBytes;
+}
+
+int  __hxcpp_get_nursery_size()
+{
+   return hx::sgNurserySize;
+}
+
+void  __hxcpp_set_gc_threads(int inThreads)
+{
+   if (inThreads>=0)
+      hx::sgGcThreads = inThreads;
+}
+
+void __hxcpp_gc_enable_events(bool inEnable)
+{
+   hx::gGcEventsEnabled = inEnable;
+}
+
+int __hxcpp_gc_get_events(int inSinceSerial, Array<Float> outRecords)
+{
+   int latest = _hx_atomic_load(&hx::sGcEventSerial);
+   int first = std::max( std::max(inSinceSerial+1, latest-hx::GC_EVENT_LOG_SIZE+1), 1);
+   for(int s=first; s<=latest; s++)
+   {
+      hx::GcEventSlot &slot = hx::sGcEventLog[s & (hx::GC_EVENT_LOG_SIZE-1)];
+      if (_hx_atomic_load(&slot.serial)!=s)
+         continue;
+      hx::GcEvent e = slot.event;
+      // Overwritten while copying?
+      if (_hx_atomic_compare_exchange(&slot.serial, s, s)!=s)
+         continue;
+
+      outRecords->push(s);
+      outRecords->push(e.major ? 1 : 0);
+      outRecords->push(e.start);
+      outRecords->push(e.end);
+      outRecords->push(e.mark);
+      outRecords->push(e.finalize);
+      outRecords->push(e.reclaim);
+      outRecords->push(e.move);
+      outRecords->push(e.bytesFreed);
+      outRecords->push(e.blocksMoved);
+      outRecords->push(e.threads);
+   }
+   return latest;
+}
+
+double __hxcpp_gc_pause_percentile(double inPercentile)
+{
+   int count = hx::sGcPauseCount;
+   if (!count)
+      return 0;
+   if (inPercentile>=100)
+      return hx::sGcPauseMax;
+
+   double target = inPercentile*count/100.0;
+   int sum = 0;
+   for(int b=0;b<hx::GC_PAUSE_BUCKETS;b++)
+   {
+      sum += hx::sGcPauseBuckets[b];
+      if (sum>0 && sum>=target)
+         return std::min( hx::GcPauseBucketLimit(b), hx::sGcPauseMax );
+   }
+   return hx::sGcPauseMax;
+}
+
+int __hxcpp_gc_pause_count()
+{
+   return hx::sGcPauseCount;
+}
+
+void __hxcpp_gc_reset_pause_stats()
+{
+   for(int b=0;b<hx::GC_PAUSE_BUCKETS;b++)
+      hx::sGcPauseBuckets[b] = 0;
+   hx::sGcPauseCount = 0;
+   hx::sGcPauseMax = 0;
+}
+
 bool __hxcpp_is_const_string(const ::String &inString)
 {
    #ifdef HXCPP_ALIGN_ALLOC
@@ -49,6 +49,8 @@ enum { gAlwaysMove = false };
 
 #ifdef HX_WINDOWS
 #include <windows.h>
+#else
+#include <unistd.h>
 #endif
 
 #include <vector>
@@ -191,7 +193,8 @@ static bool sGcVerifyGenerational = false;
 
 #if HX_HAS_ATOMIC && (HXCPP_GC_DEBUG_LEVEL==0) && !defined(HX_GC_VERIFY) && !defined(EMSCRIPTEN)
   #if defined(HX_MACOS) || defined(HX_WINDOWS) || defined(HX_LINUX)
-  enum { MAX_GC_THREADS = 4 };
+  // Upper limit (one bit each in sRunningThreads) - the pool size comes from the core count
+  enum { MAX_GC_THREADS = 32 };
   #else
   enum { MAX_GC_THREADS = 2 };
   #endif
@@ -204,6 +207,18 @@ static bool sGcVerifyGenerational = false;
    #define HX_MULTI_THREAD_MARKING
 #endif
 
+// Background marking needs the marking thread pool, and other threads to run while it works.
+// Without these, HXCPP_GC_CONCURRENT builds fall back to the stop-the-world collector.
+#if defined(HXCPP_GC_CONCURRENT) && defined(HX_MULTI_THREAD_MARKING) && !defined(HXCPP_SINGLE_THREADED_APP)
+   #define HX_GC_CONCURRENT_MARK
+#endif
+
+// Generational builds bound the nursery: once sgNurserySize has been handed out since the
+//  last collect, a minor collection is done rather than waiting for the heap to fill
+#if defined(HXCPP_GC_GENERATIONAL) && !defined(HXCPP_GC_CONCURRENT)
+   #define HX_GC_NURSERY_BUDGET
+#endif
+
 #ifdef PROFILE_THREAD_USAGE
 static int sThreadMarkCountData[MAX_GC_THREADS+1];
 static int sThreadArrayMarkCountData[MAX_GC_THREADS+1];
@@ -283,6 +298,9 @@ volatile int sgAllocsSinceLastSpam = 0;
    #define MEM_STAMP(t)
 #endif
 
+// Phase times for the GC event log, only read when logEvent is set
+#define EVENT_STAMP(t) double t = logEvent ? __hxcpp_time_stamp() : 0;
+
 #if defined(HXCPP_GC_SUMMARY) || defined(HXCPP_GC_DYNAMIC_SIZE)
 struct ProfileCollectSummary
 {
@@ -406,6 +424,9 @@ static void WaitForSafe(LocalAllocator *inAlloc);
 static void ReleaseFromSafe(LocalAllocator *inAlloc);
 static void ClearPooledAlloc(LocalAllocator *inAlloc);
 static void CollectFromThisThread(bool inMajor,bool inForceCompact);
+#ifdef HX_GC_CONCURRENT_MARK
+static void BeginConcurrentMarkFromThisThread();
+#endif
 
 namespace hx
 {
@@ -418,9 +439,26 @@ unsigned int gImmixStartFlag[128];
 int gMarkID = 0x10 << 24;
 int gMarkIDWithContainer = (0x10 << 24) | IMMIX_ALLOC_IS_CONTAINER;
 
+#ifdef HXCPP_GC_CONCURRENT
+int gConcurrentMarking = 0;
+#endif
+
 int gPrevByteMarkID = 0x2f;
 unsigned int gPrevMarkIdMask = ((~0x2f000000) & 0x30000000) | HX_GC_CONST_ALLOC_BIT;
 
+#ifdef HXCPP_SCRIPTABLE
+// Value the cppia jit compares against before calling the write barrier
+static inline int JitByteMarkId()
+{
+   #ifdef HXCPP_GC_CONCURRENT
+   // The barrier is only needed while marking in the background
+   return gConcurrentMarking ? gByteMarkID : 0;
+   #else
+   return gByteMarkID;
+   #endif
+}
+#endif
+
 
 
 
@@ -592,7 +630,7 @@ typedef TAutoLock<ThreadPoolLock> ThreadPoolAutoLock;
 static unsigned int sRunningThreads = 0;
 static unsigned int sAllThreads = 0;
 static bool sLazyThreads = false;
-static bool sThreadPoolInit = false;
+static int sThreadPoolSize = 0;
 
 enum ThreadPoolJob
 {
@@ -629,9 +667,39 @@ static inline void SignalThreadPool(ThreadPoolSignal &ioSignal, bool sThreadSlee
    #endif
 }
 
+static inline unsigned int ThreadPoolMask(int inThreads)
+{
+   return inThreads>=32 ? 0xffffffff : (1u<<inThreads) - 1;
+}
+
+static int GetCpuCount()
+{
+   static int sCpuCount = 0;
+   if (!sCpuCount)
+   {
+      #if defined(HX_WINDOWS) && !defined(HX_WINRT)
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      sCpuCount = (int)info.dwNumberOfProcessors;
+      #elif defined(_SC_NPROCESSORS_ONLN)
+      sCpuCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+      #endif
+      if (sCpuCount<1)
+         sCpuCount = 4;
+   }
+   return sCpuCount;
+}
+
+// Size of the worker pool for the next job
+static int GetGcThreadCount()
+{
+   int threads = hx::sgGcThreads>0 ? hx::sgGcThreads : GetCpuCount();
+   return std::max(1, std::min((int)MAX_GC_THREADS, threads) );
+}
+
 static void wakeThreadLocked(int inThreadId)
 {
-   sRunningThreads |= (1<<inThreadId);
+   sRunningThreads |= (1u<<inThreadId);
    sLazyThreads = sRunningThreads != sAllThreads;
    SignalThreadPool(sThreadWake[inThreadId],sThreadSleeping[inThreadId]);
 }
@@ -1488,11 +1556,17 @@ struct GlobalChunks
    volatile int       processListPopLock;
    volatile MarkChunk *freeList;
    volatile int       freeListPopLock;
+   #ifdef HX_GC_CONCURRENT_MARK
+   volatile MarkChunk *rememberedList;
+   #endif
 
    GlobalChunks()
    {
       processList = 0;
       freeList = 0;
+      #ifdef HX_GC_CONCURRENT_MARK
+      rememberedList = 0;
+      #endif
       freeListPopLock = 0;
       processListPopLock = 0;
    }
@@ -1510,6 +1584,33 @@ struct GlobalChunks
       return alloc();
    }
 
+   #ifdef HX_GC_CONCURRENT_MARK
+   // Objects written to while the background marker is running - these are kept out
+   //  of the processList and re-scanned in the final, stop-the-world, mark.
+   MarkChunk *pushRemembered(MarkChunk *inChunk,bool inAndAlloc)
+   {
+      while(true)
+      {
+         MarkChunk *head = (MarkChunk *)rememberedList;
+         inChunk->next = head;
+         if (_hx_atomic_compare_exchange_cast_ptr(&rememberedList, head, inChunk) == head)
+            break;
+      }
+
+      if (inAndAlloc)
+         return alloc();
+      return 0;
+   }
+
+   // Must be called while the world is stopped
+   MarkChunk *takeRemembered()
+   {
+      MarkChunk *result = (MarkChunk *)rememberedList;
+      rememberedList = 0;
+      return result;
+   }
+   #endif
+
    MarkChunk *pushJob(MarkChunk *inChunk,bool inAndAlloc)
    {
       while(true)
@@ -1528,28 +1629,16 @@ struct GlobalChunks
       {
          ThreadPoolAutoLock l(sThreadPoolLock);
 
-         #ifdef PROFILE_THREAD_USAGE
-           #define CHECK_THREAD_WAKE(tid) \
-            if (MAX_GC_THREADS >tid && sgThreadCount>tid && (!(sRunningThreads & (1<<tid)))) { \
-            wakeThreadLocked(tid); \
-            sThreadChunkWakes++; \
-           } 
-         #else
-           #define CHECK_THREAD_WAKE(tid)  \
-            if (MAX_GC_THREADS >tid && sgThreadCount>tid && (!(sRunningThreads & (1<<tid)))) { \
-            wakeThreadLocked(tid); \
-           }
-         #endif
-
-
-         CHECK_THREAD_WAKE(0)
-         else CHECK_THREAD_WAKE(1)
-         else CHECK_THREAD_WAKE(2)
-         else CHECK_THREAD_WAKE(3)
-         else CHECK_THREAD_WAKE(4)
-         else CHECK_THREAD_WAKE(5)
-         else CHECK_THREAD_WAKE(6)
-         else CHECK_THREAD_WAKE(7)
+         // Wake the first idle worker
+         for(int tid=0; tid<sgThreadCount; tid++)
+            if (!(sRunningThreads & (1u<<tid)))
+            {
+               wakeThreadLocked(tid);
+               #ifdef PROFILE_THREAD_USAGE
+               sThreadChunkWakes++;
+               #endif
+               break;
+            }
       }
 
       if (inAndAlloc)
@@ -1666,12 +1755,12 @@ struct GlobalChunks
 
    void completeThreadLocked(int inThreadId)
    {
-      if (!(sRunningThreads & (1<<inThreadId)))
+      if (!(sRunningThreads & (1u<<inThreadId)))
       {
          printf("Complete non-running thread?\n");
          DebuggerTrap();
       }
-      sRunningThreads &= ~(1<<inThreadId);
+      sRunningThreads &= ~(1u<<inThreadId);
       sLazyThreads = sRunningThreads != sAllThreads;
 
       if (!sRunningThreads)
@@ -1691,7 +1780,7 @@ struct GlobalChunks
          {
             for(int spinCount = 0; spinCount<10000; spinCount++)
             {
-               if ( sgThreadPoolAbort || sAllThreads == (1<<inThreadId) )
+               if ( sgThreadPoolAbort || sAllThreads == (1u<<inThreadId) )
                   break;
                if (processList)
                {
@@ -1887,16 +1976,39 @@ public:
        marking = 0;
     }
 
+    #ifdef HX_MULTI_THREAD_MARKING
+    // Return the unfinished work to the processList so it can be picked up later,
+    //  and let StopThreadJobs know this thread has stopped
+    void abortMarking()
+    {
+       releaseJobs();
+       if (mThreadId>=0)
+       {
+          ThreadPoolAutoLock l(sThreadPoolLock);
+          sGlobalChunks.completeThreadLocked(mThreadId);
+       }
+    }
+    #endif
+
     void processMarkStack()
     {
        while(true)
        {
+          #ifdef HX_GC_CONCURRENT_MARK
+          // The background marker is stopped when the final mark starts
+          if (sgThreadPoolAbort)
+          {
+             abortMarking();
+             return;
+          }
+          #endif
+
           if (!marking || !marking->count)
           {
-             #ifdef HX_MULTI_THREAD_MARKING
+             #if defined(HX_MULTI_THREAD_MARKING) && !defined(HX_GC_CONCURRENT_MARK)
              if (sgThreadPoolAbort)
              {
-                releaseJobs();
+                abortMarking();
                 return;
              }
              #endif
@@ -1917,6 +2029,10 @@ public:
 
           while(marking)
           {
+             #ifdef HX_GC_CONCURRENT_MARK
+             if (sgThreadPoolAbort)
+                break;
+             #endif
              hx::Object *obj = marking->pop();
              if (obj)
              {
@@ -3115,6 +3231,17 @@ public:
       mCurrentRowsInUse = 0;
       mAllBlocksCount = 0;
       mGenerationalRetainEstimate = 0.5;
+      mFinalizeTime = 0;
+      mBlocksMoved = 0;
+      #ifdef HX_GC_CONCURRENT_MARK
+      mConcurrentCycle = false;
+      mConcurrentMarkTrigger = 0;
+      mConcurrentBlocksTaken = 0;
+      #endif
+      #ifdef HX_GC_NURSERY_BUDGET
+      mNurseryTrigger = 0;
+      mNurseryBlocksTaken = 0;
+      #endif
       for(int p=0;p<LOCAL_POOL_SIZE;p++)
          mLocalPool[p] = 0;
 
@@ -3176,6 +3303,12 @@ public:
 
    void FreeLarge(void *inLarge)
    {
+      #ifdef HX_GC_CONCURRENT_MARK
+      // A marking thread may still be reading it - let the sweep free it
+      if (mConcurrentCycle)
+         return;
+      #endif
+
       ((unsigned char *)inLarge)[HX_ENDIAN_MARK_ID_BYTE] = 0;
       // AllocLarge will not lock this list unless it decides there is a suitable
       //  value, so we can't doa realloc without potentially crashing it.
@@ -3554,6 +3687,13 @@ public:
 
    BlockDataInfo *GetFreeBlock(int inRequiredBytes, hx::ImmixAllocator *inAlloc)
    {
+      #ifdef HX_GC_CONCURRENT_MARK
+      CheckConcurrentMark(inAlloc);
+      #endif
+      #ifdef HX_GC_NURSERY_BUDGET
+      CheckNurseryBudget(inAlloc);
+      #endif
+
       while(true)
       {
          BlockDataInfo *result = GetNextFree(inRequiredBytes);
@@ -3837,6 +3977,7 @@ public:
       #ifdef SHOW_FRAGMENTATION
       GCLOG("Moved %d objects (%d/%d blocks)\n", moveObjs, clearedBlocks, mAllBlocks.size());
       #endif
+      mBlocksMoved += clearedBlocks;
 
       if (moveObjs)
       {
@@ -4276,44 +4417,57 @@ public:
 
    #endif
 
-   void ReclaimAsync(BlockDataStats &outStats)
+   // Workers take contiguous ranges of the job, starting large and shrinking towards the end
+   //  so threads finish together.  This keeps each worker in its own part of the heap, and
+   //  avoids all the workers contending on mThreadJobId for every block.
+   bool claimJobRange(int inCount, int &outStart, int &outEnd)
    {
       while(!sgThreadPoolAbort)
       {
-         int blockId = _hx_atomic_add(&mThreadJobId, 1);
-         if (blockId>=mAllBlocks.size())
-            break;
+         int start = mThreadJobId;
+         if (start>=inCount)
+            return false;
+         int chunk = (inCount-start) / (sgThreadCount*4);
+         chunk = std::max(1, std::min(chunk, 64));
+         if (_hx_atomic_compare_exchange(&mThreadJobId, start, start+chunk)==start)
+         {
+            outStart = start;
+            outEnd = std::min(start+chunk, inCount);
+            return true;
+         }
+      }
+      return false;
+   }
 
+   void ReclaimAsync(BlockDataStats &outStats)
+   {
+      int start, end;
+      while(claimJobRange(mAllBlocks.size(),start,end))
+      {
          if ( sgThreadPoolJob==tpjReclaimFull)
-            mAllBlocks[blockId]->reclaim<true>(&outStats);
+            for(int blockId=start; blockId<end; blockId++)
+               mAllBlocks[blockId]->reclaim<true>(&outStats);
          else
-            mAllBlocks[blockId]->reclaim<false>(&outStats);
+            for(int blockId=start; blockId<end; blockId++)
+               mAllBlocks[blockId]->reclaim<false>(&outStats);
       }
    }
 
    void CountAsync(BlockDataStats &outStats)
    {
-      while(!sgThreadPoolAbort)
-      {
-         int blockId = _hx_atomic_add(&mThreadJobId, 1);
-         if (blockId>=mAllBlocks.size())
-            break;
-
-         mAllBlocks[blockId]->countRows(outStats);
-      }
+      int start, end;
+      while(claimJobRange(mAllBlocks.size(),start,end))
+         for(int blockId=start; blockId<end; blockId++)
+            mAllBlocks[blockId]->countRows(outStats);
    }
 
 
    void GetStatsAsync(BlockDataStats &outStats)
    {
-      while(!sgThreadPoolAbort)
-      {
-         int blockId = _hx_atomic_add(&mThreadJobId, 1);
-         if (blockId>=mAllBlocks.size())
-            break;
-
-         mAllBlocks[blockId]->getStats( outStats );
-      }
+      int start, end;
+      while(claimJobRange(mAllBlocks.size(),start,end))
+         for(int blockId=start; blockId<end; blockId++)
+            mAllBlocks[blockId]->getStats( outStats );
    }
 
   
@@ -4321,29 +4475,20 @@ public:
    #ifdef HXCPP_VISIT_ALLOCS
    void VisitBlockAsync(hx::VisitContext *inCtx)
    {
-      while(!sgThreadPoolAbort)
-      {
-         int blockId = _hx_atomic_add(&mThreadJobId, 1);
-         if (blockId>=mAllBlocks.size())
-            break;
-
-         mAllBlocks[blockId]->VisitBlock(inCtx);
-      }
+      int start, end;
+      while(claimJobRange(mAllBlocks.size(),start,end))
+         for(int blockId=start; blockId<end; blockId++)
+            mAllBlocks[blockId]->VisitBlock(inCtx);
    }
    #endif
 
 
    void ZeroAsync()
    {
-      while(!sgThreadPoolAbort)
-      {
-         int zeroListId = _hx_atomic_add(&mThreadJobId, 1);
-         if (zeroListId>=mZeroList.size())
-            break;
-
-         BlockDataInfo *info = mZeroList[zeroListId];
-         info->tryZero();
-      }
+      int start, end;
+      while(claimJobRange(mZeroList.size(),start,end))
+         for(int zeroListId=start; zeroListId<end; zeroListId++)
+            mZeroList[zeroListId]->tryZero();
    }
 
    bool ZeroAsyncJit()
@@ -4387,6 +4532,12 @@ public:
    // Try to maintain between sMinZeroQueueSize and sMaxZeroQueueSize pre-zeroed blocks
    void onZeroedBlockDequeued()
    {
+      #ifdef HX_GC_CONCURRENT_MARK
+      // The thread pool belongs to the marker
+      if (mConcurrentCycle)
+         return;
+      #endif
+
       // Wake the thread?
       if (_hx_atomic_sub(&mZeroListQueue, 1)<sMinZeroQueueSize && !sRunningThreads)
       {
@@ -4409,9 +4560,9 @@ public:
    void finishThreadJob(int inId)
    {
       ThreadPoolAutoLock l(sThreadPoolLock);
-      if (sRunningThreads & (1<<inId))
+      if (sRunningThreads & (1u<<inId))
       {
-         sRunningThreads &= ~(1<<inId);
+         sRunningThreads &= ~(1u<<inId);
          sLazyThreads = sRunningThreads != sAllThreads;
 
          if (!sRunningThreads)
@@ -4434,12 +4585,12 @@ public:
          // May be woken multiple times if sRunningThreads is set to 0 then 1 before we sleep
          sThreadSleeping[inId] = true;
          // Spurious wake?
-         while( !(sRunningThreads & (1<<inId) ) )
+         while( !(sRunningThreads & (1u<<inId) ) )
             WaitThreadLocked(sThreadWake[inId]);
          sThreadSleeping[inId] = false;
       }
       #else
-      while( !(sRunningThreads & (1<<inId) ) )
+      while( !(sRunningThreads & (1u<<inId) ) )
          sThreadWake[inId].Wait();
       #endif
    }
@@ -4454,7 +4605,7 @@ public:
          waitForThreadWake(inId);
 
          #ifdef HX_GC_VERIFY
-         if (! (sRunningThreads & (1<<inId)) )
+         if (! (sRunningThreads & (1u<<inId)) )
             printf("Bad running threads!\n");
          #endif
 
@@ -4568,12 +4719,10 @@ public:
       if (!inWorkers)
          return;
 
-      if (!sThreadPoolInit)
-      {
-         sThreadPoolInit = true;
-         for(int i=0;i<MAX_GC_THREADS;i++)
-            CreateWorker(i);
-      }
+      // Workers are created as the pool grows, and then persist
+      int poolSize = GetGcThreadCount();
+      while(sThreadPoolSize<poolSize)
+         CreateWorker(sThreadPoolSize++);
 
       #ifdef HX_GC_PTHREADS
       ThreadPoolAutoLock lock(sThreadPoolLock);
@@ -4582,13 +4731,13 @@ public:
 
       sgThreadPoolJob = inJob;
 
-      sgThreadCount = inThreadLimit<0 ? MAX_GC_THREADS : std::min((int)MAX_GC_THREADS, inThreadLimit) ;
+      sgThreadCount = inThreadLimit<0 ? poolSize : std::min(poolSize, inThreadLimit) ;
 
       int start = std::min(inWorkers, sgThreadCount );
 
-      sAllThreads = (1<<sgThreadCount) - 1;
+      sAllThreads = ThreadPoolMask(sgThreadCount);
 
-      sRunningThreads = (1<<start) - 1;
+      sRunningThreads = ThreadPoolMask(start);
 
       sLazyThreads = sRunningThreads != sAllThreads;
 
@@ -4643,8 +4792,26 @@ public:
    double tMarkLocal;
    double tMarkLocalEnd;
    double tMarked;
-   void MarkAll(bool inGenerational)
+
+   // Publish the current cycle id to the allocator.  Objects allocated before this
+   //  point will be considered unreachable unless they have been marked.
+   void UpdateAllocMarkId()
    {
+      hx::gMarkID = gByteMarkID << 24;
+      hx::gMarkIDWithContainer = (gByteMarkID << 24) | IMMIX_ALLOC_IS_CONTAINER;
+      gRememberedByteMarkID = gByteMarkID | HX_GC_REMEMBERED;
+   }
+
+   void MarkAll(bool inGenerational, bool inBeginConcurrent=false)
+   {
+      #ifdef HX_GC_CONCURRENT_MARK
+      if (mConcurrentCycle)
+      {
+         // Cycle was started by BeginConcurrentMark
+         UpdateAllocMarkId();
+      }
+      else
+      #endif
       if (!inGenerational)
       {
          hx::gPrevByteMarkID = hx::gByteMarkID;
@@ -4666,9 +4833,10 @@ public:
          else
             gByteMarkID |= 0x10;
 
-         hx::gMarkID = gByteMarkID << 24;
-         hx::gMarkIDWithContainer = (gByteMarkID << 24) | IMMIX_ALLOC_IS_CONTAINER;
-         gRememberedByteMarkID = gByteMarkID | HX_GC_REMEMBERED;
+         // While marking in the background, new objects keep the old id so that the final
+         //  mark decides whether they live or not
+         if (!inBeginConcurrent)
+            UpdateAllocMarkId();
 
          #ifdef HX_WATCH
          GCLOG(" non-gen mark byte -> %02x\n", hx::gByteMarkID);
@@ -4696,6 +4864,11 @@ public:
 
       mMarker.init();
 
+      #ifdef HX_GC_CONCURRENT_MARK
+      if (mConcurrentCycle)
+         MarkRemembered();
+      #endif
+
       hx::MarkClassStatics(&mMarker);
 
       {
@@ -4749,6 +4922,15 @@ public:
 
       MEM_STAMP(tMarkLocalEnd);
 
+      #ifdef HX_GC_CONCURRENT_MARK
+      if (inBeginConcurrent)
+      {
+         // The rest is traced in the background
+         mMarker.releaseJobs();
+         return;
+      }
+      #endif
+
       #ifdef HX_MULTI_THREAD_MARKING
          mMarker.releaseJobs();
 
@@ -4762,10 +4944,15 @@ public:
 
       MEM_STAMP(tMarked);
 
+      double finalizeStart = hx::gGcEventsEnabled ? __hxcpp_time_stamp() : 0;
+
       hx::FindZombies(mMarker);
 
       hx::RunFinalizers();
 
+      if (finalizeStart)
+         mFinalizeTime += __hxcpp_time_stamp() - finalizeStart;
+
       #ifdef HX_GC_VERIFY
       for(int i=0;i<mAllBlocks.size();i++)
          mAllBlocks[i]->verify("After mark");
@@ -4782,6 +4969,137 @@ public:
 
 
    
+   #ifdef HX_GC_CONCURRENT_MARK
+   void MarkRememberedChunk(MarkChunk *inChunk)
+   {
+      for(int i=0;i<inChunk->count;i++)
+      {
+         hx::Object *obj = inChunk->stack[i];
+         // Clear the HX_GC_REMEMBERED bit, and scan the object again
+         ((unsigned char *)obj)[HX_ENDIAN_MARK_ID_BYTE] = gByteMarkID;
+         mMarker.pushObj(obj);
+      }
+      inChunk->count = 0;
+   }
+
+   // Objects that were written to while the background marker was running
+   void MarkRemembered()
+   {
+      MarkChunk *chunk = hx::sGlobalChunks.takeRemembered();
+      while(chunk)
+      {
+         MarkChunk *next = chunk->next;
+         MarkRememberedChunk(chunk);
+         hx::sGlobalChunks.free(chunk);
+         chunk = next;
+      }
+
+      for(int i=0;i<mLocalAllocs.size();i++)
+      {
+         hx::StackContext *ctx = (hx::StackContext *)mLocalAllocs[i];
+         if (ctx->mOldReferrers)
+            MarkRememberedChunk(ctx->mOldReferrers);
+      }
+   }
+
+   // Stop the world long enough to mark the roots and stacks, then leave the marking
+   //  threads to trace the heap while the other threads keep running.
+   // The next Collect finishes the cycle.
+   void BeginConcurrentMark()
+   {
+      if (_hx_atomic_compare_exchange((volatile int *)&hx::gPauseForCollect, 0, 0xffffffff) != 0)
+      {
+         hx::PauseForCollect();
+         return;
+      }
+
+      LocalAllocator *this_local = (LocalAllocator *)(hx::ImmixAllocator *)hx::tlsStackContext;
+
+      gThreadStateChangeLock->Lock();
+
+      for(int i=0;i<mLocalAllocs.size();i++)
+         if (mLocalAllocs[i]!=this_local)
+            WaitForSafe(mLocalAllocs[i]);
+
+      sgIsCollecting = true;
+
+      StopThreadJobs(true);
+
+      // Another thread may have started the cycle while we were waiting
+      if (!mConcurrentCycle)
+      {
+         #ifdef SHOW_MEM_EVENTS
+         GCLOG("=== Begin concurrent mark ===\n");
+         #endif
+
+         // Lazy reclaiming uses the row marks, which are about to be cleared
+         for(int i=0;i<mAllBlocks.size();i++)
+            if (!mAllBlocks[i]->mReclaimed)
+               mAllBlocks[i]->reclaim<false>(0);
+
+         MarkAll(false,true);
+
+         for(int i=0;i<mLocalAllocs.size();i++)
+         {
+            hx::StackContext *ctx = (hx::StackContext *)mLocalAllocs[i];
+            if (!ctx->mOldReferrers)
+               ctx->mOldReferrers = hx::sGlobalChunks.alloc();
+         }
+
+         mConcurrentCycle = true;
+         hx::gConcurrentMarking = 1;
+
+         StartThreadJobs(tpjMark, MAX_GC_THREADS, false);
+      }
+
+      sgIsCollecting = false;
+
+      hx::gPauseForCollect = 0x00000000;
+      for(int i=0;i<mLocalAllocs.size();i++)
+      {
+         #ifdef HXCPP_SCRIPTABLE
+         ((hx::StackContext *)mLocalAllocs[i])->byteMarkId = hx::JitByteMarkId();
+         #endif
+         if (mLocalAllocs[i]!=this_local)
+            ReleaseFromSafe(mLocalAllocs[i]);
+      }
+
+      gThreadStateChangeLock->Unlock();
+   }
+
+   // Called for each new block - start marking when enough of the budget has been used, and
+   //  finish the cycle once the marking threads have run out of work.
+   void CheckConcurrentMark(hx::ImmixAllocator *inAlloc)
+   {
+      if (!sgInternalEnable)
+         return;
+
+      if (!mConcurrentCycle)
+      {
+         if (_hx_atomic_add(&mConcurrentBlocksTaken,1)+1 == mConcurrentMarkTrigger)
+            BeginConcurrentMarkFromThisThread();
+      }
+      else if (!sRunningThreads)
+      {
+         inAlloc->SetupStackAndCollect(false,false);
+      }
+   }
+   #endif
+
+   #ifdef HX_GC_NURSERY_BUDGET
+   void CheckNurseryBudget(hx::ImmixAllocator *inAlloc)
+   {
+      if (!sgInternalEnable || !mNurseryTrigger)
+         return;
+
+      // Only the thread that uses up the budget collects - others will be paused by it
+      if (_hx_atomic_add(&mNurseryBlocksTaken,1)+1 == mNurseryTrigger)
+         inAlloc->SetupStackAndCollect(false,false);
+   }
+   #endif
+
+
+   
    #ifdef HX_GC_VERIFY_ALLOC_START
    void verifyAllocStart()
    {
@@ -4833,6 +5151,11 @@ public:
       #endif
 
       STAMP(t0)
+      bool logEvent = hx::gGcEventsEnabled;
+      EVENT_STAMP(e0)
+      size_t memBefore = logEvent ? MemCurrent() : 0;
+      mFinalizeTime = 0;
+      mBlocksMoved = 0;
 
       // We are the collector - all must wait for us
       LocalAllocator *this_local = 0;
@@ -4848,8 +5171,14 @@ public:
       #endif
 
       sgIsCollecting = true;
+      // Blocks may be released below
+      mCollectedBlocks.setSize(0);
 
       StopThreadJobs(true);
+      #ifdef HX_GC_CONCURRENT_MARK
+      // Mutators are stopped, so the final mark can proceed without the barriers
+      hx::gConcurrentMarking = 0;
+      #endif
       #ifdef HXCPP_DEBUG
       sgAllocsSinceLastSpam = 0;
       #endif
@@ -4915,8 +5244,12 @@ public:
       #endif
 
       STAMP(t1)
+      EVENT_STAMP(e1)
 
       MarkAll(generational);
+      #ifdef HX_GC_CONCURRENT_MARK
+      mConcurrentCycle = false;
+      #endif
 
       #ifdef HX_GC_VERIFY_GENERATIONAL
       {
@@ -4934,6 +5267,7 @@ public:
       #endif
 
       STAMP(t2)
+      EVENT_STAMP(e2)
 
 
       // Sweep blocks
@@ -5102,6 +5436,7 @@ public:
 
 
       STAMP(t4)
+      EVENT_STAMP(e3)
 
       bool defragged = false;
 
@@ -5211,6 +5546,7 @@ public:
 
 
       STAMP(t5)
+      EVENT_STAMP(e4)
 
       size_t mem = mRowsInUse<<IMMIX_LINE_BITS;
       size_t baseMem = full ? bytesInUse : mem;
@@ -5253,6 +5589,10 @@ public:
          mGenerationalRetainEstimate += (0.2-mGenerationalRetainEstimate)*0.25;
       }
 
+      #ifdef HXCPP_GC_CONCURRENT
+      // The write barriers only track objects for the concurrent marker
+      sGcMode = gcmFull;
+      #else
       double filled_ratio = (double)mRowsInUse/(double)(mAllBlocksCount*IMMIX_USEFUL_LINES);
       double after_gen = filled_ratio + (1.0-filled_ratio)*mGenerationalRetainEstimate;
 
@@ -5271,11 +5611,16 @@ public:
       GCLOG("filled=%.2f%% + estimate = %.2f%% = %.2f%% -> %s\n",
             filled_ratio*100, mGenerationalRetainEstimate*100, after_gen*100, sGcMode==gcmFull?"Full":"Generational");
       #endif
+      #endif
 
       #endif
 
       createFreeList();
 
+      mCollectedBlocks.setSize(mAllBlocks.size());
+      if (mAllBlocks.size())
+         memcpy(&mCollectedBlocks[0], &mAllBlocks[0], mAllBlocks.size()*sizeof(BlockDataInfo *));
+
       // This saves some running/stall time, but increases the total CPU usage
       // Delaying it until just before the block is used to improve the cache locality
       backgroundProcessFreeList(true);
@@ -5283,6 +5628,27 @@ public:
       mAllBlocksCount   = mAllBlocks.size();
       mCurrentRowsInUse = mRowsInUse;
 
+      #ifdef HX_GC_CONCURRENT_MARK
+      {
+         // Blocks that can be handed out before a collect is forced
+         size_t working = GetWorkingMemory();
+         size_t budget = mFreeBlocks.size();
+         if (sWorkingMemorySize>working)
+            budget += (sWorkingMemorySize-working)>>IMMIX_BLOCK_BITS;
+         mConcurrentMarkTrigger = std::max( (int)(budget*hx::sgConcurrentMarkStartPercentage/100), 1);
+         mConcurrentBlocksTaken = 0;
+      }
+      #endif
+
+      #ifdef HX_GC_NURSERY_BUDGET
+      // Old objects have their marks now, so the next collect can be a minor one
+      mNurseryBlocksTaken = 0;
+      if (sGcMode==gcmGenerational && hx::sgNurserySize>0)
+         mNurseryTrigger = std::max( (int)(hx::sgNurserySize>>IMMIX_BLOCK_BITS), 1);
+      else
+         mNurseryTrigger = 0;
+      #endif
+
       #ifdef SHOW_MEM_EVENTS
       GCLOG("Collect Done\n");
       #endif
@@ -5343,6 +5709,24 @@ public:
       __hxt_gc_end();
       #endif
 
+      // Record while still the collector, so no other collect can write the log
+      if (logEvent)
+      {
+         hx::GcEvent event;
+         event.start = e0;
+         event.end = __hxcpp_time_stamp();
+         event.mark = (e2-e1) - mFinalizeTime;
+         event.finalize = mFinalizeTime;
+         event.reclaim = e3-e2;
+         event.move = e4-e3;
+         size_t memAfter = MemUsage();
+         event.bytesFreed = memBefore>memAfter ? (double)(memBefore-memAfter) : 0.0;
+         event.blocksMoved = mBlocksMoved;
+         event.threads = mLocalAllocs.size();
+         event.major = !generational;
+         hx::GcAddEvent(event);
+      }
+
       sgIsCollecting = false;
 
 
@@ -5351,7 +5735,7 @@ public:
          for(int i=0;i<mLocalAllocs.size();i++)
          {
             #ifdef HXCPP_SCRIPTABLE
-            ((hx::StackContext *)mLocalAllocs[i])->byteMarkId = hx::gByteMarkID;
+            ((hx::StackContext *)mLocalAllocs[i])->byteMarkId = hx::JitByteMarkId();
             #endif
             if (mLocalAllocs[i]!=this_local)
                ReleaseFromSafe(mLocalAllocs[i]);
@@ -5361,7 +5745,7 @@ public:
             gThreadStateChangeLock->Unlock();
       #else
         #ifdef HXCPP_SCRIPTABLE
-        hx::gMainThreadContext->byteMarkId = hx::gByteMarkID;
+        hx::gMainThreadContext->byteMarkId = hx::JitByteMarkId();
         #endif
       #endif
 
@@ -5461,6 +5845,12 @@ public:
 
       StartThreadJobs(tpjAsyncZero, mZeroList.size(),true);
       #else
+      // With many cores, there are usually several threads allocating and one zeroing
+      //  thread can not keep up.  Let the allocating thread zero the block just before it
+      //  uses it instead - the memory is then also first touched by the core that uses it.
+      if (inJit && (hx::sgGcLazyZero>0 || (hx::sgGcLazyZero<0 && GetGcThreadCount()>=8)))
+         return;
+
       if ( MAX_GC_THREADS>1 && mFreeBlocks.size()>4)
       {
          mZeroList.setSize(mFreeBlocks.size());
@@ -5524,6 +5914,45 @@ public:
       return false;
    }
 
+   // Does inPtr start a non-const allocation of at least inMinSize bytes, in a block that
+   //  existed at the last collection?  Newer blocks are not searched.  With the nursery,
+   //  objects allocated since then have no start flag, so only survivors are found.
+   bool IsAllocStart(const void *inPtr, int inMinSize)
+   {
+      BlockData *block = (BlockData *)( ((size_t)inPtr) & IMMIX_BLOCK_BASE_MASK);
+      int min = 0;
+      int max = mCollectedBlocks.size();
+      while(min<max)
+      {
+         int mid = (min+max)>>1;
+         if (mCollectedBlocks[mid]->mPtr<block)
+            min = mid+1;
+         else
+            max = mid;
+      }
+      if (min==mCollectedBlocks.size() || mCollectedBlocks[min]->mPtr!=block)
+         return false;
+      BlockDataInfo *info = mCollectedBlocks[min];
+
+      int offset = (int)(((size_t)inPtr) & IMMIX_BLOCK_OFFSET_MASK) - (int)sizeof(int);
+      int r = offset >> IMMIX_LINE_BITS;
+      if (offset<0 || r < IMMIX_HEADER_LINES || r >= IMMIX_LINES)
+         return false;
+      if ( !(info->allocStart[r] & hx::gImmixStartFlag[offset &127]) )
+         return false;
+
+      unsigned int header = ((unsigned int *)inPtr)[-1];
+      if (header & (HX_GC_CONST_ALLOC_BIT | IMMIX_ALLOC_IS_CONTAINER))
+         return false;
+      #ifdef HXCPP_GC_NURSERY
+      // A nursery header has no mark id, and keeps its size elsewhere
+      if (!(header & 0xff000000))
+         return false;
+      #endif
+      int size = (header & IMMIX_ALLOC_SIZE_MASK) >> IMMIX_ALLOC_SIZE_SHIFT;
+      return size>=inMinSize;
+   }
+
    MemType GetMemType(void *inPtr)
    {
       BlockData *block = (BlockData *)( ((size_t)inPtr) & IMMIX_BLOCK_BASE_MASK);
@@ -5563,6 +5992,17 @@ public:
    size_t mTotalAfterLastCollect;
    size_t mAllBlocksCount;
    double mGenerationalRetainEstimate;
+   double mFinalizeTime;
+   int    mBlocksMoved;
+   #ifdef HX_GC_CONCURRENT_MARK
+   bool   mConcurrentCycle;
+   int    mConcurrentMarkTrigger;
+   volatile int mConcurrentBlocksTaken;
+   #endif
+   #ifdef HX_GC_NURSERY_BUDGET
+   int    mNurseryTrigger;
+   volatile int mNurseryBlocksTaken;
+   #endif
 
    hx::MarkContext mMarker;
 
@@ -5573,6 +6013,9 @@ public:
    BlockList mFreeBlocks;
    BlockList mZeroList;
    volatile int mZeroListQueue;
+   // Copy of mAllBlocks made at the end of the last collection.  It only changes while
+   //  the other threads are stopped, so they can search it without a lock.
+   BlockList mCollectedBlocks;
 
    LargeList mLargeList;
    HxMutex    mLargeListLock;
@@ -5588,7 +6031,11 @@ namespace hx
 
 MarkChunk *MarkChunk::swapForNew()
 {
+   #ifdef HX_GC_CONCURRENT_MARK
+   return sGlobalChunks.pushRemembered(this,true);
+   #else
    return sGlobalChunks.pushJobNoWake(this);
+   #endif
 }
 
 
@@ -5816,11 +6263,15 @@ public:
          GCLOG("Uncleaned referrers\n");
       }
 
+      #ifdef HX_GC_CONCURRENT_MARK
+      mOldReferrers = hx::sGlobalChunks.alloc();
+      #else
       if (sGcMode==gcmGenerational)
          mOldReferrers = hx::sGlobalChunks.alloc();
       else
          mOldReferrers = 0;
       #endif
+      #endif
 
 
       // It is in the free zone - wait for 'SetTopOfStack' to activate
@@ -5851,8 +6302,13 @@ public:
       #ifdef HXCPP_GC_GENERATIONAL
       if (mOldReferrers)
       {
+         #ifdef HX_GC_CONCURRENT_MARK
+         if ( mOldReferrers->count )
+            hx::sGlobalChunks.pushRemembered( mOldReferrers, false );
+         #else
          if ( mOldReferrers->count )
             hx::sGlobalChunks.pushJob( mOldReferrers, false );
+         #endif
          else
             hx::sGlobalChunks.free( mOldReferrers );
          mOldReferrers = 0;
@@ -6020,6 +6476,28 @@ public:
       sGlobalAlloc->Collect(inMajor, inForceCompact, inLocked, inFreeIsFragged);
    }
 
+   #ifdef HX_GC_CONCURRENT_MARK
+   void SetupStackAndBeginMark()
+   {
+      volatile int dummy = 1;
+      mBottomOfStack = (int *)&dummy;
+
+      CAPTURE_REGS;
+
+      if (!mTopOfStack)
+         mTopOfStack = mBottomOfStack;
+      #ifdef HXCPP_STACK_UP
+      if (mBottomOfStack < mTopOfStack)
+         mTopOfStack = mBottomOfStack;
+      #else
+      if (mBottomOfStack > mTopOfStack)
+         mTopOfStack = mBottomOfStack;
+      #endif
+
+      sGlobalAlloc->BeginConcurrentMark();
+   }
+   #endif
+
 
    void PauseForCollect()
    {
@@ -6425,6 +6903,14 @@ void CollectFromThisThread(bool inMajor,bool inForceCompact)
    la->SetupStackAndCollect(inMajor,inForceCompact);
 }
 
+#ifdef HX_GC_CONCURRENT_MARK
+void BeginConcurrentMarkFromThisThread()
+{
+   LocalAllocator *la = GetLocalAlloc();
+   la->SetupStackAndBeginMark();
+}
+#endif
+
 namespace hx
 {
 
@@ -6621,6 +7107,11 @@ inline unsigned int ObjectSize(void *inData)
 }
 
 
+bool IsAllocStart(const void *inData, int inMinSize)
+{
+   return sGlobalAlloc && sGlobalAlloc->IsAllocStart(inData, inMinSize);
+}
+
 unsigned int ObjectSizeSafe(void *inData)
 {
    unsigned int header = ((unsigned int *)(inData))[-1];
@@ -6750,7 +7241,7 @@ void RegisterCurrentThread(void *inTopOfStack)
 
    tlsStackContext = local;
    #ifdef HXCPP_SCRIPTABLE
-   local->byteMarkId = hx::gByteMarkID;
+   local->byteMarkId = hx::JitByteMarkId();
    #endif
 }
 
@@ -28,6 +28,7 @@
 #include <time.h>
 #include "mysql.h"
 #include <string.h>
+#include <vector>
 
 #ifdef HX_ANDROID
 #define atof(x) strtod((x),0)
@@ -121,10 +122,15 @@ struct Result : public hx::Object
    CONV *fields_convs;
    String *field_names;
    MYSQL_ROW current;
+   // Set for streamed results, which read from the connection as rows are fetched
+   hx::ObjectPtr<Connection> stream;
+   // Prepared statement results, with values in the binary protocol
+   bool binary;
 
    void create(MYSQL_RES *inR)
    {
       r = inR;
+      binary = false;
       fields_convs = 0;
       field_names = 0;
       nfields = 0;
@@ -148,6 +154,25 @@ struct Result : public hx::Object
 
    int numRows() { return mysql_num_rows(r); }
 
+   MYSQL_ROW fetchRow()
+   {
+      MYSQL_ROW row = mysql_fetch_row(r);
+      if (!row && stream.mPtr && mysql_result_failed(r))
+      {
+         Connection *connection = stream.mPtr;
+         stream = null();
+         if (connection->m)
+            error(connection->m,"Failed to read streamed row :");
+         HXTHROW("Failed to read streamed row");
+      }
+      return row;
+   }
+
+   void __Mark(hx::MarkContext *__inCtx) { HX_MARK_MEMBER(stream); }
+   #ifdef HXCPP_VISIT_ALLOCS
+   void __Visit(hx::VisitContext *__inCtx) { HX_VISIT_MEMBER(stream); }
+   #endif
+
    static void finalize(Dynamic obj)
    {
       ((Result *)(obj.mPtr))->destroy();
@@ -220,6 +245,198 @@ Array<String> _hx_mysql_result_get_fields_names(Dynamic handle)
    return output;
 }
 
+template<typename T>
+static inline T readValue(const char *inData)
+{
+   T value;
+   memcpy(&value,inData,sizeof(T));
+   return value;
+}
+
+static Dynamic dataToBytes(const char *inData, int inLength)
+{
+   Array<unsigned char> buf = Array_obj<unsigned char>::__new(inLength,inLength);
+   if (inLength)
+      memcpy(&buf[0],inData,inLength);
+   return gDataToBytes.call(buf);
+}
+
+// Prepared statement values : numbers come as they are, strings and decimals
+//  with a length, and dates as their fields
+static Dynamic convertBinaryCell(Result *r, MYSQL_ROW row, int i, unsigned long *&lengths)
+{
+   const char *data = row[i];
+   if( !data )
+      return null();
+   if( lengths == NULL )
+   {
+      lengths = mysql_fetch_lengths(r->r);
+      if( lengths == NULL )
+         HXTHROW("mysql_fetch_lengths");
+   }
+   int length = lengths[i];
+   MYSQL_FIELD *field = mysql_fetch_fields(r->r) + i;
+   bool isUnsigned = (field->flags & UNSIGNED_FLAG) != 0;
+
+   switch(field->type)
+   {
+      case FIELD_TYPE_TINY:
+         if( r->fields_convs[i] == CONV_BOOL )
+            return data[0] != 0;
+         return isUnsigned ? (int)(unsigned char)data[0] : (int)(signed char)data[0];
+      case FIELD_TYPE_SHORT:
+      case FIELD_TYPE_YEAR:
+         return isUnsigned ? (int)readValue<unsigned short>(data) : (int)readValue<short>(data);
+      case FIELD_TYPE_LONG:
+      case FIELD_TYPE_INT24:
+         if( isUnsigned )
+         {
+            unsigned int v = readValue<unsigned int>(data);
+            if( v > 0x7fffffff )
+               return (Float)v;
+            return (int)v;
+         }
+         return readValue<int>(data);
+      // As a float, the same as the text protocol
+      case FIELD_TYPE_LONGLONG:
+         return isUnsigned ? (Float)readValue<unsigned long long>(data) : (Float)readValue<long long>(data);
+      case FIELD_TYPE_FLOAT:
+         return (Float)readValue<float>(data);
+      case FIELD_TYPE_DOUBLE:
+         return readValue<double>(data);
+      case FIELD_TYPE_NULL:
+         return null();
+
+      case FIELD_TYPE_DATE:
+      case FIELD_TYPE_DATETIME:
+      case FIELD_TYPE_TIMESTAMP:
+         {
+            struct tm t;
+            memset(&t,0,sizeof(t));
+            if( length >= 4 )
+            {
+               t.tm_year = readValue<unsigned short>(data);
+               t.tm_mon = (unsigned char)data[2];
+               t.tm_mday = (unsigned char)data[3];
+            }
+            if( length >= 7 && field->type != FIELD_TYPE_DATE )
+            {
+               t.tm_hour = (unsigned char)data[4];
+               t.tm_min = (unsigned char)data[5];
+               t.tm_sec = (unsigned char)data[6];
+            }
+            t.tm_isdst = -1;
+            t.tm_year -= 1900;
+            t.tm_mon--;
+            if( field->type == FIELD_TYPE_DATE )
+               return gDateFromSeconds.call((int)mktime(&t));
+            return gDateFromSeconds.call(mktime(&t));
+         }
+
+      case FIELD_TYPE_TIME:
+         {
+            // The text protocol gives [-]hh:mm:ss
+            int hours = 0, minutes = 0, seconds = 0;
+            bool negative = false;
+            if( length >= 8 )
+            {
+               negative = data[0] != 0;
+               hours = readValue<int>(data+1)*24 + (unsigned char)data[5];
+               minutes = (unsigned char)data[6];
+               seconds = (unsigned char)data[7];
+            }
+            char buf[32];
+            sprintf(buf,"%s%02d:%02d:%02d",negative ? "-" : "",hours,minutes,seconds);
+            return String(buf);
+         }
+
+      default:
+         switch( r->fields_convs[i] )
+         {
+            case CONV_BINARY:
+               return dataToBytes(data,length);
+            case CONV_INT:
+            case CONV_FLOAT:
+               {
+                  // decimals, which are not 0-terminated here
+                  char buf[80];
+                  int len = length < 79 ? length : 79;
+                  memcpy(buf,data,len);
+                  buf[len] = 0;
+                  if( r->fields_convs[i] == CONV_INT )
+                     return atoi(buf);
+                  return atof(buf);
+               }
+            default:
+               return String::create(data,length);
+         }
+   }
+}
+
+static Dynamic convertCell(Result *r, MYSQL_ROW row, int i, unsigned long *&lengths)
+{
+   if( r->binary )
+      return convertBinaryCell(r,row,i,lengths);
+
+   if( !row[i] )
+      return null();
+
+   Dynamic v;
+   switch( r->fields_convs[i] )
+   {
+      case CONV_INT:
+         v = atoi(row[i]);
+         break;
+      case CONV_STRING:
+         v = String(row[i]);
+         break;
+      case CONV_BOOL:
+         v = *row[i] != '0';
+         break;
+      case CONV_FLOAT:
+         v = atof(row[i]);
+         break;
+      case CONV_BINARY:
+         {
+         if( lengths == NULL )
+         {
+            lengths = mysql_fetch_lengths(r->r);
+            if( lengths == NULL )
+               HXTHROW("mysql_fetch_lengths");
+         }
+         v = dataToBytes(row[i],lengths[i]);
+         }
+         break;
+
+      case CONV_DATE:
+         {
+            struct tm t;
+            sscanf(row[i],"%4d-%2d-%2d",&t.tm_year,&t.tm_mon,&t.tm_mday);
+            t.tm_hour = 0;
+            t.tm_min = 0;
+            t.tm_sec = 0;
+            t.tm_isdst = -1;
+            t.tm_year -= 1900;
+            t.tm_mon--;
+            v = gDateFromSeconds.call((int)mktime(&t));
+         }
+         break;
+      case CONV_DATETIME:
+         {
+            struct tm t;
+            sscanf(row[i],"%4d-%2d-%2d %2d:%2d:%2d",&t.tm_year,&t.tm_mon,&t.tm_mday,&t.tm_hour,&t.tm_min,&t.tm_sec);
+            t.tm_isdst = -1;
+            t.tm_year -= 1900;
+            t.tm_mon--;
+            v = gDateFromSeconds.call(mktime(&t));
+         }
+         break;
+      default:
+         break;
+   }
+   return v;
+}
+
 /**
    result_next : 'result -> object?
    <doc>
@@ -235,11 +452,10 @@ Array<String> _hx_mysql_result_get_fields_names(Dynamic handle)
 Dynamic _hx_mysql_result_next(Dynamic handle)
 {
    Result *r = getResult(handle);
-   MYSQL_ROW row = mysql_fetch_row(r->r);
+   MYSQL_ROW row = r->fetchRow();
    if( !row )
       return null();
 
-   int count = r->nfields;
    hx::Anon cur = hx::Anon_obj::Create(0);
 
    r->current = row;
@@ -247,66 +463,124 @@ Dynamic _hx_mysql_result_next(Dynamic handle)
    for(int i=0;i<r->nfields;i++)
    {
       if( row[i] )
+         cur->__SetField(r->field_names[i],convertCell(r,row,i,lengths), hx::paccDynamic );
+   }
+   return cur;
+}
+
+/**
+   result_fetch_row : 'result -> row:array -> bool
+   <doc>Reads the next row into [row], by field position, reusing the array.
+   Values are converted as for [result_next].  Returns false when there are no more rows.</doc>
+**/
+bool _hx_mysql_result_fetch_row(Dynamic handle,Array<Dynamic> row)
+{
+   Result *r = getResult(handle);
+   MYSQL_ROW data = r->fetchRow();
+   if( !data )
+      return false;
+
+   r->current = data;
+   unsigned long *lengths = 0;
+   row->resize(r->nfields);
+   for(int i=0;i<r->nfields;i++)
+      row->__unsafe_set(i, convertCell(r,data,i,lengths));
+   return true;
+}
+
+namespace { enum ColumnKind { colInt, colFloat, colBool, colString, colDynamic }; }
+
+/**
+   result_fetch_columns : 'result -> columns:array -> max:int -> int
+   <doc>Reads up to [max] rows into one array per field, resizing each to the row count.
+   The arrays set the conversion: Array<Int>, Array<Float> and Array<Bool> read NULL as 0,
+   Array<String> takes the text, and Array<Dynamic> converts as for [result_next].
+   Returns the number of rows read.</doc>
+**/
+int _hx_mysql_result_fetch_columns(Dynamic handle,Array<Dynamic> columns,int maxRows)
+{
+   Result *r = getResult(handle);
+   int nfields = r->nfields;
+   if (columns->length<nfields)
+      hx::Throw( HX_CSTRING("Mysql: need an array for each of the ") + String(nfields) + HX_CSTRING(" fields") );
+
+   std::vector<ColumnKind> kinds(nfields);
+   std::vector<hx::ArrayBase *> arrays(nfields);
+   for(int c=0;c<nfields;c++)
+   {
+      hx::Object *a = columns[c].mPtr;
+      arrays[c] = dynamic_cast<hx::ArrayBase *>(a);
+      if (dynamic_cast< Array_obj<int> * >(a))
+         kinds[c] = colInt;
+      else if (dynamic_cast< Array_obj<Float> * >(a))
+         kinds[c] = colFloat;
+      else if (dynamic_cast< Array_obj<bool> * >(a))
+         kinds[c] = colBool;
+      else if (dynamic_cast< Array_obj<String> * >(a))
+         kinds[c] = colString;
+      else if (dynamic_cast< Array_obj<Dynamic> * >(a))
+         kinds[c] = colDynamic;
+      else
+         hx::Throw( HX_CSTRING("Mysql: unsupported column array ") + String(c) );
+      // Keep the storage from the last call
+      arrays[c]->resize(0);
+   }
+
+   int rows = 0;
+   while(rows<maxRows)
+   {
+      MYSQL_ROW data = r->fetchRow();
+      if( !data )
+         break;
+      r->current = data;
+
+      unsigned long *lengths = 0;
+      for(int c=0;c<nfields;c++)
       {
-         Dynamic v;
-         switch( r->fields_convs[i] )
+         const char *s = data[c];
+         hx::ArrayBase *a = arrays[c];
+         a->resize(rows+1);
+         if (r->binary && kinds[c]!=colDynamic)
          {
-            case CONV_INT:
-               v = atoi(row[i]);
-               break;
-            case CONV_STRING:
-               v = String(row[i]);
-               break;
-            case CONV_BOOL:
-               v = *row[i] != '0';
-               break;
-            case CONV_FLOAT:
-               v = atof(row[i]);
+            Dynamic v = convertCell(r,data,c,lengths);
+            hx::Object *o = v.mPtr;
+            switch(kinds[c])
+            {
+               case colInt:
+                  ((Array_obj<int> *)a)->__unsafe_set(rows, o ? o->__ToInt() : 0);
+                  break;
+               case colFloat:
+                  ((Array_obj<Float> *)a)->__unsafe_set(rows, o ? o->__ToDouble() : 0.0);
+                  break;
+               case colBool:
+                  ((Array_obj<bool> *)a)->__unsafe_set(rows, o && o->__ToInt()!=0);
+                  break;
+               default:
+                  ((Array_obj<String> *)a)->__unsafe_set(rows, o ? o->toString() : String());
+            }
+            continue;
+         }
+         switch(kinds[c])
+         {
+            case colInt:
+               ((Array_obj<int> *)a)->__unsafe_set(rows, s ? atoi(s) : 0);
                break;
-            case CONV_BINARY:
-               {
-               if( lengths == NULL )
-               {
-                  lengths = mysql_fetch_lengths(r->r);
-                  if( lengths == NULL )
-                     HXTHROW("mysql_fetch_lengths");
-               }
-               Array<unsigned char> buf = Array_obj<unsigned char>::__new(lengths[i],lengths[i]);
-               memcpy(&buf[0],row[i],lengths[i]);
-               v = gDataToBytes.call(buf);
-               }
+            case colFloat:
+               ((Array_obj<Float> *)a)->__unsafe_set(rows, s ? atof(s) : 0.0);
                break;
-
-            case CONV_DATE:
-               {
-                  struct tm t;
-                  sscanf(row[i],"%4d-%2d-%2d",&t.tm_year,&t.tm_mon,&t.tm_mday);
-                  t.tm_hour = 0;
-                  t.tm_min = 0;
-                  t.tm_sec = 0;
-                  t.tm_isdst = -1;
-                  t.tm_year -= 1900;
-                  t.tm_mon--;
-                  v = gDateFromSeconds.call((int)mktime(&t));
-               }
+            case colBool:
+               ((Array_obj<bool> *)a)->__unsafe_set(rows, s && *s!='0');
                break;
-            case CONV_DATETIME:
-               {
-                  struct tm t;
-                  sscanf(row[i],"%4d-%2d-%2d %2d:%2d:%2d",&t.tm_year,&t.tm_mon,&t.tm_mday,&t.tm_hour,&t.tm_min,&t.tm_sec);
-                  t.tm_isdst = -1;
-                  t.tm_year -= 1900;
-                  t.tm_mon--;
-                  v = gDateFromSeconds.call(mktime(&t));
-               }
+            case colString:
+               ((Array_obj<String> *)a)->__unsafe_set(rows, s ? String(s) : String());
                break;
             default:
-               break;
+               ((Array_obj<Dynamic> *)a)->__unsafe_set(rows, convertCell(r,data,c,lengths));
          }
-         cur->__SetField(r->field_names[i],v, hx::paccDynamic );
       }
+      rows++;
    }
-   return cur;
+   return rows;
 }
 
 
@@ -327,6 +601,12 @@ String  _hx_mysql_result_get(Dynamic handle,int n)
          HXTHROW("No more results");
    }
 
+   if( r->binary )
+   {
+      unsigned long *lengths = 0;
+      Dynamic v = convertCell(r,r->current,n,lengths);
+      return v.mPtr ? v->toString() : String();
+   }
    return String(r->current[n]);
 }
 
@@ -347,6 +627,12 @@ int _hx_mysql_result_get_int(Dynamic handle,int n)
          HXTHROW("No more results");
    }
 
+   if( r->binary )
+   {
+      unsigned long *lengths = 0;
+      Dynamic v = convertCell(r,r->current,n,lengths);
+      return v.mPtr ? v->__ToInt() : 0;
+   }
    const char *s = r->current[n];
    return  s?atoi(s):0;
 }
@@ -368,6 +654,12 @@ Float   _hx_mysql_result_get_float(Dynamic handle,int n)
          HXTHROW("No more results");
    }
 
+   if( r->binary )
+   {
+      unsigned long *lengths = 0;
+      Dynamic v = convertCell(r,r->current,n,lengths);
+      return v.mPtr ? v->__ToDouble() : 0;
+   }
    const char *s = r->current[n];
    return s?atof(s):0;
 }
@@ -497,6 +789,276 @@ Dynamic _hx_mysql_request(Dynamic handle,String req)
    return alloc_result(connection,res);
 }
 
+/**
+   request_stream : 'connection -> string -> 'result
+   <doc>Execute an SQL request, reading the rows from the server as they are fetched
+   rather than all at once.  The connection can not be used for anything else until the
+   last row has been read - a new request skips any rows left over.  The result length is
+   the number of rows fetched so far.</doc>
+**/
+Dynamic _hx_mysql_request_stream(Dynamic handle,String req)
+{
+   Connection *connection = getConnection(handle);
+
+   if( mysql_real_query(connection->m,req.utf8_str(),req.length) != 0 )
+      error(connection->m,req);
+
+   MYSQL_RES *res = mysql_use_result(connection->m);
+   if( !res )
+   {
+      if( mysql_field_count(connection->m) == 0 )
+         return mysql_affected_rows(connection->m);
+      else
+         error(connection->m,req);
+   }
+
+   Result *result = alloc_result(connection,res);
+   result->stream = connection;
+   return result;
+}
+
+// ---------------------------------------------------------------
+// Statement
+
+/** <doc><h2>Statement</h2></doc> **/
+
+namespace
+{
+
+union ParamValue
+{
+   signed char b;
+   int i;
+   cpp::Int64 l;
+   double f;
+};
+
+// utf8 copies of the wide string parameters, kept until the packet is written
+struct ParamAlloc : public hx::IStringAlloc
+{
+   std::vector<void *> blocks;
+
+   ~ParamAlloc()
+   {
+      for(size_t i=0;i<blocks.size();i++)
+         free(blocks[i]);
+   }
+   void *allocBytes(size_t inBytes)
+   {
+      void *result = malloc(inBytes);
+      blocks.push_back(result);
+      return result;
+   }
+};
+
+// A server-side prepared statement : parameters are sent and rows come back in
+//  the binary protocol, so nothing needs escaping or parsing as text
+struct Statement : public hx::Object
+{
+   HX_IS_INSTANCE_OF enum { _hx_ClassId = hx::clsIdMysqlStatement };
+
+   hx::ObjectPtr<Connection> owner;
+   MYSQL_STMT *s;
+   String sql;
+   int nparams;
+
+   void create(Connection *inOwner, MYSQL_STMT *inS, String inSql)
+   {
+      _hx_set_finalizer(this, finalize);
+
+      owner = inOwner;
+      HX_OBJ_WB_GET(this, owner.mPtr);
+      s = inS;
+      sql = inSql;
+      HX_OBJ_WB_GET(this, sql.raw_ref());
+      nparams = mysql_stmt_param_count(s);
+   }
+
+   static void finalize(Dynamic obj) { ((Statement *)(obj.mPtr))->destroy(); }
+   void destroy()
+   {
+      if (s)
+      {
+         // Closing the connection drops its statements on the server too
+         if (owner->m)
+            mysql_stmt_close(s);
+         else
+            mysql_stmt_free(s);
+         s = 0;
+      }
+   }
+
+   void bind(MYSQL_BIND &outBind, ParamValue &outValue, Dynamic inValue, ParamAlloc &strings)
+   {
+      outBind.buffer = &outValue;
+      outBind.length = 0;
+      outBind.is_unsigned = 0;
+      hx::Object *obj = inValue.mPtr;
+      if (!obj)
+      {
+         outBind.buffer_type = FIELD_TYPE_NULL;
+         return;
+      }
+      switch(obj->__GetType())
+      {
+         case vtInt:
+            outBind.buffer_type = FIELD_TYPE_LONG;
+            outValue.i = obj->__ToInt();
+            break;
+         case vtBool:
+            outBind.buffer_type = FIELD_TYPE_TINY;
+            outValue.b = obj->__ToInt();
+            break;
+         case vtInt64:
+            outBind.buffer_type = FIELD_TYPE_LONGLONG;
+            outValue.l = obj->__ToInt64();
+            break;
+         case vtFloat:
+            outBind.buffer_type = FIELD_TYPE_DOUBLE;
+            outValue.f = obj->__ToDouble();
+            break;
+         case vtString:
+            {
+               int byteLength = 0;
+               outBind.buffer_type = FIELD_TYPE_VAR_STRING;
+               outBind.buffer = obj->toString().utf8_str(&strings, true, &byteLength);
+               outBind.length = byteLength;
+            }
+            break;
+         default:
+            {
+               Array_obj<unsigned char> *bytes = dynamic_cast< Array_obj<unsigned char> * >(obj);
+               if (!bytes)
+                  hx::Throw( HX_CSTRING("Mysql: Unsupported parameter type for ") + sql );
+               outBind.buffer_type = FIELD_TYPE_BLOB;
+               outBind.buffer = bytes->getBase();
+               outBind.length = bytes->length;
+            }
+      }
+   }
+
+   // Sends the parameters, leaving the answer to be read as for mysql_real_query
+   void execute(Dynamic inParams)
+   {
+      MYSQL *m = getConnection(owner)->m;
+      int n = inParams.mPtr ? inParams->__length() : 0;
+      if (n!=nparams)
+         hx::Throw( HX_CSTRING("Mysql: expected ") + String(nparams) + HX_CSTRING(" parameters for ") + sql );
+
+      // Binding does not allocate from the gc, so the buffers stay put until sent
+      std::vector<MYSQL_BIND> binds(nparams);
+      std::vector<ParamValue> values(nparams);
+      ParamAlloc strings;
+      for(int i=0;i<nparams;i++)
+         bind(binds[i], values[i], inParams->__GetItem(i), strings);
+
+      if( mysql_stmt_execute(s, nparams ? &binds[0] : 0) != 0 )
+         error(m,sql);
+   }
+
+   void __Mark(hx::MarkContext *__inCtx) { HX_MARK_MEMBER(owner); HX_MARK_MEMBER(sql); }
+   #ifdef HXCPP_VISIT_ALLOCS
+   void __Visit(hx::VisitContext *__inCtx) { HX_VISIT_MEMBER(owner); HX_VISIT_MEMBER(sql); }
+   #endif
+
+   String toString() { return HX_CSTRING("Mysql Statement"); }
+};
+
+Statement *getStatement(Dynamic handle)
+{
+   Statement *statement = dynamic_cast<Statement *>(handle.mPtr);
+   if (!statement || !statement->s || !statement->owner->m)
+      HXTHROW("Invalid mysql statement");
+   return statement;
+}
+
+}
+
+/**
+   prepare : 'connection -> sql:string -> 'stmt
+   <doc>Prepare the request on the server, with [?] for each parameter.
+   Close it with [stmt_close] when done.</doc>
+**/
+Dynamic _hx_mysql_prepare(Dynamic handle,String sql)
+{
+   Connection *connection = getConnection(handle);
+
+   int byteLength = 0;
+   const char *utf8 = sql.utf8_str(0, true, &byteLength);
+   MYSQL_STMT *s = mysql_stmt_prepare(connection->m,utf8,byteLength);
+   if( !s )
+      error(connection->m,sql);
+
+   Statement *statement = new Statement();
+   statement->create(connection,s,sql);
+   return statement;
+}
+
+/**
+   stmt_execute : 'stmt -> params:array -> 'result
+   <doc>Execute the statement with one value per parameter : null, Int, Float, Bool, String
+   or bytes data.  As with [request], returns a result or the number of affected rows.</doc>
+**/
+Dynamic _hx_mysql_stmt_execute(Dynamic handle,Array<Dynamic> params)
+{
+   Statement *statement = getStatement(handle);
+   MYSQL *m = statement->owner->m;
+   statement->execute(params);
+
+   MYSQL_RES *res = mysql_store_result(m);
+   if( !res )
+   {
+      if( mysql_field_count(m) == 0 )
+         return mysql_affected_rows(m);
+      else
+         error(m,statement->sql);
+   }
+
+   Result *result = alloc_result(statement->owner.mPtr,res);
+   result->binary = true;
+   return result;
+}
+
+/**
+   stmt_execute_batch : 'stmt -> rows:array -> int
+   <doc>Execute the statement once for each row, where each row is an array of parameter
+   values.  No transaction is opened for the batch.  Returns the total affected rows.</doc>
+**/
+int _hx_mysql_stmt_execute_batch(Dynamic handle,Array<Dynamic> rows)
+{
+   Statement *statement = getStatement(handle);
+   MYSQL *m = statement->owner->m;
+
+   int total = 0;
+   for(int row=0; row<rows->length; row++)
+   {
+      Dynamic values = rows[row];
+      if (!values.mPtr)
+         HXTHROW("Mysql: batch row is not an array");
+      statement->execute(values);
+
+      MYSQL_RES *res = mysql_store_result(m);
+      if( res )
+         mysql_free_result(res);
+      else if( mysql_field_count(m) == 0 )
+         total += mysql_affected_rows(m);
+      else
+         error(m,statement->sql);
+   }
+   return total;
+}
+
+/**
+   stmt_close : 'stmt -> void
+   <doc>Release the statement on the server.  It must not be used afterwards.</doc>
+**/
+void _hx_mysql_stmt_close(Dynamic handle)
+{
+   Statement *statement = dynamic_cast<Statement *>(handle.mPtr);
+   if (statement)
+      statement->destroy();
+}
+
 
 /**
    escape : 'connection -> string -> string
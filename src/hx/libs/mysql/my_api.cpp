@@ -77,6 +77,8 @@ static void myp_close( MYSQL *m ) {
 	m->s = INVALID_SOCKET;
 }
 
+static void begin_command( MYSQL *m );
+
 MYSQL *mysql_init( void *unused ) {
 	MYSQL *m = (MYSQL*)malloc(sizeof(struct _MYSQL));
 	psock_init();
@@ -242,6 +244,7 @@ send_cnx_packet:
 int mysql_select_db( MYSQL *m, const char *dbname ) {
 	MYSQL_PACKET *p = &m->packet;
 	int pcount = 0;
+	begin_command(m);
 	myp_begin_packet(p,0);
 	myp_write_byte(p,COM_INIT_DB);
 	// send dbname without trailing 0x00
@@ -256,6 +259,7 @@ int mysql_select_db( MYSQL *m, const char *dbname ) {
 int mysql_real_query( MYSQL *m, const char *query, int qlength ) {
 	MYSQL_PACKET *p = &m->packet;
 	int pcount = 0;
+	begin_command(m);
 	myp_begin_packet(p,0);
 	myp_write_byte(p,COM_QUERY);
 	myp_write(p,query,qlength);
@@ -272,7 +276,7 @@ int mysql_real_query( MYSQL *m, const char *query, int qlength ) {
 	return 0;
 }
 
-static int do_store( MYSQL *m, MYSQL_RES *r ) {
+static int read_fields( MYSQL *m, MYSQL_RES *r ) {
 	int i;
 	MYSQL_PACKET *p = &m->packet;
 	p->pos = 0;
@@ -308,6 +312,96 @@ static int do_store( MYSQL *m, MYSQL_RES *r ) {
 		return 0;
 	if( myp_read_byte(p) != 0xFE || p->size >= 9 )
 		return 0;
+	return 1;
+}
+
+// size of a binary protocol value, or -1 when it is length-prefixed
+static int binary_size( FIELD_TYPE t ) {
+	switch( t ) {
+	case FIELD_TYPE_TINY:
+		return 1;
+	case FIELD_TYPE_SHORT:
+	case FIELD_TYPE_YEAR:
+		return 2;
+	case FIELD_TYPE_LONG:
+	case FIELD_TYPE_INT24:
+	case FIELD_TYPE_FLOAT:
+		return 4;
+	case FIELD_TYPE_LONGLONG:
+	case FIELD_TYPE_DOUBLE:
+		return 8;
+	case FIELD_TYPE_NULL:
+		return 0;
+	default:
+		// strings, decimals and blobs, and dates/times which have a one byte length
+		return -1;
+	}
+}
+
+// decode the row packet in place : datas point into the packet buffer
+static void read_text_row( MYSQL_PACKET *p, MYSQL_RES *r, MYSQL_ROW_DATA *current ) {
+	int i;
+	int prev = 0;
+	for(i=0;i<r->nfields;i++) {
+		int l = myp_read_bin(p);
+		if( !p->error )
+			p->buf[prev] = 0;
+		if( l == -1 ) {
+			current->lengths[i] = 0;
+			current->datas[i] = NULL;
+		} else {
+			current->lengths[i] = l;
+			current->datas[i] = p->buf + p->pos;
+			p->pos += l;
+		}
+		prev = p->pos;
+	}
+	if( !p->error )
+		p->buf[prev] = 0;
+}
+
+// binary rows are a 0x00 header, a null bitmap with a 2 bits offset, then the non-null values
+static void read_binary_row( MYSQL_PACKET *p, MYSQL_RES *r, MYSQL_ROW_DATA *current ) {
+	int i;
+	int nbytes = (r->nfields + 9) >> 3;
+	const unsigned char *nulls = (unsigned char*)p->buf + 1;
+	p->pos = 1 + nbytes;
+	if( p->pos > p->size ) {
+		p->error = 1;
+		return;
+	}
+	for(i=0;i<r->nfields;i++) {
+		int bit = i + 2;
+		int l;
+		if( nulls[bit >> 3] & (1 << (bit & 7)) ) {
+			current->lengths[i] = 0;
+			current->datas[i] = NULL;
+			continue;
+		}
+		l = binary_size(r->fields[i].type);
+		if( l < 0 )
+			l = myp_read_bin(p);
+		if( p->error || l < 0 || p->pos + l > p->size ) {
+			p->error = 1;
+			return;
+		}
+		current->lengths[i] = l;
+		current->datas[i] = p->buf + p->pos;
+		p->pos += l;
+	}
+}
+
+static void read_row( MYSQL_PACKET *p, MYSQL_RES *r, MYSQL_ROW_DATA *current ) {
+	if( r->binary )
+		read_binary_row(p,r,current);
+	else
+		read_text_row(p,r,current);
+}
+
+static int do_store( MYSQL *m, MYSQL_RES *r ) {
+	MYSQL_PACKET *p = &m->packet;
+	if( !read_fields(m,r) )
+		return 0;
 	// reset packet buffer (to prevent to store large buffer in row data)
 	free(p->buf);
 	p->buf = NULL;
@@ -336,26 +430,10 @@ static int do_store( MYSQL *m, MYSQL_RES *r ) {
 		// read row fields
 		{
 			MYSQL_ROW_DATA *current = r->rows + r->row_count++;
-			int prev = 0;			
 			current->raw = p->buf;
 			current->lengths = (unsigned long*)malloc(sizeof(unsigned long) * r->nfields);
 			current->datas = (char**)malloc(sizeof(char*) * r->nfields);
-			for(i=0;i<r->nfields;i++) {
-				int l = myp_read_bin(p);
-				if( !p->error )
-					p->buf[prev] = 0;
-				if( l == -1 ) {
-					current->lengths[i] = 0;
-					current->datas[i] = NULL;
-				} else {
-					current->lengths[i] = l;
-					current->datas[i] = p->buf + p->pos;
-					p->pos += l;
-				}
-				prev = p->pos;
-			}
-			if( !p->error )
-				p->buf[prev] = 0;
+			read_row(p,r,current);
 		}
 		// the packet buffer as been stored, don't reuse it
 		p->buf = NULL;
@@ -369,7 +447,7 @@ static int do_store( MYSQL *m, MYSQL_RES *r ) {
 MYSQL_RES *mysql_store_result( MYSQL *m ) {
 	MYSQL_RES *r;
 	MYSQL_PACKET *p = &m->packet;
-	if( p->id != IS_QUERY )
+	if( p->id != IS_QUERY && p->id != IS_STMT )
 		return NULL;
 	// OK without result
 	if( p->buf[0] == 0 ) {
@@ -381,6 +459,7 @@ MYSQL_RES *mysql_store_result( MYSQL *m ) {
 	}
 	r = (MYSQL_RES*)malloc(sizeof(struct _MYSQL_RES));
 	memset(r,0,sizeof(struct _MYSQL_RES));
+	r->binary = p->id == IS_STMT;
 	m->errcode = 0;
 	if( !do_store(m,r) ) {
 		mysql_free_result(r);
@@ -392,6 +471,120 @@ MYSQL_RES *mysql_store_result( MYSQL *m ) {
 	return r;
 }
 
+// Unbuffered result : only the field definitions are read here, and each
+// mysql_fetch_row decodes the next row packet straight from the socket, reusing
+// the connection packet buffer.  The rows must be read (or the result freed)
+// before the connection is used again - a new query drains what is left.
+MYSQL_RES *mysql_use_result( MYSQL *m ) {
+	MYSQL_RES *r;
+	MYSQL_PACKET *p = &m->packet;
+	if( p->id != IS_QUERY && p->id != IS_STMT )
+		return NULL;
+	// OK without result
+	if( p->buf[0] == 0 ) {
+		p->pos = 0;
+		m->last_field_count = myp_read_byte(p); // 0
+		m->affected_rows = myp_read_bin(p);
+		m->last_insert_id = myp_read_bin(p);
+		return NULL;
+	}
+	r = (MYSQL_RES*)malloc(sizeof(struct _MYSQL_RES));
+	memset(r,0,sizeof(struct _MYSQL_RES));
+	r->binary = p->id == IS_STMT;
+	m->errcode = 0;
+	if( !read_fields(m,r) ) {
+		mysql_free_result(r);
+		if( !m->errcode )
+			error(m,"Failure while reading result fields",NULL);
+		return NULL;
+	}
+	p->id = 0;
+	r->stream = m;
+	r->stream_row.lengths = (unsigned long*)malloc(sizeof(unsigned long) * (r->nfields + 1));
+	r->stream_row.datas = (char**)malloc(sizeof(char*) * (r->nfields + 1));
+	m->streaming = r;
+	m->stream_pending = 1;
+	m->last_field_count = r->nfields;
+	return r;
+}
+
+static void stream_done( MYSQL_RES *r ) {
+	if( r->stream ) {
+		r->stream->streaming = NULL;
+		r->stream = NULL;
+	}
+	r->current = NULL;
+}
+
+static MYSQL_ROW stream_fetch_row( MYSQL_RES *r ) {
+	MYSQL *m = r->stream;
+	MYSQL_PACKET *p = &m->packet;
+	if( !myp_read_packet(m,p) ) {
+		error(m,"Failed to read packet",NULL);
+		m->stream_pending = 0;
+		r->stream_failed = 1;
+		stream_done(r);
+		return NULL;
+	}
+	// EOF : end of datas
+	if( (unsigned char)p->buf[0] == 0xFE && p->size < 9 ) {
+		m->stream_pending = 0;
+		stream_done(r);
+		return NULL;
+	}
+	if( (unsigned char)p->buf[0] == 0xFF ) {
+		save_error(m,p);
+		m->stream_pending = 0;
+		r->stream_failed = 1;
+		stream_done(r);
+		return NULL;
+	}
+	read_row(p,r,&r->stream_row);
+	if( p->error ) {
+		error(m,"Failed to decode row",NULL);
+		r->stream_failed = 1;
+		stream_done(r);
+		return NULL;
+	}
+	r->row_count++;
+	r->current = &r->stream_row;
+	return r->stream_row.datas;
+}
+
+// before the next command, skip the rows of an unbuffered result that were not read.
+// This is not done when the result is freed, since that may be from a finalizer
+static void stream_finish( MYSQL *m ) {
+	MYSQL_PACKET *p = &m->packet;
+	if( m->streaming )
+		stream_done(m->streaming);
+	while( m->stream_pending ) {
+		if( !myp_read_packet(m,p) )
+			break;
+		if( ((unsigned char)p->buf[0] == 0xFE && p->size < 9) || (unsigned char)p->buf[0] == 0xFF )
+			break;
+	}
+	m->stream_pending = 0;
+}
+
+// called before each command : finishes any unbuffered result, and sends the
+// statement closes queued since the last command
+static void begin_command( MYSQL *m ) {
+	MYSQL_PACKET *p = &m->packet;
+	stream_finish(m);
+	while( m->closed_count ) {
+		int pcount = 0;
+		myp_begin_packet(p,0);
+		myp_write_byte(p,COM_STMT_CLOSE);
+		myp_write_int(p,m->closed_stmts[--m->closed_count]);
+		if( !myp_send_packet(m,p,&pcount) )
+			break;
+	}
+}
+
+int mysql_result_failed( MYSQL_RES *r ) {
+	return r->stream_failed;
+}
+
 int mysql_field_count( MYSQL *m ) {
 	return m->last_field_count;
 }
@@ -425,12 +618,15 @@ int mysql_real_escape_string( MYSQL *m, char *sout, const char *sin, int length
 void mysql_close( MYSQL *m ) {
 	MYSQL_PACKET *p = &m->packet;
 	int pcount = 0;
+	if( m->streaming )
+		stream_done(m->streaming);
 	myp_begin_packet(p,0);
 	myp_write_byte(p,COM_QUIT);
 	myp_send_packet(m,p,&pcount);
 	myp_close(m);
 	free(m->packet.buf);
 	free(m->infos.server_version);
+	free(m->closed_stmts);
 	free(m);
 }
 
@@ -457,7 +653,10 @@ unsigned long *mysql_fetch_lengths( MYSQL_RES *r ) {
 }
 
 MYSQL_ROW mysql_fetch_row( MYSQL_RES * r ) {
-	MYSQL_ROW_DATA *cur = r->current;
+	MYSQL_ROW_DATA *cur;
+	if( r->stream_row.datas )
+		return r->stream ? stream_fetch_row(r) : NULL;
+	cur = r->current;
 	if( cur == NULL )
 		cur = r->rows;
 	else {
@@ -482,6 +681,11 @@ MYSQL_ROW mysql_fetch_row( MYSQL_RES * r ) {
 }
 
 void mysql_free_result( MYSQL_RES *r ) {
+	if( r->stream_row.datas ) {
+		stream_done(r);
+		free(r->stream_row.datas);
+		free(r->stream_row.lengths);
+	}
 	if( r->fields ) {
 		int i;
 		for(i=0;i<r->nfields;i++) {
@@ -508,4 +712,140 @@ void mysql_free_result( MYSQL_RES *r ) {
 	free(r);
 }
 
+// STATEMENTS API
+
+// skip the parameter or column definitions sent by a prepare, up to their EOF
+static int skip_definitions( MYSQL *m ) {
+	MYSQL_PACKET *p = &m->packet;
+	while( 1 ) {
+		if( !myp_read_packet(m,p) )
+			return 0;
+		if( (unsigned char)p->buf[0] == 0xFE && p->size < 9 )
+			return 1;
+	}
+}
+
+MYSQL_STMT *mysql_stmt_prepare( MYSQL *m, const char *query, int qlength ) {
+	MYSQL_PACKET *p = &m->packet;
+	MYSQL_STMT *s;
+	int pcount = 0;
+	if( !m->is41 ) {
+		error(m,"Prepared statements need a 4.1+ server",NULL);
+		return NULL;
+	}
+	begin_command(m);
+	myp_begin_packet(p,0);
+	myp_write_byte(p,COM_STMT_PREPARE);
+	myp_write(p,query,qlength);
+	if( !myp_send_packet(m,p,&pcount) ) {
+		error(m,"Failed to send packet",NULL);
+		return NULL;
+	}
+	if( !myp_ok(m,0) )
+		return NULL;
+	s = (MYSQL_STMT*)malloc(sizeof(struct _MYSQL_STMT));
+	memset(s,0,sizeof(struct _MYSQL_STMT));
+	s->m = m;
+	s->id = myp_read_int(p);
+	s->nfields = myp_read_ui16(p);
+	s->nparams = myp_read_ui16(p);
+	// each result sends its columns again, so the definitions are not kept
+	if( p->error || (s->nparams && !skip_definitions(m)) || (s->nfields && !skip_definitions(m)) ) {
+		mysql_stmt_close(s);
+		error(m,"Failed to read prepared statement",NULL);
+		return NULL;
+	}
+	if( s->nparams ) {
+		s->param_types = (unsigned short*)malloc(sizeof(unsigned short) * s->nparams);
+		// 0xFFFF : not sent yet
+		memset(s->param_types,0xFF,sizeof(unsigned short) * s->nparams);
+	}
+	return s;
+}
+
+int mysql_stmt_param_count( MYSQL_STMT *s ) {
+	return s->nparams;
+}
+
+// the answer is read like the one of mysql_real_query, with mysql_store_result or
+// mysql_use_result, which then decode binary rows
+int mysql_stmt_execute( MYSQL_STMT *s, MYSQL_BIND *params ) {
+	MYSQL *m = s->m;
+	MYSQL_PACKET *p = &m->packet;
+	int pcount = 0;
+	int i;
+	begin_command(m);
+	myp_begin_packet(p,0);
+	myp_write_byte(p,COM_STMT_EXECUTE);
+	myp_write_int(p,s->id);
+	myp_write_byte(p,0); // no cursor
+	myp_write_int(p,1); // iteration count
+	if( s->nparams ) {
+		int nulls = p->size;
+		int rebind = 0;
+		for(i=0;i<(s->nparams + 7) >> 3;i++)
+			myp_write_byte(p,0);
+		for(i=0;i<s->nparams;i++) {
+			unsigned short t = (unsigned short)(params[i].buffer_type | (params[i].is_unsigned ? 0x8000 : 0));
+			if( params[i].buffer_type == FIELD_TYPE_NULL )
+				p->buf[nulls + (i >> 3)] |= 1 << (i & 7);
+			if( t != s->param_types[i] ) {
+				s->param_types[i] = t;
+				rebind = 1;
+			}
+		}
+		// the server keeps the types of the previous execute
+		myp_write_byte(p,rebind);
+		if( rebind )
+			for(i=0;i<s->nparams;i++) {
+				myp_write_byte(p,s->param_types[i] & 0xFF);
+				myp_write_byte(p,s->param_types[i] >> 8);
+			}
+		for(i=0;i<s->nparams;i++) {
+			MYSQL_BIND *b = params + i;
+			int size = binary_size(b->buffer_type);
+			if( b->buffer_type == FIELD_TYPE_NULL )
+				continue;
+			if( size < 0 ) {
+				size = (int)b->length;
+				myp_write_bin(p,size);
+			}
+			myp_write(p,b->buffer,size);
+		}
+	}
+	m->last_field_count = -1;
+	m->affected_rows = -1;
+	m->last_insert_id = -1;
+	if( !myp_send_packet(m,p,&pcount) ) {
+		error(m,"Failed to send packet",NULL);
+		return -1;
+	}
+	if( !myp_ok(m,1) ) {
+		// the types may not have been taken
+		if( s->param_types )
+			memset(s->param_types,0xFF,sizeof(unsigned short) * s->nparams);
+		return -1;
+	}
+	p->id = IS_STMT;
+	return 0;
+}
+
+// the close has no answer, so it is only queued here and sent ahead of the next
+// command : this makes it safe to call from a finalizer
+void mysql_stmt_close( MYSQL_STMT *s ) {
+	MYSQL *m = s->m;
+	if( m->closed_count == m->closed_mem ) {
+		m->closed_mem = m->closed_mem ? (m->closed_mem << 1) : 8;
+		m->closed_stmts = (unsigned int*)realloc(m->closed_stmts,sizeof(unsigned int) * m->closed_mem);
+	}
+	m->closed_stmts[m->closed_count++] = s->id;
+	mysql_stmt_free(s);
+}
+
+// only releases the memory, for when the connection has already been closed
+void mysql_stmt_free( MYSQL_STMT *s ) {
+	free(s->param_types);
+	free(s);
+}
+
 /* ************************************************************************ */
@@ -93,8 +93,15 @@ int myp_read_bin( MYSQL_PACKET *p ) {
 		myp_read(p,&c,3);
 		return c;
 	}
-	if( c == 254 )
-		return myp_read_int(p);
+	if( c == 254 ) {
+		// 8 bytes, but packets are limited to 16MB anyway
+		int high;
+		c = myp_read_int(p);
+		high = myp_read_int(p);
+		if( high || c < 0 )
+			p->error = 1;
+		return c;
+	}
 	p->error = 1;
 	return 0;
 }
@@ -234,13 +241,15 @@ void myp_write_bin( MYSQL_PACKET *p, int size ) {
 		myp_write(p,&l,2);
 	} else if( size < 0x1000000 ) {
 		unsigned char c = 253;
-		unsigned int l = (unsigned short)size;
+		unsigned int l = (unsigned int)size;
 		myp_write(p,&c,1);
 		myp_write(p,&l,3);
 	} else {
 		unsigned char c = 254;
+		int high = 0;
 		myp_write(p,&c,1);
 		myp_write(p,&size,4);
+		myp_write(p,&high,4);
 	}
 }
 
@@ -101,6 +101,7 @@ typedef struct {
 
 #define MAX_ERR_SIZE	1024
 #define	IS_QUERY		-123456
+#define	IS_STMT			-123457
 
 struct _MYSQL {
 	PSOCK s;
@@ -112,6 +113,13 @@ struct _MYSQL {
 	int affected_rows;
 	int last_insert_id;
 	char last_error[MAX_ERR_SIZE];
+	// unbuffered result being read, and whether its rows are still on the socket
+	struct _MYSQL_RES *streaming;
+	int stream_pending;
+	// statements closed since the last command, sent ahead of the next one
+	unsigned int *closed_stmts;
+	int closed_count;
+	int closed_mem;
 };
 
 typedef struct {
@@ -127,8 +135,22 @@ struct _MYSQL_RES {
 	MYSQL_ROW_DATA *current;
 	int row_count;
 	int memory_rows;
+	// rows use the binary protocol of prepared statements : datas are not 0-terminated
+	int binary;
+	// mysql_use_result : the connection rows are read from, until the last one
+	struct _MYSQL *stream;
+	MYSQL_ROW_DATA stream_row;
+	int stream_failed;
 };
 
+struct _MYSQL_STMT {
+	MYSQL *m;
+	unsigned int id;
+	int nparams;
+	int nfields;
+	// types sent with the last execute, so they are only sent again when they change
+	unsigned short *param_types;
+};
 
 // network
 int myp_recv_no_gc( MYSQL *m, void *buf, int size );
@@ -14,8 +14,10 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 struct _MYSQL;
 struct _MYSQL_RES;
+struct _MYSQL_STMT;
 typedef struct _MYSQL MYSQL; 
 typedef struct _MYSQL_RES MYSQL_RES;
+typedef struct _MYSQL_STMT MYSQL_STMT;
 typedef char **MYSQL_ROW;
 
 typedef enum enum_field_types {
@@ -78,11 +80,22 @@ typedef struct {
 	FIELD_TYPE type;
 } MYSQL_FIELD;
 
+// a prepared statement parameter : buffer holds a 1,2,4 or 8 bytes value for the
+// integer and floating types, or length bytes for anything else
+typedef struct {
+	FIELD_TYPE buffer_type;
+	const void *buffer;
+	unsigned long length;
+	int is_unsigned;
+} MYSQL_BIND;
+
 #define	mysql_init			mp_init
 #define mysql_real_connect	mp_real_connect
 #define mysql_select_db		mp_select_db
 #define mysql_real_query	mp_real_query
 #define mysql_store_result	mp_store_result
+#define mysql_use_result	mp_use_result
+#define mysql_result_failed	mp_result_failed
 #define mysql_field_count	mp_field_count
 #define mysql_affected_rows	mp_affected_rows
 #define mysql_escape_string	mp_escape_string
@@ -95,12 +108,19 @@ typedef struct {
 #define mysql_fetch_lengths	mp_fetch_lengths
 #define mysql_fetch_row		mp_fetch_row
 #define mysql_free_result	mp_free_result
+#define mysql_stmt_prepare	mp_stmt_prepare
+#define mysql_stmt_param_count	mp_stmt_param_count
+#define mysql_stmt_execute	mp_stmt_execute
+#define mysql_stmt_close	mp_stmt_close
+#define mysql_stmt_free		mp_stmt_free
 
 MYSQL *mysql_init( void * );
 MYSQL *mysql_real_connect( MYSQL *m, const char *host, const char *user, const char *pass, void *unused, int port, const char *socket, int options );
 int mysql_select_db( MYSQL *m, const char *dbname );
 int mysql_real_query( MYSQL *m, const char *query, int qlength );
 MYSQL_RES *mysql_store_result( MYSQL *m );
+MYSQL_RES *mysql_use_result( MYSQL *m );
+int mysql_result_failed( MYSQL_RES *r );
 int mysql_field_count( MYSQL *m );
 int mysql_affected_rows( MYSQL *m );
 int mysql_escape_string( MYSQL *m, char *sout, const char *sin, int length );
@@ -116,5 +136,11 @@ unsigned long *mysql_fetch_lengths( MYSQL_RES *r );
 MYSQL_ROW mysql_fetch_row( MYSQL_RES * r );
 void mysql_free_result( MYSQL_RES *r );
 
+MYSQL_STMT *mysql_stmt_prepare( MYSQL *m, const char *query, int qlength );
+int mysql_stmt_param_count( MYSQL_STMT *s );
+int mysql_stmt_execute( MYSQL_STMT *s, MYSQL_BIND *params );
+void mysql_stmt_close( MYSQL_STMT *s );
+void mysql_stmt_free( MYSQL_STMT *s );
+
 #endif
 /* ************************************************************************ */
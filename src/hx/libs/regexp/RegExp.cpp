@@ -1,5 +1,10 @@
 #include <hxcpp.h>
+#include <hx/Thread.h>
 #include <string.h>
+#include <string>
+#include <list>
+#include <map>
+#include <vector>
 
 #define PCRE2_STATIC
 #define PCRE2_CODE_UNIT_WIDTH 0
@@ -14,10 +19,212 @@ static void regexp_compilation_error(String pattern, int error_code, size_t erro
    hx::Throw(HX_CSTRING("Regexp compilation error : ") + String((const char*)error_buffer) + HX_CSTRING(" in ") + pattern);
 }
 
+// A compiled pattern, shared by all the regexps built with the same pattern and options, so
+//  constructing an EReg in a loop only compiles it once.  Matching only reads the code, and
+//  each width is compiled on first use.
+//  Nothing allocates from the gc while sgCodeMutex is held, since that could wait for a
+//  collection while another thread waits for the lock.
+struct PcreCode
+{
+   std::string key;
+   unsigned int flags;
+   int refs;
+   int n_groups;
+   pcre2_code_8  *code8;
+   #ifdef HX_SMART_STRINGS
+   pcre2_code_16 *code16;
+   #endif
+};
+
+typedef std::list<PcreCode *> PcreCodeList;
+
+static HxMutex sgCodeMutex;
+// Most recently used first
+static PcreCodeList sgCodeLru;
+static std::map<std::string,PcreCodeList::iterator> sgCodeCache;
+static int sgCodeCacheSize = 64;
+
+static void freeCode(PcreCode *code)
+{
+   pcre2_code_free_8(code->code8);
+   #ifdef HX_SMART_STRINGS
+   pcre2_code_free_16(code->code16);
+   #endif
+   delete code;
+}
+
+// sgCodeMutex must be held
+static void releaseCodeLocked(PcreCode *code)
+{
+   if (--code->refs==0)
+      freeCode(code);
+}
+
+static void releaseCode(PcreCode *code)
+{
+   AutoLock lock(sgCodeMutex);
+   releaseCodeLocked(code);
+}
+
+// sgCodeMutex must be held
+static void trimCodeCache(int inSize)
+{
+   while((int)sgCodeLru.size()>inSize)
+   {
+      PcreCode *code = sgCodeLru.back();
+      sgCodeLru.pop_back();
+      sgCodeCache.erase(code->key);
+      releaseCodeLocked(code);
+   }
+}
+
+// Matching falls back to the interpreter if this fails, or there is no jit for the platform
+static pcre2_code_8 *compile8(String expr, unsigned int flags)
+{
+   int error_code = 0;
+   size_t error_offset;
+   int utf8Length = 0;
+   PCRE2_SPTR8 utf8 = (PCRE2_SPTR8)expr.utf8_str(NULL, true, &utf8Length);
+   pcre2_code_8 *code = pcre2_compile_8(utf8, utf8Length, flags, &error_code, &error_offset, NULL);
+   if (!code)
+      regexp_compilation_error(expr,error_code,error_offset);
+   pcre2_jit_compile_8(code, PCRE2_JIT_COMPLETE);
+   return code;
+}
+
+#ifdef HX_SMART_STRINGS
+static pcre2_code_16 *compile16(String expr, unsigned int flags)
+{
+   int error_code = 0;
+   size_t error_offset;
+   hx::strbuf buf;
+   int utf16Length = 0;
+   PCRE2_SPTR16 utf16 = (PCRE2_SPTR16)expr.wc_str(&buf, &utf16Length);
+   pcre2_code_16 *code = pcre2_compile_16(utf16, utf16Length, flags, &error_code, &error_offset, NULL);
+   if (!code)
+      regexp_compilation_error(expr,error_code,error_offset);
+   pcre2_jit_compile_16(code, PCRE2_JIT_COMPLETE);
+   return code;
+}
+#endif
+
+// The code of the width not compiled yet, compiled outside the lock and kept by the first thread
+static pcre2_code_8 *getCode8(PcreCode *code, String expr)
+{
+   {
+      AutoLock lock(sgCodeMutex);
+      if (code->code8)
+         return code->code8;
+   }
+   pcre2_code_8 *compiled = compile8(expr, code->flags);
+   AutoLock lock(sgCodeMutex);
+   if (code->code8)
+      pcre2_code_free_8(compiled);
+   else
+      code->code8 = compiled;
+   return code->code8;
+}
+
+#ifdef HX_SMART_STRINGS
+static pcre2_code_16 *getCode16(PcreCode *code, String expr)
+{
+   {
+      AutoLock lock(sgCodeMutex);
+      if (code->code16)
+         return code->code16;
+   }
+   pcre2_code_16 *compiled = compile16(expr, code->flags);
+   AutoLock lock(sgCodeMutex);
+   if (code->code16)
+      pcre2_code_free_16(compiled);
+   else
+      code->code16 = compiled;
+   return code->code16;
+}
+#endif
+
+// Returns a code with a reference for the caller, from the cache if possible
+static PcreCode *acquireCode(String expr, unsigned int flags)
+{
+   hx::strbuf buf;
+   int utf8Length = 0;
+   const char *utf8 = expr.utf8_str(&buf, true, &utf8Length);
+   std::string key((const char *)&flags, sizeof(flags));
+   key.append(utf8, utf8Length);
+
+   {
+      AutoLock lock(sgCodeMutex);
+      std::map<std::string,PcreCodeList::iterator>::iterator found = sgCodeCache.find(key);
+      if (found!=sgCodeCache.end())
+      {
+         sgCodeLru.splice(sgCodeLru.begin(), sgCodeLru, found->second);
+         PcreCode *code = *found->second;
+         code->refs++;
+         return code;
+      }
+   }
+
+   // Compile the width of the pattern now, so errors are reported by the constructor
+   PcreCode *code = new PcreCode();
+   code->key = key;
+   code->flags = flags;
+   code->refs = 1;
+   code->n_groups = 0;
+   code->code8 = 0;
+   #ifdef HX_SMART_STRINGS
+   code->code16 = 0;
+   #endif
+   try
+   {
+      #ifdef HX_SMART_STRINGS
+      if (expr.isUTF16Encoded())
+      {
+         code->code16 = compile16(expr, flags);
+         pcre2_pattern_info_16(code->code16,PCRE2_INFO_CAPTURECOUNT,&code->n_groups);
+      }
+      else
+      #endif
+      {
+         code->code8 = compile8(expr, flags);
+         pcre2_pattern_info_8(code->code8,PCRE2_INFO_CAPTURECOUNT,&code->n_groups);
+      }
+   }
+   catch(...)
+   {
+      delete code;
+      throw;
+   }
+   code->n_groups++;
+
+   AutoLock lock(sgCodeMutex);
+   if (sgCodeCacheSize>0)
+   {
+      std::map<std::string,PcreCodeList::iterator>::iterator found = sgCodeCache.find(key);
+      if (found!=sgCodeCache.end())
+      {
+         // Another thread compiled it meanwhile
+         freeCode(code);
+         code = *found->second;
+         code->refs++;
+      }
+      else
+      {
+         code->refs++;
+         sgCodeLru.push_front(code);
+         sgCodeCache[key] = sgCodeLru.begin();
+         trimCodeCache(sgCodeCacheSize);
+      }
+   }
+   return code;
+}
+
+
 struct pcredata : public hx::Object
 {
    HX_IS_INSTANCE_OF enum { _hx_ClassId = hx::clsIdPcreData };
 
+   PcreCode *code;
+   // Borrowed from code, once this regexp has matched a string of the width
    pcre2_code_8   *rUtf8;
    #ifdef HX_SMART_STRINGS
    pcre2_code_16   *rUtf16;
@@ -29,49 +236,24 @@ struct pcredata : public hx::Object
    pcre2_match_data_16* match_data16;
    #endif
 
-   unsigned int flags;
    String string;
    String expr;
 
-   void create8(pcre2_code_8 *inR, String inExpr, int inFlags)
+   void create(PcreCode *inCode, String inExpr)
    {
-      rUtf8 = inR;
+      code = inCode;
+      rUtf8 = 0;
+      match_data8 = 0;
       #ifdef HX_SMART_STRINGS
       rUtf16 = 0;
-      #endif
-      expr = inExpr;
-      HX_OBJ_WB_GET(this, expr.raw_ref());
-      flags = inFlags;
-
-      n_groups = 0;
-      pcre2_pattern_info_8(rUtf8,PCRE2_INFO_CAPTURECOUNT,&n_groups);
-      n_groups++;
-      match_data8 = pcre2_match_data_create_from_pattern_8(rUtf8, NULL);
-      #ifdef HX_SMART_STRINGS
       match_data16 = 0;
       #endif
-
-      _hx_set_finalizer(this, finalize);
-   }
-
-   #ifdef HX_SMART_STRINGS
-   void create16(pcre2_code_16 *inR, String inExpr, int inFlags)
-   {
-      rUtf8 = 0;
-      rUtf16 = inR;
       expr = inExpr;
       HX_OBJ_WB_GET(this, expr.raw_ref());
-      flags = inFlags;
-
-      n_groups = 0;
-      pcre2_pattern_info_16(rUtf16,PCRE2_INFO_CAPTURECOUNT,&n_groups);
-      n_groups++;
-      match_data8 = 0;
-      match_data16 = pcre2_match_data_create_from_pattern_16(rUtf16, NULL);
+      n_groups = code->n_groups;
 
       _hx_set_finalizer(this, finalize);
    }
-   #endif
 
    bool run(String string,int pos,int len)
    {
@@ -80,42 +262,38 @@ struct pcredata : public hx::Object
       {
          if (!rUtf16)
          {
-            int error_code;
-            size_t error_offset;
-            hx::strbuf buf;
-            int utf16Length = 0;
-            PCRE2_SPTR16 utf16 = (PCRE2_SPTR16)expr.wc_str(&buf, &utf16Length);
-            rUtf16 = pcre2_compile_16((PCRE2_SPTR16)expr.wc_str(&buf),utf16Length,flags,&error_code,&error_offset,NULL);
-            if (!rUtf16) {
-               regexp_compilation_error(expr,error_code,error_offset);
-            }
+            rUtf16 = getCode16(code, expr);
             match_data16 = pcre2_match_data_create_from_pattern_16(rUtf16, NULL);
          }
 
-         int n = pcre2_match_16(rUtf16,(PCRE2_SPTR16)string.raw_wptr(),pos+len,pos,PCRE2_NO_UTF_CHECK,match_data16,NULL);
+         PCRE2_SPTR16 subject = (PCRE2_SPTR16)string.raw_wptr();
+         int n = pcre2_match_16(rUtf16,subject,pos+len,pos,PCRE2_NO_UTF_CHECK,match_data16,NULL);
+         // The jit stack is smaller than the interpreter heap
+         if (n==PCRE2_ERROR_JIT_STACKLIMIT)
+            n = pcre2_match_16(rUtf16,subject,pos+len,pos,PCRE2_NO_UTF_CHECK|PCRE2_NO_JIT,match_data16,NULL);
          return n>=0;
       }
+      #endif
 
       if (!rUtf8)
       {
-         int error_code;
-         size_t error_offset;
-         int utf8Length = 0;
-         PCRE2_SPTR8 utf8 = (PCRE2_SPTR8)expr.utf8_str(NULL, true, &utf8Length);
-         rUtf8 = pcre2_compile_8(utf8, utf8Length, flags, &error_code, &error_offset, NULL);
-         if (!rUtf8) {
-            regexp_compilation_error(expr,error_code,error_offset);
-         }
+         rUtf8 = getCode8(code, expr);
          match_data8 = pcre2_match_data_create_from_pattern_8(rUtf8, NULL);
       }
 
-      #endif
-      return pcre2_match_8(rUtf8,(PCRE2_SPTR8)string.utf8_str(),pos+len,pos,PCRE2_NO_UTF_CHECK,match_data8,NULL) >= 0;
+      PCRE2_SPTR8 subject = (PCRE2_SPTR8)string.utf8_str();
+      int n = pcre2_match_8(rUtf8,subject,pos+len,pos,PCRE2_NO_UTF_CHECK,match_data8,NULL);
+      if (n==PCRE2_ERROR_JIT_STACKLIMIT)
+         n = pcre2_match_8(rUtf8,subject,pos+len,pos,PCRE2_NO_UTF_CHECK|PCRE2_NO_JIT,match_data8,NULL);
+      return n>=0;
    }
 
-   size_t* get_matches() {
+   size_t* get_matches() { return get_matches(string); }
+
+   // The offsets of the last run on inString
+   size_t* get_matches(const String &inString) {
       #ifdef HX_SMART_STRINGS
-      if (string.isUTF16Encoded()) {
+      if (inString.isUTF16Encoded()) {
          return pcre2_get_ovector_pointer_16(match_data16);
       }
       #endif
@@ -124,13 +302,18 @@ struct pcredata : public hx::Object
 
    void destroy()
    {
-      pcre2_code_free_8( rUtf8 );
       pcre2_match_data_free_8( match_data8 );
-
+      match_data8 = 0;
       #ifdef HX_SMART_STRINGS
-      pcre2_code_free_16( rUtf16 );
       pcre2_match_data_free_16( match_data16 );
+      match_data16 = 0;
       #endif
+
+      if (code)
+      {
+         releaseCode(code);
+         code = 0;
+      }
    }
 
    void __Mark(hx::MarkContext *__inCtx) { HX_MARK_MEMBER(string); HX_MARK_MEMBER(expr); }
@@ -157,6 +340,7 @@ struct pcredata : public hx::Object
       <li>u : run in utf8 mode</li>
       <li>g : turn off greedy behavior</li>
    </ul>
+   The compiled pattern is shared with other regexps of the same pattern and options.
    </doc>
 **/
 
@@ -189,34 +373,21 @@ Dynamic _hx_regexp_new_options(String s, String opt)
       }
    }
 
-   #ifdef HX_SMART_STRINGS
-   if (s.isUTF16Encoded())
-   {
-      int error_code;
-      size_t error_offset;
-      pcre2_code_16 *p = pcre2_compile_16((PCRE2_SPTR16)s.raw_wptr(),s.length,options,&error_code,&error_offset,NULL);
-      if( !p ) {
-         regexp_compilation_error(s,error_code,error_offset);
-      }
-
-      pcredata *pdata = new pcredata;
-      pdata->create16(p,s,options);
-      return pdata;
-   }
-   else
-   #endif
-   {
-      int error_code = 0;
-      size_t error_offset;
-      pcre2_code_8 *p =  pcre2_compile_8((PCRE2_SPTR8)s.utf8_str(),s.length,options,&error_code,&error_offset,NULL);
-      if( !p ) {
-         regexp_compilation_error(s,error_code,error_offset);
-      }
+   PcreCode *code = acquireCode(s, options);
+   pcredata *pdata = new pcredata;
+   pdata->create(code,s);
+   return pdata;
+}
 
-      pcredata *pdata = new pcredata;
-      pdata->create8(p,s,options);
-      return pdata;
-   }
+/**
+   regexp_set_cache_size : size:int -> void
+   <doc>Set how many compiled patterns are kept for new regexps (default 64).  0 turns off the cache.</doc>
+**/
+void _hx_regexp_set_cache_size(int size)
+{
+   AutoLock lock(sgCodeMutex);
+   sgCodeCacheSize = size<0 ? 0 : size;
+   trimCodeCache(sgCodeCacheSize);
 }
 
 bool _hx_regexp_match(Dynamic handle, String string, int pos, int len)
@@ -290,3 +461,234 @@ int _hx_regexp_matched_num(Dynamic handle)
 }
 
 
+// ---------------------------------------------------------------
+// Whole-string operations : the match loop runs here, without a Haxe object per match
+
+// Offset of the character after inPos, so an empty match never restarts inside a character
+static int nextCharOffset(const String &inString, int inPos)
+{
+   #ifdef HX_SMART_STRINGS
+   if (inString.isUTF16Encoded())
+   {
+      int c = inString.raw_wptr()[inPos];
+      return inPos + ( (c>=0xd800 && c<0xdc00 && inPos+1<inString.length) ? 2 : 1 );
+   }
+   #endif
+   const unsigned char *s = (const unsigned char *)inString.raw_ptr();
+   inPos++;
+   while(inPos<inString.length && (s[inPos] & 0xc0)==0x80)
+      inPos++;
+   return inPos;
+}
+
+// Output of replace, in the wider encoding of the subject and replacement
+template<typename CHAR>
+struct RegexpBuffer
+{
+   std::vector<CHAR> chars;
+
+   void addSub(const String &inString, int inPos, int inLen)
+   {
+      if (inLen<=0)
+         return;
+      size_t size = chars.size();
+      chars.resize(size + inLen);
+      CHAR *dest = &chars[size];
+      #ifdef HX_SMART_STRINGS
+      if (inString.isUTF16Encoded())
+      {
+         const char16_t *src = inString.raw_wptr() + inPos;
+         for(int i=0;i<inLen;i++)
+            dest[i] = (CHAR)src[i];
+         return;
+      }
+      #endif
+      const unsigned char *src = (const unsigned char *)inString.raw_ptr() + inPos;
+      for(int i=0;i<inLen;i++)
+         dest[i] = src[i];
+   }
+
+   void addChar(int inChar) { chars.push_back((CHAR)inChar); }
+
+   String toString() { return chars.empty() ? String::emptyString : String::create(&chars[0],(int)chars.size()); }
+};
+
+// A piece of the replacement : text from it, or a matched group
+struct ReplacePart
+{
+   int group;
+   int pos;
+   int len;
+};
+
+// Parses "by" the way EReg.replace does : $1..$9 for groups, $$ for a $, anything else as is
+static void parseReplacement(const String &by, int inGroups, std::vector<ReplacePart> &outParts)
+{
+   int start = 0;
+   int i = 0;
+   while(i<by.length)
+   {
+      if (by.cca(i)!='$')
+      {
+         i++;
+         continue;
+      }
+      ReplacePart literal = { -1, start, i-start };
+      outParts.push_back(literal);
+      int c = by.cca(i+1);
+      if (c>='1' && c<='9' && c-'0'<inGroups)
+      {
+         ReplacePart group = { c-'0', 0, 0 };
+         outParts.push_back(group);
+         i += 2;
+         start = i;
+      }
+      else if (c=='$')
+      {
+         // The second $ starts the next literal
+         i += 2;
+         start = i-1;
+      }
+      else
+      {
+         start = i;
+         i++;
+      }
+   }
+   ReplacePart literal = { -1, start, by.length-start };
+   outParts.push_back(literal);
+}
+
+template<typename CHAR>
+static String regexpReplace(pcredata *d, const String &string, const String &by, bool global)
+{
+   std::vector<ReplacePart> parts;
+   parseReplacement(by, d->n_groups, parts);
+
+   RegexpBuffer<CHAR> out;
+   out.chars.reserve(string.length + 16);
+   int pos = 0;
+   int len = string.length;
+   bool first = true;
+   do
+   {
+      if (!d->run(string,pos,len))
+         break;
+      size_t *m = d->get_matches(string);
+      int mpos = (int)m[0];
+      int mlen = (int)(m[1]-m[0]);
+      if (mlen==0 && !first)
+      {
+         if (mpos==string.length)
+            break;
+         mpos = nextCharOffset(string,mpos);
+      }
+      out.addSub(string, pos, mpos-pos);
+      for(size_t p=0;p<parts.size();p++)
+      {
+         const ReplacePart &part = parts[p];
+         if (part.group<0)
+            out.addSub(by, part.pos, part.len);
+         else if (m[part.group*2]!=PCRE2_UNSET)
+            out.addSub(string, (int)m[part.group*2], (int)(m[part.group*2+1]-m[part.group*2]));
+      }
+      int tot = mpos + mlen - pos;
+      pos += tot;
+      len -= tot;
+      first = false;
+   } while(global);
+   out.addSub(string, pos, len);
+   return out.toString();
+}
+
+/**
+   regexp_match_all : 'regexp -> string -> pos:int -> len:int -> offsets:array -> int
+   <doc>Find all the matches in the substring, without overlaps, and set [offsets] to a start
+   and end for each group of each match : [matched_num]*2 ints per match, -1 for a group that
+   did not take part.  Returns the number of matches.</doc>
+**/
+int _hx_regexp_match_all(Dynamic handle, String string, int pos, int len, Array<int> offsets)
+{
+   offsets->resize(0);
+   if( pos < 0 || len < 0 || pos > string.length || pos + len > string.length )
+      return 0;
+
+   pcredata *d = PCRE(handle);
+   int groups = d->n_groups;
+   int end = pos + len;
+   int count = 0;
+   while(pos<=end && d->run(string,pos,end-pos))
+   {
+      size_t *m = d->get_matches(string);
+      int base = offsets->length;
+      offsets->resize(base + groups*2);
+      int *out = (int *)offsets->getBase() + base;
+      for(int g=0;g<groups*2;g++)
+         out[g] = m[g]==PCRE2_UNSET ? -1 : (int)m[g];
+      count++;
+
+      int matchEnd = (int)m[1];
+      if (matchEnd>(int)m[0])
+         pos = matchEnd;
+      else if (matchEnd<end)
+         pos = nextCharOffset(string,matchEnd);
+      else
+         break;
+   }
+   d->string = String();
+   return count;
+}
+
+/**
+   regexp_replace : 'regexp -> string -> by:string -> global:bool -> string
+   <doc>Replace the first match, or all of them if [global], as EReg.replace does, building
+   the result in one pass</doc>
+**/
+String _hx_regexp_replace(Dynamic handle, String string, String by, bool global)
+{
+   pcredata *d = PCRE(handle);
+   String result;
+   #ifdef HX_SMART_STRINGS
+   if (string.isUTF16Encoded() || by.isUTF16Encoded())
+      result = regexpReplace<char16_t>(d,string,by,global);
+   else
+   #endif
+      result = regexpReplace<char>(d,string,by,global);
+   d->string = String();
+   return result;
+}
+
+/**
+   regexp_split : 'regexp -> string -> global:bool -> string array
+   <doc>Split the string at the first match, or at all of them if [global], as EReg.split does</doc>
+**/
+Array<String> _hx_regexp_split(Dynamic handle, String string, bool global)
+{
+   pcredata *d = PCRE(handle);
+   Array<String> result = Array_obj<String>::__new(0,0);
+   int pos = 0;
+   int len = string.length;
+   bool first = true;
+   do
+   {
+      if (!d->run(string,pos,len))
+         break;
+      size_t *m = d->get_matches(string);
+      int mpos = (int)m[0];
+      int mlen = (int)(m[1]-m[0]);
+      if (mlen==0 && !first)
+      {
+         if (mpos==string.length)
+            break;
+         mpos = nextCharOffset(string,mpos);
+      }
+      result->push(string.substr(pos, mpos-pos));
+      int tot = mpos + mlen - pos;
+      pos += tot;
+      len -= tot;
+      first = false;
+   } while(global);
+   result->push(string.substr(pos, len));
+   d->string = String();
+   return result;
+}
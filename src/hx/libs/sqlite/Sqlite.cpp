@@ -23,12 +23,61 @@
 #include <hxcpp.h>
 #include "sqlite3.h"
 #include <stdlib.h>
+#include <vector>
 
 
 // Put in anon-namespace to avoid conflicts if static-linked
 namespace {
 
 
+static void readColumns(sqlite3_stmt *r, int ncols, String *names, int *bools, String sql)
+{
+   for(int i=0;i<ncols;i++)
+   {
+      names[i] = String::createPermanent(sqlite3_column_name(r,i),-1);
+      for(int j=0;j<i;j++)
+         if( names[j] == names[i] )
+            hx::Throw(HX_CSTRING("Error, same field is two times in the request ") + sql);
+
+      const char *dtype = sqlite3_column_decltype(r,i);
+      bools[i] = dtype?(strcmp(dtype,"BOOL") == 0):0;
+   }
+}
+
+static Dynamic readCell(sqlite3_stmt *r, int i, int isBool)
+{
+   switch( sqlite3_column_type(r,i) )
+   {
+   case SQLITE_NULL:
+      return null();
+   case SQLITE_INTEGER:
+      if( isBool )
+         return bool(sqlite3_column_int(r,i));
+      return int(sqlite3_column_int(r,i));
+   case SQLITE_FLOAT:
+      return Float(sqlite3_column_double(r,i));
+   case SQLITE_TEXT:
+      return String((char*)sqlite3_column_text(r,i));
+   case SQLITE_BLOB:
+      {
+         int size = sqlite3_column_bytes(r,i);
+         return Array_obj<unsigned char>::fromData((const unsigned char *)sqlite3_column_blob(r,i),size);
+      }
+   default:
+      hx::Throw( HX_CSTRING("Unknown Sqlite type #") +
+                   String((int)sqlite3_column_type(r,i)));
+   }
+   return null();
+}
+
+static Dynamic readRow(sqlite3_stmt *r, int ncols, String *names, int *bools)
+{
+   hx::Anon v = hx::Anon_obj::Create();
+   for(int i=0;i<ncols;i++)
+      v->__SetField(names[i],readCell(r,i,bools[i]),hx::paccDynamic);
+   return v;
+}
+
 
 struct result : public hx::Object
 {
@@ -55,16 +104,7 @@ struct result : public hx::Object
       bools = (int*)malloc(sizeof(int)*ncols);
       first = 1;
       done = 0;
-      for(int i=0;i<ncols;i++)
-      {
-         names[i] = String::createPermanent(sqlite3_column_name(r,i),-1);
-         for(int j=0;j<i;j++)
-            if( names[j] == names[i] )
-               hx::Throw(HX_CSTRING("Error, same field is two times in the request ") + sql);
-
-         const char *dtype = sqlite3_column_decltype(r,i);
-         bools[i] = dtype?(strcmp(dtype,"BOOL") == 0):0;
-      }
+      readColumns(r, ncols, names, bools, sql);
    }
 
    static void finalize(Dynamic obj) { ((result *)(obj.mPtr))->destroy(false); }
@@ -117,13 +157,24 @@ struct database : public hx::Object
 {
    sqlite3 *db;
    hx::ObjectPtr<result> last;
+   // Prepared statements not currently handed out, least recently used first
+   Array<Dynamic> cache;
+   int cacheSize;
 
    void create(sqlite3 *inDb)
    {
       db = inDb;
+      cache = Array_obj<Dynamic>::__new();
+      HX_OBJ_WB_GET(this, cache.mPtr);
+      cacheSize = 32;
       _hx_set_finalizer(this, finalize);
    }
    static void finalize(Dynamic obj) { ((database *)(obj.mPtr))->destroy(false); }
+
+   struct statement *takeStatement(String sql);
+   void returnStatement(struct statement *inStatement);
+   void trimCache(int inSize);
+
    void destroy(bool inThrowError)
    {
       if (db)
@@ -134,7 +185,11 @@ struct database : public hx::Object
             last = null();
          }
 
-         if( sqlite3_close(db) != SQLITE_OK )
+         trimCache(0);
+
+         // Statements still handed out are finalized by their own finalizers, and
+         //  close_v2 defers the close until then
+         if( sqlite3_close_v2(db) != SQLITE_OK )
          {
             if (inThrowError)
                hx::Throw(HX_CSTRING("Sqlite: could not close"));
@@ -153,14 +208,247 @@ struct database : public hx::Object
       HX_OBJ_WB_GET(this, last.mPtr);
    }
 
-   void __Mark(hx::MarkContext *__inCtx) { HX_MARK_MEMBER(last); }
+   void __Mark(hx::MarkContext *__inCtx) { HX_MARK_MEMBER(last); HX_MARK_MEMBER(cache); }
    #ifdef HXCPP_VISIT_ALLOCS
-   void __Visit(hx::VisitContext *__inCtx) { HX_VISIT_MEMBER(last); }
+   void __Visit(hx::VisitContext *__inCtx) { HX_VISIT_MEMBER(last); HX_VISIT_MEMBER(cache); }
    #endif
 
    String toString() { return HX_CSTRING("Sqlite Databse"); }
 };
 
+
+// A prepared statement, kept in the database cache between uses so the sql is only
+//  parsed and planned once
+struct statement : public hx::Object
+{
+   HX_IS_INSTANCE_OF enum { _hx_ClassId = hx::clsIdSqliteStatement };
+
+   hx::ObjectPtr<database> owner;
+   sqlite3_stmt *r;
+   String sql;
+   int ncols;
+   int nparams;
+   int changes;
+   String *names;
+   int *bools;
+   // Handed back with stmt_close - the sqlite statement now belongs to another object
+   bool closed;
+
+   void create(database *inOwner, sqlite3_stmt *inR, String inSql)
+   {
+      _hx_set_finalizer(this, finalize);
+      closed = false;
+
+      owner = inOwner;
+      HX_OBJ_WB_GET(this, owner.mPtr);
+      r = inR;
+      sql = inSql;
+      HX_OBJ_WB_GET(this, sql.raw_ref());
+      changes = 0;
+
+      ncols = sqlite3_column_count(r);
+      nparams = sqlite3_bind_parameter_count(r);
+      names = (String *)malloc(sizeof(String)*ncols);
+      bools = (int*)malloc(sizeof(int)*ncols);
+      readColumns(r, ncols, names, bools, sql);
+   }
+
+   // Moves the sqlite statement into a new object for the cache and closes this handle,
+   //  so a stale handle can never alias the statement once it is prepared again
+   statement *handBack()
+   {
+      statement *s = new statement();
+      _hx_set_finalizer(s, finalize);
+      s->closed = false;
+      s->owner = owner;
+      HX_OBJ_WB_GET(s, s->owner.mPtr);
+      s->r = r;
+      s->sql = sql;
+      HX_OBJ_WB_GET(s, s->sql.raw_ref());
+      s->ncols = ncols;
+      s->nparams = nparams;
+      s->changes = 0;
+      s->names = names;
+      s->bools = bools;
+
+      r = 0;
+      names = 0;
+      bools = 0;
+      closed = true;
+      return s;
+   }
+
+   static void finalize(Dynamic obj) { ((statement *)(obj.mPtr))->destroy(); }
+   void destroy()
+   {
+      if (bools)
+      {
+         free(bools);
+         bools = 0;
+      }
+      if (names)
+      {
+         free(names);
+         names = 0;
+      }
+      if (r)
+      {
+         sqlite3_finalize(r);
+         r = 0;
+      }
+   }
+
+   void checkError(int inCode)
+   {
+      if (inCode!=SQLITE_OK)
+         hx::Throw( HX_CSTRING("Sqlite error in ") + sql + HX_CSTRING(" : ") +
+                     String(sqlite3_errmsg(owner->db) ) );
+   }
+
+   void checkIndex(int inIndex)
+   {
+      if (inIndex<1 || inIndex>nparams)
+         hx::Throw( HX_CSTRING("Sqlite: Invalid parameter index ") + String(inIndex) );
+   }
+
+   void bind(int inIndex, Dynamic inValue)
+   {
+      checkIndex(inIndex);
+      hx::Object *obj = inValue.mPtr;
+      if (!obj)
+      {
+         checkError( sqlite3_bind_null(r,inIndex) );
+         return;
+      }
+      switch(obj->__GetType())
+      {
+         case vtInt: case vtBool:
+            checkError( sqlite3_bind_int(r,inIndex,obj->__ToInt()) );
+            break;
+         case vtInt64:
+            checkError( sqlite3_bind_int64(r,inIndex,obj->__ToInt64()) );
+            break;
+         case vtFloat:
+            checkError( sqlite3_bind_double(r,inIndex,obj->__ToDouble()) );
+            break;
+         case vtString:
+            bindString(inIndex, obj->toString());
+            break;
+         default:
+            {
+               Array_obj<unsigned char> *bytes = dynamic_cast< Array_obj<unsigned char> * >(obj);
+               if (!bytes)
+                  hx::Throw( HX_CSTRING("Sqlite: Unsupported parameter type for ") + sql );
+               bindBytes(inIndex, bytes);
+            }
+      }
+   }
+
+   void bindString(int inIndex, String inValue)
+   {
+      if (!inValue.raw_ptr())
+      {
+         checkError( sqlite3_bind_null(r,inIndex) );
+         return;
+      }
+      int byteLength = 0;
+      const char *utf8 = inValue.utf8_str(0, true, &byteLength);
+      checkError( sqlite3_bind_text(r,inIndex,utf8,byteLength,SQLITE_TRANSIENT) );
+   }
+
+   void bindBytes(int inIndex, Array_obj<unsigned char> *inValue)
+   {
+      if (!inValue)
+         checkError( sqlite3_bind_null(r,inIndex) );
+      else
+         checkError( sqlite3_bind_blob(r,inIndex,inValue->getBase(),inValue->length,SQLITE_TRANSIENT) );
+   }
+
+   // Returns true if there is a row to read
+   bool step()
+   {
+      switch( sqlite3_step(r) )
+      {
+         case SQLITE_ROW:
+            return true;
+         case SQLITE_DONE:
+            changes = sqlite3_changes(owner->db);
+            return false;
+         case SQLITE_BUSY:
+            hx::Throw(HX_CSTRING("Database is busy"));
+         default:
+            hx::Throw( HX_CSTRING("Sqlite error in ") + sql + HX_CSTRING(" : ") +
+                        String(sqlite3_errmsg(owner->db) ) );
+      }
+      return false;
+   }
+
+   void __Mark(hx::MarkContext *__inCtx) { HX_MARK_MEMBER(owner); HX_MARK_MEMBER(sql); }
+   #ifdef HXCPP_VISIT_ALLOCS
+   void __Visit(hx::VisitContext *__inCtx) { HX_VISIT_MEMBER(owner); HX_VISIT_MEMBER(sql); }
+   #endif
+
+   String toString() { return HX_CSTRING("Sqlite Statement"); }
+};
+
+
+statement *database::takeStatement(String sql)
+{
+   for(int i=cache->length-1; i>=0; i--)
+   {
+      statement *s = (statement *)cache[i].mPtr;
+      if (s->sql==sql)
+      {
+         cache->removeAt(i);
+         return s;
+      }
+   }
+
+   int byteLength = 0;
+   const char * sqlStr = sql.utf8_str(0, true, &byteLength);
+   sqlite3_stmt *stmt = 0;
+   const char *tl = 0;
+   if( sqlite3_prepare_v2(db,sqlStr,byteLength,&stmt,&tl) != SQLITE_OK )
+   {
+      hx::Throw( HX_CSTRING("Sqlite error in ") + sql + HX_CSTRING(" : ") +
+                  String(sqlite3_errmsg(db) ) );
+   }
+   if( *tl )
+   {
+      sqlite3_finalize(stmt);
+      hx::Throw(HX_CSTRING("Cannot execute several SQL requests at the same time"));
+   }
+
+   statement *s = new statement();
+   s->create(this, stmt, sql);
+   return s;
+}
+
+void database::returnStatement(statement *inStatement)
+{
+   sqlite3_reset(inStatement->r);
+   sqlite3_clear_bindings(inStatement->r);
+   if (cacheSize<=0)
+   {
+      inStatement->destroy();
+      inStatement->closed = true;
+      return;
+   }
+   cache->push(inStatement->handBack());
+   trimCache(cacheSize);
+}
+
+void database::trimCache(int inSize)
+{
+   int remove = cache->length - inSize;
+   if (remove>0)
+   {
+      for(int i=0;i<remove;i++)
+         ((statement *)cache[i].mPtr)->destroy();
+      cache->removeRange(0,remove);
+   }
+}
+
 static void sqlite_error( sqlite3 *db ) {
    hx::Throw( HX_CSTRING("Sqlite error : ") + String(sqlite3_errmsg(db)) );
 }
@@ -174,6 +462,15 @@ database *getDatabase(Dynamic handle)
 }
 
 
+statement *getStatement(Dynamic handle)
+{
+   statement *s = dynamic_cast<statement *>(handle.mPtr);
+   if (!s || s->closed || !s->r || !s->owner->db)
+      hx::Throw( HX_CSTRING("Invalid sqlite statement") );
+   return s;
+}
+
+
 result *getResult(Dynamic handle, bool inRequireStatement)
 {
    result *r = dynamic_cast<result *>(handle.mPtr);
@@ -259,6 +556,195 @@ Dynamic _hx_sqlite_request(Dynamic handle,String sql)
 }
 
 
+/**
+   prepare : 'db -> sql:string -> 'stmt
+   <doc>Returns a prepared statement for the sql, reusing a cached one if possible.
+   Parameters are numbered from 1, as in sqlite.  Return it with [stmt_close] when done.</doc>
+**/
+Dynamic _hx_sqlite_prepare(Dynamic handle,String sql)
+{
+   database *db = getDatabase(handle);
+   return db->takeStatement(sql);
+}
+
+/**
+   set_statement_cache_size : 'db -> size:int -> void
+   <doc>Sets how many unused prepared statements are kept (default 32).</doc>
+**/
+void _hx_sqlite_set_statement_cache_size(Dynamic handle,int size)
+{
+   database *db = getDatabase(handle);
+   db->cacheSize = size<0 ? 0 : size;
+   db->trimCache(db->cacheSize);
+}
+
+/**
+   stmt_bind_int : 'stmt -> index:int -> value:int -> void
+   <doc>Binds an integer to parameter [index].</doc>
+**/
+void _hx_sqlite_stmt_bind_int(Dynamic handle,int index,int value)
+{
+   statement *s = getStatement(handle);
+   s->checkIndex(index);
+   s->checkError( sqlite3_bind_int(s->r,index,value) );
+}
+
+/**
+   stmt_bind_float : 'stmt -> index:int -> value:float -> void
+   <doc>Binds a float to parameter [index].</doc>
+**/
+void _hx_sqlite_stmt_bind_float(Dynamic handle,int index,Float value)
+{
+   statement *s = getStatement(handle);
+   s->checkIndex(index);
+   s->checkError( sqlite3_bind_double(s->r,index,value) );
+}
+
+/**
+   stmt_bind_string : 'stmt -> index:int -> value:string -> void
+   <doc>Binds utf8 text to parameter [index].  A null string binds NULL.</doc>
+**/
+void _hx_sqlite_stmt_bind_string(Dynamic handle,int index,String value)
+{
+   statement *s = getStatement(handle);
+   s->checkIndex(index);
+   s->bindString(index,value);
+}
+
+/**
+   stmt_bind_bytes : 'stmt -> index:int -> value:bytes -> void
+   <doc>Binds a blob to parameter [index].</doc>
+**/
+void _hx_sqlite_stmt_bind_bytes(Dynamic handle,int index,Array<unsigned char> value)
+{
+   statement *s = getStatement(handle);
+   s->checkIndex(index);
+   s->bindBytes(index,value.mPtr);
+}
+
+/**
+   stmt_bind_null : 'stmt -> index:int -> void
+   <doc>Binds NULL to parameter [index].</doc>
+**/
+void _hx_sqlite_stmt_bind_null(Dynamic handle,int index)
+{
+   statement *s = getStatement(handle);
+   s->checkIndex(index);
+   s->checkError( sqlite3_bind_null(s->r,index) );
+}
+
+/**
+   stmt_clear_bindings : 'stmt -> void
+   <doc>Sets all parameters back to NULL.</doc>
+**/
+void _hx_sqlite_stmt_clear_bindings(Dynamic handle)
+{
+   statement *s = getStatement(handle);
+   sqlite3_clear_bindings(s->r);
+}
+
+/**
+   stmt_reset : 'stmt -> void
+   <doc>Rewinds the statement so it can be stepped again.  Bindings are kept.</doc>
+**/
+void _hx_sqlite_stmt_reset(Dynamic handle)
+{
+   statement *s = getStatement(handle);
+   sqlite3_reset(s->r);
+}
+
+/**
+   stmt_step : 'stmt -> object?
+   <doc>Runs the statement to the next row and returns it, or [null] when done.</doc>
+**/
+Dynamic _hx_sqlite_stmt_step(Dynamic handle)
+{
+   statement *s = getStatement(handle);
+   if (s->step())
+      return readRow(s->r, s->ncols, s->names, s->bools);
+   return null();
+}
+
+/**
+   stmt_changes : 'stmt -> int
+   <doc>Returns the number of rows changed when the statement last completed.</doc>
+**/
+int _hx_sqlite_stmt_changes(Dynamic handle)
+{
+   return getStatement(handle)->changes;
+}
+
+/**
+   stmt_execute_batch : 'stmt -> rows:array -> int
+   <doc>Runs the statement once for each row, where each row is an array of parameter
+   values (null, Int, Float, Bool, String or bytes data).  Unless a transaction is already
+   open, the batch runs in its own transaction.  Returns the total rows changed.</doc>
+**/
+int _hx_sqlite_stmt_execute_batch(Dynamic handle,Array<Dynamic> rows)
+{
+   statement *s = getStatement(handle);
+   sqlite3 *db = s->owner->db;
+
+   bool ownTransaction = sqlite3_get_autocommit(db);
+   if (ownTransaction && sqlite3_exec(db,"BEGIN",0,0,0)!=SQLITE_OK)
+      sqlite_error(db);
+
+   int total = 0;
+   try
+   {
+      for(int row=0; row<rows->length; row++)
+      {
+         sqlite3_reset(s->r);
+         sqlite3_clear_bindings(s->r);
+
+         Dynamic values = rows[row];
+         if (!values.mPtr)
+            hx::Throw( HX_CSTRING("Sqlite: batch row is not an array") );
+         int n = values->__length();
+         for(int p=0; p<n; p++)
+            s->bind(p+1, values->__GetItem(p));
+
+         while(s->step())
+         {
+         }
+         total += s->changes;
+      }
+      sqlite3_reset(s->r);
+   }
+   catch(Dynamic e)
+   {
+      sqlite3_reset(s->r);
+      if (ownTransaction)
+         sqlite3_exec(db,"ROLLBACK",0,0,0);
+      throw;
+   }
+
+   if (ownTransaction && sqlite3_exec(db,"COMMIT",0,0,0)!=SQLITE_OK)
+      sqlite_error(db);
+
+   return total;
+}
+
+/**
+   stmt_close : 'stmt -> void
+   <doc>Returns the statement to the connection cache.  The handle is invalid afterwards,
+   and closing it again does nothing.</doc>
+**/
+void _hx_sqlite_stmt_close(Dynamic handle)
+{
+   statement *s = dynamic_cast<statement *>(handle.mPtr);
+   if (!s || s->closed || !s->r)
+      return;
+   if (s->owner->db)
+      s->owner->returnStatement(s);
+   else
+   {
+      s->destroy();
+      s->closed = true;
+   }
+}
+
+
 
 
 
@@ -299,44 +785,8 @@ Dynamic _hx_sqlite_result_next(Dynamic handle)
    switch( sqlite3_step(r->r) )
    {
       case SQLITE_ROW:
-      {
-         hx::Anon v = hx::Anon_obj::Create();
          r->first = 0;
-         for(int i=0;i<r->ncols;i++)
-         {
-            Dynamic f;
-            switch( sqlite3_column_type(r->r,i) )
-            {
-            case SQLITE_NULL:
-               break;
-            case SQLITE_INTEGER:
-               if( r->bools[i] )
-                  f = bool(sqlite3_column_int(r->r,i));
-               else
-                  f = int(sqlite3_column_int(r->r,i));
-               break;
-            case SQLITE_FLOAT:
-               f = Float(sqlite3_column_double(r->r,i));
-               break;
-            case SQLITE_TEXT:
-               f = String((char*)sqlite3_column_text(r->r,i));
-               break;
-            case SQLITE_BLOB:
-               {
-                  int size = sqlite3_column_bytes(r->r,i);
-                  f = Array_obj<unsigned char>::fromData((const unsigned char *)sqlite3_column_blob(r->r,i),size);
-                  break;
-               }
-            default:
-               {
-                  hx::Throw( HX_CSTRING("Unknown Sqlite type #") +
-                               String((int)sqlite3_column_type(r->r,i)));
-               }
-            }
-            v->__SetField(r->names[i],f,hx::paccDynamic);
-         }
-         return v;
-      }
+         return readRow(r->r, r->ncols, r->names, r->bools);
       case SQLITE_DONE:
          r->destroy(true);
          return null();
@@ -352,6 +802,149 @@ Dynamic _hx_sqlite_result_next(Dynamic handle)
 }
 
 
+// Steps a result or prepared statement, returning the sqlite statement if there is a row
+static sqlite3_stmt *stepRow(Dynamic handle, int &outCols, int *&outBools)
+{
+   statement *s = dynamic_cast<statement *>(handle.mPtr);
+   if (s)
+   {
+      s = getStatement(handle);
+      outCols = s->ncols;
+      outBools = s->bools;
+      return s->step() ? s->r : 0;
+   }
+
+   result *r = getResult(handle,false);
+   if( r->done )
+      return 0;
+   outCols = r->ncols;
+   outBools = r->bools;
+
+   switch( sqlite3_step(r->r) )
+   {
+      case SQLITE_ROW:
+         r->first = 0;
+         return r->r;
+      case SQLITE_DONE:
+         r->destroy(true);
+         return 0;
+      case SQLITE_BUSY:
+         hx::Throw(HX_CSTRING("Database is busy"));
+      case SQLITE_ERROR:
+         sqlite_error(r->db);
+      default:
+         hx::Throw(HX_CSTRING("Unkown sqlite result"));
+   }
+   return 0;
+}
+
+/**
+   result_fetch_row : 'result -> row:array -> bool
+   <doc>Reads the next row into [row], by column position, reusing the array.  Works on
+   results and prepared statements.  Returns false when there are no more rows.</doc>
+**/
+bool _hx_sqlite_result_fetch_row(Dynamic handle,Array<Dynamic> row)
+{
+   int ncols = 0;
+   int *bools = 0;
+   sqlite3_stmt *r = stepRow(handle, ncols, bools);
+   if (!r)
+      return false;
+
+   row->resize(ncols);
+   for(int i=0;i<ncols;i++)
+      row->__unsafe_set(i, readCell(r,i,bools[i]));
+   return true;
+}
+
+namespace { enum ColumnKind { colInt, colFloat, colBool, colString, colDynamic }; }
+
+/**
+   result_fetch_columns : 'result -> columns:array -> max:int -> int
+   <doc>Reads up to [max] rows into one array per column, resizing each to the row count.
+   The arrays set the conversion: Array<Int>, Array<Float> and Array<Bool> read NULL as 0,
+   Array<String> reads text, and Array<Dynamic> takes any value (bytes for blobs).
+   Works on results and prepared statements.  Returns the number of rows read.</doc>
+**/
+int _hx_sqlite_result_fetch_columns(Dynamic handle,Array<Dynamic> columns,int maxRows)
+{
+   int ncols = 0;
+   int *bools = 0;
+   int rows = 0;
+   std::vector<ColumnKind> kinds;
+   std::vector<hx::ArrayBase *> arrays;
+
+   // Keep the storage from the last call
+   for(int c=0;c<columns->length;c++)
+   {
+      hx::ArrayBase *a = dynamic_cast<hx::ArrayBase *>(columns[c].mPtr);
+      if (a)
+         a->resize(0);
+   }
+
+   while(rows<maxRows)
+   {
+      sqlite3_stmt *r = stepRow(handle, ncols, bools);
+      if (!r)
+         break;
+
+      if (rows==0)
+      {
+         if (columns->length<ncols)
+            hx::Throw( HX_CSTRING("Sqlite: need an array for each of the ") + String(ncols) + HX_CSTRING(" columns") );
+         kinds.resize(ncols);
+         arrays.resize(ncols);
+         for(int c=0;c<ncols;c++)
+         {
+            hx::Object *a = columns[c].mPtr;
+            arrays[c] = dynamic_cast<hx::ArrayBase *>(a);
+            if (dynamic_cast< Array_obj<int> * >(a))
+               kinds[c] = colInt;
+            else if (dynamic_cast< Array_obj<Float> * >(a))
+               kinds[c] = colFloat;
+            else if (dynamic_cast< Array_obj<bool> * >(a))
+               kinds[c] = colBool;
+            else if (dynamic_cast< Array_obj<String> * >(a))
+               kinds[c] = colString;
+            else if (dynamic_cast< Array_obj<Dynamic> * >(a))
+               kinds[c] = colDynamic;
+            else
+               hx::Throw( HX_CSTRING("Sqlite: unsupported column array ") + String(c) );
+         }
+      }
+
+      for(int c=0;c<ncols;c++)
+      {
+         hx::ArrayBase *a = arrays[c];
+         a->resize(rows+1);
+         switch(kinds[c])
+         {
+            case colInt:
+               ((Array_obj<int> *)a)->__unsafe_set(rows, sqlite3_column_int(r,c));
+               break;
+            case colFloat:
+               ((Array_obj<Float> *)a)->__unsafe_set(rows, sqlite3_column_double(r,c));
+               break;
+            case colBool:
+               ((Array_obj<bool> *)a)->__unsafe_set(rows, sqlite3_column_int(r,c)!=0);
+               break;
+            case colString:
+               {
+               const char *text = (const char *)sqlite3_column_text(r,c);
+               ((Array_obj<String> *)a)->__unsafe_set(rows, text ? String(text) : String());
+               }
+               break;
+            default:
+               ((Array_obj<Dynamic> *)a)->__unsafe_set(rows, readCell(r,c,bools[c]));
+         }
+      }
+      rows++;
+   }
+
+   return rows;
+}
+
+
 static sqlite3_stmt *prepStatement(Dynamic handle,int n)
 {
    result *r = getResult(handle,true);
@@ -3,6 +3,8 @@
 #include <hx/OS.h>
 
 #include <string.h>
+#include <map>
+#include <vector>
 
 
 #ifdef NEKO_WINDOWS
@@ -48,6 +50,10 @@ typedef int SocketLen;
 #   include <errno.h>
 #   include <stdio.h>
 #   include <poll.h>
+#   if (defined(HX_LINUX) || defined(HX_ANDROID)) && !defined(HXCPP_NO_EPOLL)
+#      include <sys/epoll.h>
+#      define HX_SOCKET_EPOLL
+#   endif
    typedef int SOCKET;
 #   define closesocket close
 #   define SOCKET_ERROR (-1)
@@ -1310,6 +1316,453 @@ Array<Dynamic> _hx_std_socket_poll( Array<Dynamic> socks, Dynamic pdata, double
 
 
 
+/**
+   socket_poller_new : void -> 'poller
+   <doc>
+   Create a persistent poller. Sockets stay registered between waits and only the
+   ready ones are reported, so an idle socket costs nothing per wait.
+   Uses epoll on Linux/Android, and falls back to poll/select elsewhere.
+   </doc>
+**/
+
+namespace
+{
+
+static int pollerType = 0;
+
+enum
+{
+   pollerRead  = 0x01,
+   pollerWrite = 0x02,
+   pollerError = 0x04,
+   pollerEdge  = 0x08,
+};
+
+static void setReady(Array<Dynamic> &outHandles, Array<int> &outEvents, int inIndex, Dynamic inHandle, int inFlags)
+{
+   if (inIndex>=outHandles->length)
+      outHandles->resize(inIndex+1);
+   outHandles->__unsafe_set(inIndex, inHandle);
+   outEvents[inIndex] = inFlags;
+}
+
+#ifdef HX_SOCKET_EPOLL
+static unsigned int toEpoll(int inEvents)
+{
+   unsigned int result = 0;
+   if (inEvents & pollerRead)
+      result |= EPOLLIN | EPOLLRDHUP;
+   if (inEvents & pollerWrite)
+      result |= EPOLLOUT;
+   if (inEvents & pollerEdge)
+      result |= EPOLLET;
+   return result;
+}
+#endif
+
+struct SocketPoller : public hx::Object
+{
+   HX_IS_INSTANCE_OF enum { _hx_ClassId = hx::clsIdSocketPoller };
+
+   enum { MAX_EVENTS = 1024 };
+
+   // The GC never runs destructors, so the containers live in a separately
+   //  allocated struct that destroy() deletes
+   struct Slots
+   {
+      std::map<SOCKET,int> slotOf;
+      std::vector<int> freeSlots;
+      #ifndef HX_SOCKET_EPOLL
+      std::vector<SOCKET> slotSock;
+      std::vector<int> slotEvents;
+      #ifndef NEKO_WINDOWS
+      // Kept packed, with the slot for each entry alongside
+      std::vector<struct pollfd> fds;
+      std::vector<int> fdSlot;
+      std::vector<int> slotPos;
+      #endif
+      #endif
+   };
+
+   bool ok;
+   // Registered handles, indexed by slot
+   Array<Dynamic> handles;
+   Slots *slots;
+
+   #ifdef HX_SOCKET_EPOLL
+   int epfd;
+   struct epoll_event events[MAX_EVENTS];
+   #elif defined(NEKO_WINDOWS)
+   fd_set *fdr;
+   fd_set *fdw;
+   int fdsetMax;
+   #endif
+
+   void create()
+   {
+      ok = true;
+      slots = 0;
+      handles = Array_obj<Dynamic>::__new(0,0);
+      HX_OBJ_WB_GET(this, handles.mPtr);
+      #ifdef HX_SOCKET_EPOLL
+      epfd = epoll_create1(EPOLL_CLOEXEC);
+      if (epfd<0)
+      {
+         ok = false;
+         hx::Throw(HX_CSTRING("Could not create epoll"));
+      }
+      #elif defined(NEKO_WINDOWS)
+      fdr = fdw = 0;
+      fdsetMax = 0;
+      #endif
+      slots = new Slots();
+      _hx_set_finalizer(this, finalize);
+   }
+
+   void destroy()
+   {
+      if (ok)
+      {
+         ok = false;
+         #ifdef HX_SOCKET_EPOLL
+         close(epfd);
+         #elif defined(NEKO_WINDOWS)
+         free(fdr);
+         free(fdw);
+         #endif
+         delete slots;
+         slots = 0;
+      }
+   }
+
+   void checkOk()
+   {
+      if (!ok)
+         hx::Throw(HX_CSTRING("Poller closed"));
+   }
+
+   int findSlot(SOCKET inSock)
+   {
+      std::map<SOCKET,int>::iterator i = slots->slotOf.find(inSock);
+      if (i==slots->slotOf.end())
+         hx::Throw(HX_CSTRING("Socket not registered in poller"));
+      return i->second;
+   }
+
+   void add(Dynamic inHandle, int inEvents)
+   {
+      checkOk();
+      SOCKET sock = val_sock(inHandle);
+      if (slots->slotOf.find(sock)!=slots->slotOf.end())
+         hx::Throw(HX_CSTRING("Socket already registered in poller"));
+
+      int slot;
+      if (slots->freeSlots.size())
+      {
+         slot = slots->freeSlots.back();
+         slots->freeSlots.pop_back();
+         handles->__unsafe_set(slot, inHandle);
+      }
+      else
+      {
+         slot = handles->length;
+         handles->push(inHandle);
+         #ifndef HX_SOCKET_EPOLL
+         slots->slotSock.push_back(sock);
+         slots->slotEvents.push_back(0);
+         #ifndef NEKO_WINDOWS
+         slots->slotPos.push_back(-1);
+         #endif
+         #endif
+      }
+
+      #ifdef HX_SOCKET_EPOLL
+      struct epoll_event ev;
+      ev.events = toEpoll(inEvents);
+      ev.data.u64 = 0;
+      ev.data.u32 = slot;
+      if (epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &ev)<0)
+      {
+         handles[slot] = null();
+         slots->freeSlots.push_back(slot);
+         hx::Throw(HX_CSTRING("Could not add socket to poller"));
+      }
+      #else
+      slots->slotSock[slot] = sock;
+      slots->slotEvents[slot] = inEvents;
+      #ifndef NEKO_WINDOWS
+      struct pollfd fd;
+      fd.fd = sock;
+      fd.events = ((inEvents & pollerRead) ? POLLIN : 0) | ((inEvents & pollerWrite) ? POLLOUT : 0);
+      fd.revents = 0;
+      slots->slotPos[slot] = slots->fds.size();
+      slots->fds.push_back(fd);
+      slots->fdSlot.push_back(slot);
+      #endif
+      #endif
+
+      slots->slotOf[sock] = slot;
+   }
+
+   void modify(Dynamic inHandle, int inEvents)
+   {
+      checkOk();
+      SOCKET sock = val_sock(inHandle);
+      int slot = findSlot(sock);
+
+      #ifdef HX_SOCKET_EPOLL
+      struct epoll_event ev;
+      ev.events = toEpoll(inEvents);
+      ev.data.u64 = 0;
+      ev.data.u32 = slot;
+      if (epoll_ctl(epfd, EPOLL_CTL_MOD, sock, &ev)<0)
+         hx::Throw(HX_CSTRING("Could not modify socket in poller"));
+      #else
+      slots->slotEvents[slot] = inEvents;
+      #ifndef NEKO_WINDOWS
+      slots->fds[ slots->slotPos[slot] ].events = ((inEvents & pollerRead) ? POLLIN : 0) | ((inEvents & pollerWrite) ? POLLOUT : 0);
+      #endif
+      #endif
+   }
+
+   void remove(Dynamic inHandle)
+   {
+      checkOk();
+      SOCKET sock = val_sock(inHandle);
+      int slot = findSlot(sock);
+
+      #ifdef HX_SOCKET_EPOLL
+      // Socket may already have been closed, which removes it implicitly
+      struct epoll_event ev;
+      epoll_ctl(epfd, EPOLL_CTL_DEL, sock, &ev);
+      #elif !defined(NEKO_WINDOWS)
+      int pos = slots->slotPos[slot];
+      int last = slots->fds.size()-1;
+      if (pos!=last)
+      {
+         slots->fds[pos] = slots->fds[last];
+         slots->fdSlot[pos] = slots->fdSlot[last];
+         slots->slotPos[ slots->fdSlot[pos] ] = pos;
+      }
+      slots->fds.pop_back();
+      slots->fdSlot.pop_back();
+      slots->slotPos[slot] = -1;
+      #else
+      slots->slotEvents[slot] = 0;
+      #endif
+
+      slots->slotOf.erase(sock);
+      handles[slot] = null();
+      slots->freeSlots.push_back(slot);
+   }
+
+   int wait(Array<Dynamic> outHandles, Array<int> outEvents, double timeout)
+   {
+      checkOk();
+      int found = 0;
+
+      #ifdef HX_SOCKET_EPOLL
+      int maxEvents = slots->slotOf.size();
+      if (maxEvents<1)
+         maxEvents = 1;
+      else if (maxEvents>MAX_EVENTS)
+         maxEvents = MAX_EVENTS;
+      int ms = timeout<0 ? -1 : (int)(timeout*1000);
+
+      hx::EnterGCFreeZone();
+      POSIX_LABEL(poller_wait_again);
+      int n = epoll_wait(epfd, events, maxEvents, ms);
+      if (n<0)
+      {
+         HANDLE_EINTR(poller_wait_again);
+         hx::ExitGCFreeZone();
+         return 0;
+      }
+      hx::ExitGCFreeZone();
+
+      for(int i=0;i<n;i++)
+      {
+         Dynamic handle = handles[ events[i].data.u32 ];
+         // Removed while we were waiting
+         if (!handle.mPtr)
+            continue;
+         unsigned int e = events[i].events;
+         int flags = 0;
+         if (e & EPOLLIN)
+            flags |= pollerRead;
+         if (e & EPOLLOUT)
+            flags |= pollerWrite;
+         if (e & (EPOLLERR|EPOLLHUP|EPOLLRDHUP))
+            flags |= pollerError;
+         setReady(outHandles, outEvents, found++, handle, flags);
+      }
+
+      #elif defined(NEKO_WINDOWS)
+      int count = handles->length;
+      if (count>fdsetMax)
+      {
+         fdsetMax = count;
+         fdr = (fd_set *)realloc(fdr,FDSIZE(fdsetMax));
+         fdw = (fd_set *)realloc(fdw,FDSIZE(fdsetMax));
+      }
+      fdr->fd_count = 0;
+      fdw->fd_count = 0;
+      for(int i=0;i<count;i++)
+      {
+         if (slots->slotEvents[i] & pollerRead)
+            fdr->fd_array[fdr->fd_count++] = slots->slotSock[i];
+         if (slots->slotEvents[i] & pollerWrite)
+            fdw->fd_array[fdw->fd_count++] = slots->slotSock[i];
+      }
+      if (fdr->fd_count + fdw->fd_count==0)
+         return 0;
+
+      struct timeval t;
+      struct timeval *tt = init_timeval(timeout,&t);
+      hx::EnterGCFreeZone();
+      if( select(0/* Ignored */, fdr->fd_count ? fdr : 0, fdw->fd_count ? fdw : 0,NULL,tt) == SOCKET_ERROR )
+      {
+         hx::ExitGCFreeZone();
+         return 0;
+      }
+      hx::ExitGCFreeZone();
+
+      for(int i=0;i<count;i++)
+      {
+         int flags = 0;
+         if ( (slots->slotEvents[i] & pollerRead) && FD_ISSET(slots->slotSock[i],fdr) )
+            flags |= pollerRead;
+         if ( (slots->slotEvents[i] & pollerWrite) && FD_ISSET(slots->slotSock[i],fdw) )
+            flags |= pollerWrite;
+         if (flags && handles[i].mPtr)
+         {
+            setReady(outHandles, outEvents, found++, handles[i], flags);
+         }
+      }
+
+      #else
+      int tot = slots->fds.size();
+      hx::EnterGCFreeZone();
+      POSIX_LABEL(poller_poll_again);
+      if( poll(tot ? &slots->fds[0] : 0,tot,timeout<0 ? -1 : (int)(timeout * 1000)) < 0 )
+      {
+         HANDLE_EINTR(poller_poll_again);
+         hx::ExitGCFreeZone();
+         return 0;
+      }
+      hx::ExitGCFreeZone();
+
+      for(int i=0;i<tot;i++)
+      {
+         int e = slots->fds[i].revents;
+         if (!e)
+            continue;
+         int flags = 0;
+         if (e & POLLIN)
+            flags |= pollerRead;
+         if (e & POLLOUT)
+            flags |= pollerWrite;
+         if (e & (POLLERR|POLLHUP|POLLNVAL))
+            flags |= pollerError;
+         setReady(outHandles, outEvents, found++, handles[ slots->fdSlot[i] ], flags);
+      }
+      #endif
+
+      outHandles->__SetSize(found);
+      outEvents->__SetSize(found);
+      return found;
+   }
+
+   void __Mark(hx::MarkContext *__inCtx) { HX_MARK_MEMBER(handles); }
+   #ifdef HXCPP_VISIT_ALLOCS
+   void __Visit(hx::VisitContext *__inCtx) { HX_VISIT_MEMBER(handles); }
+   #endif
+
+   int __GetType() const { return pollerType; }
+
+   static void finalize(Dynamic obj)
+   {
+      ((SocketPoller *)(obj.mPtr))->destroy();
+   }
+
+   String toString() { return HX_CSTRING("poller"); }
+};
+
+SocketPoller *val_poller(Dynamic o)
+{
+   if (!o.mPtr || o->__GetType()!=pollerType)
+      hx::Throw(HX_CSTRING("Invalid poller:") + o);
+   return static_cast<SocketPoller *>(o.mPtr);
+}
+
+} // end namespace
+
+
+Dynamic _hx_std_socket_poller_new()
+{
+   if (pollerType==0)
+      pollerType = hxcpp_alloc_kind();
+
+   SocketPoller *p = new SocketPoller;
+   p->create();
+   return p;
+}
+
+/**
+   socket_poller_add : 'poller -> 'socket -> events:int -> void
+   <doc>
+   Register a socket for the given events: 1 = read, 2 = write, and 8 to request
+   edge-triggered notification where supported. The handle passed in is the one
+   returned from [socket_poller_wait].
+   </doc>
+**/
+void _hx_std_socket_poller_add( Dynamic poller, Dynamic sock, int events )
+{
+   val_poller(poller)->add(sock,events);
+}
+
+/**
+   socket_poller_modify : 'poller -> 'socket -> events:int -> void
+   <doc>Change the events a registered socket is waiting for</doc>
+**/
+void _hx_std_socket_poller_modify( Dynamic poller, Dynamic sock, int events )
+{
+   val_poller(poller)->modify(sock,events);
+}
+
+/**
+   socket_poller_remove : 'poller -> 'socket -> void
+   <doc>Unregister a socket. Do this before closing the socket.</doc>
+**/
+void _hx_std_socket_poller_remove( Dynamic poller, Dynamic sock )
+{
+   val_poller(poller)->remove(sock);
+}
+
+/**
+   socket_poller_wait : 'poller -> 'socket array -> int array -> timeout:float -> int
+   <doc>
+   Wait up to timeout seconds (negative for no limit) for registered sockets to become
+   ready. The ready handles and their events (1 = read, 2 = write, 4 = error/hangup)
+   are written to the given arrays, which are resized to the returned count.
+   </doc>
+**/
+int _hx_std_socket_poller_wait( Dynamic poller, Array<Dynamic> outSockets, Array<int> outEvents, double timeout )
+{
+   return val_poller(poller)->wait(outSockets, outEvents, timeout);
+}
+
+/**
+   socket_poller_close : 'poller -> void
+   <doc>Release the poller's resources now, rather than waiting for the GC</doc>
+**/
+void _hx_std_socket_poller_close( Dynamic poller )
+{
+   val_poller(poller)->destroy();
+}
+
+
+
 /**
    socket_send_to : 'socket -> buf:string -> pos:int -> length:int -> addr:{host:'int32,port:int} -> int
    <doc>
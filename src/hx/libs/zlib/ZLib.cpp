@@ -1,7 +1,12 @@
 #include <hxcpp.h>
+#include <hx/Thread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
 #include <zlib.h>
+#ifndef HX_WINDOWS
+#include <unistd.h>
+#endif
 
 /**
    <doc>
@@ -15,6 +20,82 @@
 
 namespace {
 
+// Finished streams are reset and parked here, so the next stream with the same
+//  parameters skips the init and the window allocations.
+struct PooledStream
+{
+   z_stream *z;
+   bool     isInflate;
+   int      level;
+   int      windowBits;
+};
+
+static HxMutex sgPoolMutex;
+static std::vector<PooledStream> sgPool;
+static int sgPoolSize = 8;
+
+static void endStream(z_stream *z, bool inIsInflate)
+{
+   if (inIsInflate)
+      inflateEnd(z);
+   else
+      deflateEnd(z);
+   free(z);
+}
+
+z_stream *acquireStream(bool inIsInflate, int inLevel, int inWindowBits, int &outErr)
+{
+   z_stream *z = 0;
+   {
+      AutoLock lock(sgPoolMutex);
+      for(int i=(int)sgPool.size()-1; i>=0; i--)
+      {
+         PooledStream &p = sgPool[i];
+         if (p.isInflate==inIsInflate && p.windowBits==inWindowBits && (inIsInflate || p.level==inLevel))
+         {
+            z = p.z;
+            sgPool.erase(sgPool.begin()+i);
+            break;
+         }
+      }
+   }
+
+   if (z)
+   {
+      outErr = inIsInflate ? inflateReset(z) : deflateReset(z);
+      if (outErr==Z_OK)
+         return z;
+      endStream(z,inIsInflate);
+   }
+
+   z = (z_stream*)malloc(sizeof(z_stream));
+   memset(z,0,sizeof(z_stream));
+   if (inIsInflate)
+      outErr = inflateInit2(z,inWindowBits);
+   else
+      outErr = deflateInit2(z,inLevel,Z_DEFLATED,inWindowBits,8,Z_DEFAULT_STRATEGY);
+   if (outErr!=Z_OK)
+   {
+      free(z);
+      return 0;
+   }
+   return z;
+}
+
+void releaseStream(z_stream *z, bool inIsInflate, int inLevel, int inWindowBits)
+{
+   {
+      AutoLock lock(sgPoolMutex);
+      if ((int)sgPool.size() < sgPoolSize)
+      {
+         PooledStream p = { z, inIsInflate, inLevel, inWindowBits };
+         sgPool.push_back(p);
+         return;
+      }
+   }
+   endStream(z,inIsInflate);
+}
+
 struct ZipResult
 {
    inline ZipResult(bool inOk, bool inDone, int inRead, int inWrite)
@@ -35,32 +116,19 @@ struct ZStream : public hx::Object
    z_stream *z;
    bool     isInflate;
    int      flush;
+   int      level;
+   int      windowBits;
 
    void create(bool inIsInflate, int inParam)
    {
       isInflate = inIsInflate;
       flush = Z_NO_FLUSH;
-      z = (z_stream*)malloc(sizeof(z_stream));
-      memset(z,0,sizeof(z_stream));
+      level = isInflate ? 0 : inParam;
+      windowBits = isInflate ? inParam : MAX_WBITS;
       int err = 0;
-      if (!isInflate)
-      {
-         if( (err = deflateInit(z,inParam)) != Z_OK )
-         {
-            free(z);
-            z = 0;
-            onError(err);
-         }
-      }
-      else
-      {
-         if( (err = inflateInit2(z,inParam)) != Z_OK )
-         {
-            free(z);
-            z = 0;
-            onError(err);
-         }
-      }
+      z = acquireStream(isInflate, level, windowBits, err);
+      if (!z)
+         onError(err);
 
       _hx_set_finalizer(this, finalize);
    }
@@ -74,11 +142,7 @@ struct ZStream : public hx::Object
    {
       if (z)
       {
-         if (isInflate)
-            inflateEnd(z);
-         else
-            deflateEnd(z);
-         free(z);
+         releaseStream(z, isInflate, level, windowBits);
          z = 0;
       }
    }
@@ -180,6 +244,132 @@ ZStream *GetInflateStream(Dynamic inHandle)
    return z;
 }
 
+
+// Parallel gzip, in the style of pigz: the input is cut into blocks which are
+//  raw-deflated independently, each primed with the 32k preceding it so the ratio
+//  stays close to a serial stream.  Every block but the last ends with a sync flush,
+//  which leaves it byte aligned and not final, so the blocks simply concatenate.
+enum { GZIP_BLOCK_SIZE = 128*1024, GZIP_DICT_SIZE = 32*1024 };
+
+struct GzipBlock
+{
+   const unsigned char *data;
+   int  length;
+   int  dictLength;
+   bool last;
+   int  err;
+   uLong crc;
+   std::vector<unsigned char> out;
+};
+
+struct GzipJob
+{
+   HxMutex     mutex;
+   HxSemaphore done;
+   int         level;
+   int         next;
+   int         running;
+   int         refs;
+   std::vector<GzipBlock> blocks;
+};
+
+static void compressBlock(GzipBlock &block, int inLevel)
+{
+   z_stream *z = acquireStream(false, inLevel, -MAX_WBITS, block.err);
+   if (!z)
+      return;
+
+   if (block.dictLength)
+      deflateSetDictionary(z, block.data - block.dictLength, block.dictLength);
+
+   int flush = block.last ? Z_FINISH : Z_SYNC_FLUSH;
+   z->next_in = (Bytef *)block.data;
+   z->avail_in = block.length;
+   block.out.resize( deflateBound(z,block.length) + 16 );
+   size_t written = 0;
+   while(true)
+   {
+      z->next_out = &block.out[written];
+      z->avail_out = (uInt)(block.out.size() - written);
+      int err = ::deflate(z,flush);
+      written = block.out.size() - z->avail_out;
+      if (err<0 && err!=Z_BUF_ERROR)
+      {
+         block.err = err;
+         break;
+      }
+      if (block.last ? err==Z_STREAM_END : (z->avail_in==0 && z->avail_out>0))
+         break;
+      block.out.resize(block.out.size()*2);
+   }
+   block.out.resize(written);
+   block.crc = crc32(0, block.data, block.length);
+
+   z->next_in = 0;
+   z->next_out = 0;
+   releaseStream(z, false, inLevel, -MAX_WBITS);
+}
+
+static void releaseJob(GzipJob *job)
+{
+   job->mutex.Lock();
+   bool last = --job->refs==0;
+   job->mutex.Unlock();
+   if (last)
+      delete job;
+}
+
+static void runBlocks(GzipJob *job)
+{
+   while(true)
+   {
+      job->mutex.Lock();
+      int idx = job->next < (int)job->blocks.size() ? job->next++ : -1;
+      job->mutex.Unlock();
+      if (idx<0)
+         break;
+      compressBlock(job->blocks[idx], job->level);
+   }
+}
+
+static THREAD_FUNC_TYPE gzipThreadFunc(void *inJob)
+{
+   GzipJob *job = (GzipJob *)inJob;
+   runBlocks(job);
+
+   job->mutex.Lock();
+   bool finished = --job->running==0;
+   job->mutex.Unlock();
+   if (finished)
+      job->done.Set();
+   releaseJob(job);
+   THREAD_FUNC_RET
+}
+
+static int getCpuCount()
+{
+   static int sCpuCount = 0;
+   if (!sCpuCount)
+   {
+      #if defined(HX_WINDOWS) && !defined(HX_WINRT)
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      sCpuCount = (int)info.dwNumberOfProcessors;
+      #elif defined(_SC_NPROCESSORS_ONLN)
+      sCpuCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+      #endif
+      if (sCpuCount<1)
+         sCpuCount = 1;
+   }
+   return sCpuCount;
+}
+
+static void putLong(unsigned char *outBuf, uLong inValue)
+{
+   for(int i=0;i<4;i++)
+      outBuf[i] = (unsigned char)(inValue>>(i*8));
+}
+
 } // end namespace
 
 
@@ -281,4 +471,127 @@ void _hx_inflate_end(Dynamic handle)
 }
 
 
+/**
+   zip_set_pool_size : int -> void
+   <doc>Set how many closed streams are kept for reuse by later streams (default 8, 0 disables)</doc>
+**/
+void _hx_zip_set_pool_size(int inSize)
+{
+   std::vector<PooledStream> trimmed;
+   {
+      AutoLock lock(sgPoolMutex);
+      sgPoolSize = inSize<0 ? 0 : inSize;
+      while((int)sgPool.size() > sgPoolSize)
+      {
+         trimmed.push_back(sgPool[0]);
+         sgPool.erase(sgPool.begin());
+      }
+   }
+   for(int i=0;i<(int)trimmed.size();i++)
+      endStream(trimmed[i].z, trimmed[i].isInflate);
+}
+
+
+/**
+   gzip_compress : src:string -> srcpos:int -> len:int -> level:int -> threads:int -> string
+   <doc>
+   Compress [len] bytes of [src] into a single gzip member.  Input larger than one
+   128k block is split and the blocks are compressed on up to [threads] threads
+   (0 uses one per cpu).
+   </doc>
+**/
+Array<unsigned char> _hx_gzip_compress(Array<unsigned char> src, int srcPos, int length, int level, int threads)
+{
+   if( srcPos < 0 || length < 0 || srcPos + length > src->length )
+      hx::Throw( HX_CSTRING("gzip_compress: invalid range") );
+
+   int blockCount = length==0 ? 1 : (length + GZIP_BLOCK_SIZE - 1)/GZIP_BLOCK_SIZE;
+   if (threads<=0)
+      threads = getCpuCount();
+   if (threads>blockCount)
+      threads = blockCount;
+
+   const unsigned char *data = length ? &src[srcPos] : 0;
+   GzipJob *job = new GzipJob();
+   job->level = level;
+   job->next = 0;
+   job->blocks.resize(blockCount);
+   for(int b=0;b<blockCount;b++)
+   {
+      GzipBlock &block = job->blocks[b];
+      int offset = b*GZIP_BLOCK_SIZE;
+      block.data = data + offset;
+      block.length = b==blockCount-1 ? length-offset : GZIP_BLOCK_SIZE;
+      block.dictLength = offset<GZIP_DICT_SIZE ? offset : GZIP_DICT_SIZE;
+      block.last = b==blockCount-1;
+      block.err = Z_OK;
+      block.crc = 0;
+   }
+
+   hx::EnterGCFreeZone();
+   job->running = 0;
+   job->refs = 1;
+   for(int t=1;t<threads;t++)
+   {
+      job->mutex.Lock();
+      job->running++;
+      job->refs++;
+      job->mutex.Unlock();
+      if (!HxCreateDetachedThread(gzipThreadFunc, job))
+      {
+         job->mutex.Lock();
+         job->running--;
+         job->refs--;
+         job->mutex.Unlock();
+         break;
+      }
+   }
+   runBlocks(job);
+
+   job->mutex.Lock();
+   bool wait = job->running>0;
+   job->mutex.Unlock();
+   if (wait)
+      job->done.Wait();
+   hx::ExitGCFreeZone();
+
+   int err = Z_OK;
+   int total = 10 + 8;
+   uLong crc = crc32(0,0,0);
+   for(int b=0;b<blockCount;b++)
+   {
+      GzipBlock &block = job->blocks[b];
+      if (block.err!=Z_OK && err==Z_OK)
+         err = block.err;
+      total += (int)block.out.size();
+      crc = crc32_combine(crc, block.crc, block.length);
+   }
+   if (err!=Z_OK)
+   {
+      releaseJob(job);
+      hx::Throw( HX_CSTRING("ZLib Error : ") + String(err) );
+   }
+
+   Array<unsigned char> result = Array_obj<unsigned char>::__new(total,total);
+   unsigned char *out = &result[0];
+   // Header: magic, deflate, no flags, no mtime, xfl, unknown os
+   static const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0,0,0,0, 0, 0xff };
+   memcpy(out, header, 10);
+   out[8] = level==9 ? 2 : level==1 ? 4 : 0;
+   out += 10;
+   for(int b=0;b<blockCount;b++)
+   {
+      GzipBlock &block = job->blocks[b];
+      if (block.out.size())
+         memcpy(out, &block.out[0], block.out.size());
+      out += block.out.size();
+   }
+   putLong(out, crc);
+   putLong(out+4, (uLong)length);
+   releaseJob(job);
+
+   return result;
+}
+
+
 
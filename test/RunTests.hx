@@ -40,6 +40,22 @@ class RunTests
       setDir("haxe");
       command("haxe", ["compile.hxml", "-debug", "-D", m64Def].concat(cppAst) );
       command("bin" + sep + "TestMain-debug",[]);
+
+      // Same tests, with the maps on the open-addressing backend
+      command("haxe", ["compile-flathash.hxml", "-debug", "-D", m64Def].concat(cppAst) );
+      command("bin-flathash" + sep + "TestMain-debug",[]);
+
+      // Same tests without the string hash slots, for the uncached lookup numbers
+      command("haxe", ["compile-nohashcache.hxml", "-debug", "-D", m64Def].concat(cppAst) );
+      command("bin-nohashcache" + sep + "TestMain-debug",[]);
+
+      // Same tests, marking in the background with the concurrent collector
+      command("haxe", ["compile-concurrent.hxml", "-debug", "-D", m64Def].concat(cppAst) );
+      command("bin-concurrent" + sep + "TestMain-debug",[]);
+
+      // Scriptable builds read and write host class members through the field cache
+      command("haxe", ["compile-scriptable.hxml", "-debug", "-D", m64Def].concat(cppAst) );
+      command("bin-scriptable" + sep + "TestMain-debug",[]);
    }
 
    public static function runTelemetry()
@@ -81,6 +97,22 @@ class RunTests
       command("haxe", ["compile-client.hxml"] );
       command("bin" + sep + "CppiaHost",[ "bin" + sep + "client.cppia" ]);
       command("bin" + sep + "CppiaHost",[ "bin" + sep + "client.cppia", "-jit" ]);
+      command("bin" + sep + "CppiaHost",[ "bin" + sep + "client.cppia", "-jit", "-tiered" ]);
+
+      // First run writes the tier-up profile, second run compiles from it
+      var cacheDir = baseDir + "/cppia/bin/jitcache";
+      if (sys.FileSystem.exists(cacheDir))
+         for(file in sys.FileSystem.readDirectory(cacheDir))
+            sys.FileSystem.deleteFile(cacheDir + "/" + file);
+      else
+         sys.FileSystem.createDirectory(cacheDir);
+      Sys.putEnv("HXCPP_CPPIA_JIT_CACHE", cacheDir);
+      command("bin" + sep + "CppiaHost",[ "bin" + sep + "client.cppia", "-jit", "-tiered" ]);
+      var profiles = sys.FileSystem.readDirectory(cacheDir).filter( f -> StringTools.endsWith(f,".jit") );
+      if (profiles.length!=1)
+         throw "expected one jit profile, found " + profiles;
+      command("bin" + sep + "CppiaHost",[ "bin" + sep + "client.cppia", "-jit", "-tiered" ]);
+      Sys.putEnv("HXCPP_CPPIA_JIT_CACHE", "");
    }
 
    public static function native()
@@ -22,6 +22,7 @@ class HostOne implements pack.HostInterface
    }
 }
 
+@:cppFileCode('#include <hx/Scriptable.h>')
 class CppiaHost
 {
 
@@ -31,6 +32,10 @@ class CppiaHost
 
       Common.callback = () -> Common.callbackSet = 1;
 
+      // Interpret functions until they have been called a couple of times, then compile them
+      if (Sys.args().indexOf("-tiered")>=0)
+         untyped __cpp__("::hx::SetJitThreshold(2)");
+
       /*
       if (new HostExtends().getYou().extendOnly != 1)
       {
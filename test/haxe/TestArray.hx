@@ -0,0 +1,150 @@
+import utest.Test;
+import utest.Assert;
+
+class TestArray extends Test
+{
+   public function testQueue()
+   {
+      var queue = new Array<Int>();
+      var head = 0;
+      var tail = 0;
+      for(i in 0...200000)
+      {
+         queue.push(tail++);
+         if (i%3!=0)
+            Assert.equals(head++, queue.shift());
+      }
+      Assert.equals(tail-head, queue.length);
+      Assert.equals(head, queue[0]);
+      Assert.equals(tail-1, queue[queue.length-1]);
+      while(queue.length>0)
+         Assert.equals(head++, queue.shift());
+      Assert.isNull(queue.shift());
+   }
+
+   public function testUnshift()
+   {
+      var a = new Array<String>();
+      for(i in 0...10000)
+         a.unshift("v" + i);
+      Assert.equals(10000, a.length);
+      Assert.equals("v9999", a[0]);
+      Assert.equals("v0", a[9999]);
+
+      // Mix front and back operations on an array with room at the front
+      Assert.equals("v9999", a.shift());
+      a.insert(0, "first");
+      a.push("last");
+      Assert.equals("first", a[0]);
+      Assert.equals("v9998", a[1]);
+      Assert.equals("last", a.pop());
+      Assert.equals("v0", a.pop());
+      Assert.equals(9999, a.length);
+      a.splice(0,2);
+      Assert.equals("v9997", a[0]);
+      Assert.equals(["v2","v1"].join(","), a.slice(-2).join(","));
+   }
+
+   public function testShiftedObjects()
+   {
+      var a = [ for(i in 0...1000) { id:i } ];
+      for(i in 0...500)
+         a.shift();
+      for(i in 0...250)
+         a.unshift({ id:-i });
+      cpp.vm.Gc.run(true);
+      Assert.equals(750, a.length);
+      Assert.equals(-249, a[0].id);
+      Assert.equals(500, a[250].id);
+      Assert.equals(999, a[749].id);
+   }
+
+   public function testShiftedBlit()
+   {
+      var a = [ for(i in 0...100) i ];
+      var b = [ for(i in 0...100) i ];
+      for(i in 0...10)
+         a.shift();
+      b.splice(0,10);
+      Assert.equals(0, cpp.NativeArray.memcmp(a,b));
+
+      var dest = [ for(i in 0...20) -1 ];
+      dest.shift();
+      cpp.NativeArray.blit(dest, 0, a, 0, 10);
+      Assert.equals(10, dest[0]);
+      Assert.equals(19, dest[9]);
+      Assert.equals(-1, dest[10]);
+      Assert.equals(19, dest.length);
+   }
+
+   static function compareInt(a:Int, b:Int) return a<b ? -1 : a>b ? 1 : 0;
+
+   static function compareTens(a:Int, b:Int) return Std.int(a/10) - Std.int(b/10);
+
+   public function testRadixSort()
+   {
+      var ints = [ for(i in 0...5000) Std.random(2000000) - 1000000 ];
+      var expect = ints.copy();
+      expect.sort(compareInt);
+      untyped __global__._hx_array_sort_ascending(ints);
+      Assert.equals(expect.join(","), ints.join(","));
+
+      untyped __global__._hx_array_sort_descending(ints);
+      expect.reverse();
+      Assert.equals(expect.join(","), ints.join(","));
+
+      var floats = [ for(i in 0...5000) (Math.random()-0.5) * Math.pow(10, Std.random(20)-10) ];
+      floats.push(0.0);
+      floats.push(-0.0);
+      floats.push(Math.NEGATIVE_INFINITY);
+      floats.push(Math.POSITIVE_INFINITY);
+      var fexpect = floats.copy();
+      fexpect.sort(Reflect.compare);
+      untyped __global__._hx_array_sort_ascending(floats);
+      Assert.equals(Math.NEGATIVE_INFINITY, floats[0]);
+      Assert.equals(Math.POSITIVE_INFINITY, floats[floats.length-1]);
+      for(i in 0...floats.length)
+         Assert.isTrue(floats[i]==fexpect[i]);
+   }
+
+   public function testParallelNativeSort()
+   {
+      var values = [ for(i in 0...200000) Std.random(100000) ];
+      var expect = values.copy();
+      haxe.ds.ArraySort.sort(expect, compareTens);
+      untyped __global__._hx_array_sort_native(values, cpp.Function.fromStaticFunction(compareTens));
+      // The native sort is stable, so equal keys keep their original order
+      Assert.equals(expect.join(","), values.join(","));
+   }
+
+   static var comparesBeforeThrow = -1;
+
+   static function compareTensOrThrow(a:Int, b:Int)
+   {
+      if (comparesBeforeThrow>=0 && --comparesBeforeThrow<0)
+         throw "compare failed";
+      return compareTens(a,b);
+   }
+
+   public function testParallelNativeSortThrows()
+   {
+      var values = [ for(i in 0...200000) Std.random(100000) ];
+      var before = values.copy();
+      comparesBeforeThrow = 100000;
+      Assert.raises( () -> untyped __global__._hx_array_sort_native(values, cpp.Function.fromStaticFunction(compareTensOrThrow)) );
+      comparesBeforeThrow = -1;
+      // The sort works on a copy, so a failed sort leaves the array alone
+      Assert.equals(before.join(","), values.join(","));
+   }
+
+   static function compareFirstChar(a:String, b:String) return a.charCodeAt(0) - b.charCodeAt(0);
+
+   public function testNativeSortStrings()
+   {
+      var values = [ for(i in 0...1000) String.fromCharCode(97 + Std.random(5)) + i ];
+      var expect = values.copy();
+      haxe.ds.ArraySort.sort(expect, compareFirstChar);
+      untyped __global__._hx_array_sort_native(values, cpp.Function.fromStaticFunction(compareFirstChar));
+      Assert.equals(expect.join(","), values.join(","));
+   }
+}
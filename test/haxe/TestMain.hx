@@ -19,6 +19,7 @@ class TestMain #if nme extends nme.display.Sprite #end {
       runner.addCase(new TestTypes());
       runner.addCase(new TestKeywords());
       runner.addCase(new TestSort());
+      runner.addCase(new TestArray());
       runner.addCase(new TestGC());
       #if !nme
       runner.addCase(new gc.TestGCThreaded());
@@ -33,6 +34,7 @@ class TestMain #if nme extends nme.display.Sprite #end {
       
       #if cpp
       runner.addCase(new native.TestFinalizer());
+      runner.addCase(new native.TestFieldCache());
       #end
 
       final report = Report.create(runner);
@@ -75,6 +77,7 @@ class TestMain #if nme extends nme.display.Sprite #end {
          new TestTypes(),
          new TestKeywords(),
          new TestSort(),
+         new TestArray(),
          new TestGC(),
          new gc.TestGCThreaded(),
          new TestIntHash(),
@@ -82,7 +85,8 @@ class TestMain #if nme extends nme.display.Sprite #end {
          new TestObjectHash(),
          new TestWeakHash(),
          new file.TestFile(),
-         new native.TestFinalizer()
+         new native.TestFinalizer(),
+         new native.TestFieldCache()
       ]);
    }
    #end
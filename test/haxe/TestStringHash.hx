@@ -80,4 +80,80 @@ class TestStringHash extends Test
       Assert.pass();
    }
 
+   public function testRuntimeKeys()
+   {
+      // Hashes cached on runtime strings must match the ones baked into constants
+      var h = new Map<String,Int>();
+      h.set("key1", 1);
+      h.set("k\u00e9y2", 2);
+      var one = 1;
+      Assert.equals(1, h.get("key" + one));
+      Assert.equals(1, h.get("key" + one));
+      Assert.equals(2, h.get("k\u00e9y" + (one+1)));
+      Assert.equals(2, h.get("k\u00e9y" + (one+1)));
+
+      // Long enough for a slot, which is only used once a collection has seen the block
+      var prefix = StringTools.lpad("", "x", 64);
+      var long = prefix + one;
+      h.set(long, 3);
+      cpp.vm.Gc.run(true);
+      Assert.equals(3, h.get(long));
+      Assert.equals(3, h.get(long));
+      Assert.equals(3, h.get(prefix + "1"));
+
+      Assert.isFalse(isHashCached("key" + one));
+      #if HXCPP_NO_STRING_HASH_CACHE
+      Assert.isFalse(isHashCached(long));
+      #else
+      Assert.isTrue(isHashCached(long));
+      #end
+   }
+
+   static function isHashCached(s:String):Bool
+   {
+      return untyped __global__.__hxcpp_string_hash_is_cached(s);
+   }
+
+   public function testLookupThroughput()
+   {
+      // Keys long enough to get a hash slot
+      var prefix = "some.much.longer.field.name.that.is.long.enough.for.a.hash.slot.";
+      var keys = new Array<String>();
+      var h = new Map<String,Int>();
+      for(i in 0...10000)
+      {
+         var key = prefix + i;
+         keys.push(key);
+         h.set(key,i);
+      }
+      // Slots are filled on the first lookup after the keys have survived a collection
+      cpp.vm.Gc.run(true);
+      var cached = 0;
+      for(key in keys)
+      {
+         h.get(key);
+         if (isHashCached(key))
+            cached++;
+      }
+      #if HXCPP_NO_STRING_HASH_CACHE
+      Assert.equals(0, cached);
+      #else
+      Assert.equals(keys.length, cached);
+      #end
+
+      var t0 = haxe.Timer.stamp();
+      var found = 0;
+      for(pass in 0...100)
+         for(i in 0...keys.length)
+            if (h.get(keys[i])==i)
+               found++;
+      var t = haxe.Timer.stamp() - t0;
+      #if HXCPP_NO_STRING_HASH_CACHE
+      trace(" String map lookups/s, uncached hashes : " + Std.int(found/t) );
+      #else
+      trace(" String map lookups/s, cached hashes : " + Std.int(found/t) );
+      #end
+      Assert.equals(100*keys.length, found);
+   }
+
 }
@@ -80,4 +80,28 @@ class TestWeakHash extends Test
       Assert.pass();
    }
 
+   public function testRemoveAndReuse()
+   {
+      var keys = [ for(i in 0...2000) new WeakObjectData(i) ];
+      var map = new WeakMap<WeakObjectData,Int>();
+      for(round in 0...4)
+      {
+         for(k in keys)
+            map.set(k, k.id + round);
+         for(i in 0...keys.length)
+            if ((i%3)==(round%3))
+               Assert.isTrue(map.remove(keys[i]));
+         cpp.vm.Gc.run(true);
+         for(i in 0...keys.length)
+         {
+            var expect:Null<Int> = (i%3)==(round%3) ? null : keys[i].id + round;
+            if (map.get(keys[i])!=expect)
+            {
+               Assert.fail("Bad weak value for " + i + " in round " + round);
+               return;
+            }
+         }
+      }
+      Assert.pass();
+   }
 }
@@ -128,5 +128,75 @@ class TestGC extends Test {
 		for(string in strings)
 			Assert.isFalse( untyped __global__.__hxcpp_is_const_string(string) );
    }
+
+	public function testNurserySurvivors():Void {
+		// Small nursery so the old list gets young children between minor collections
+		var nurserySize:Int = untyped __global__.__hxcpp_get_nursery_size();
+		untyped __global__.__hxcpp_set_nursery_size(256*1024);
+		var survivors = new Array<Dynamic>();
+		for(i in 0...200000)
+		{
+			var garbage = { value:i, name:"item" + i };
+			if ( (i%1000)==0 )
+				survivors.push(garbage);
+		}
+		Gc.run(false);
+		untyped __global__.__hxcpp_set_nursery_size(nurserySize);
+
+		Assert.equals(200, survivors.length);
+		for(s in 0...survivors.length)
+		{
+			Assert.equals(s*1000, survivors[s].value);
+			Assert.equals("item" + (s*1000), survivors[s].name);
+		}
+	}
+
+	public function testGcEvents():Void {
+		untyped __global__.__hxcpp_gc_enable_events(true);
+		var records = new Array<Float>();
+		var since:Int = untyped __global__.__hxcpp_gc_get_events(0, records);
+		records = [];
+		Gc.run(true);
+		Gc.run(false);
+		var latest:Int = untyped __global__.__hxcpp_gc_get_events(since, records);
+		untyped __global__.__hxcpp_gc_enable_events(false);
+
+		Assert.equals(since+2, latest);
+		Assert.equals(2*11, records.length);
+		Assert.equals(since+1, records[0]);
+		Assert.equals(1, records[1]);
+		// end >= start, and phases fit inside the pause
+		Assert.isTrue(records[3]>=records[2]);
+		Assert.isTrue(records[4]+records[5]+records[6]+records[7] <= records[3]-records[2]);
+		Assert.isTrue(records[10]>=1);
+
+		var p50:Float = untyped __global__.__hxcpp_gc_pause_percentile(50);
+		var max:Float = untyped __global__.__hxcpp_gc_pause_percentile(100);
+		Assert.isTrue(untyped __global__.__hxcpp_gc_pause_count()>=2);
+		Assert.isTrue(p50>0 && p50<=max);
+	}
+
+	public function testGcThreadCounts():Void {
+		var kept = new Array<Array<Int>>();
+		for(threads in [1, 3, 0])
+		{
+			untyped __global__.__hxcpp_set_gc_threads(threads);
+			for(i in 0...50000)
+			{
+				var a = [i, i+1, i+2];
+				if ( (i%100)==0 )
+					kept.push(a);
+			}
+			Gc.run(true);
+		}
+		untyped __global__.__hxcpp_set_gc_threads(0);
+
+		Assert.equals(1500, kept.length);
+		for(k in 0...kept.length)
+		{
+			var i = (k%500)*100;
+			Assert.equals(i+2, kept[k][2]);
+		}
+	}
    #end
 }
@@ -0,0 +1,110 @@
+package native;
+
+import utest.Test;
+import utest.Assert;
+
+class FieldCacheHolder
+{
+   public var x:Dynamic;
+   public var y:Int;
+   public var list:Array<Int>;
+
+   public function new(inX:Int)
+   {
+      x = inX;
+      y = -inX;
+      list = [];
+   }
+}
+
+class TestFieldCache extends Test
+{
+   #if !cppia
+   static function getX(o:Dynamic):Dynamic
+   {
+      untyped __cpp__("HX_FIELD_CACHE(_hx_cache_get_x)");
+      return untyped __cpp__("HX_FIELD_CACHE_GET(_hx_cache_get_x, {0}, HX_CSTRING(\"x\"), ::hx::paccDynamic)", o);
+   }
+
+   static function setX(o:Dynamic, value:Dynamic):Void
+   {
+      untyped __cpp__("HX_FIELD_CACHE(_hx_cache_set_x)");
+      untyped __cpp__("HX_FIELD_CACHE_SET(_hx_cache_set_x, {0}, HX_CSTRING(\"x\"), {1}, ::hx::paccDynamic)", o, value);
+   }
+
+   public function testShapes()
+   {
+      var mapped:Dynamic = {};
+      Reflect.setField(mapped, "x", 4);
+      var objects:Array<Dynamic> = [
+         { x:1, y:2 },
+         { y:3, x:2 },
+         { a:0, b:0, c:0, d:0, e:0, f:0, x:3 },
+         mapped,
+         { y:1 },
+         new FieldCacheHolder(5),
+      ];
+      for(pass in 0...3)
+         for(o in objects)
+            Assert.equals(Reflect.field(o,"x"), getX(o));
+
+      var removed:Dynamic = { x:1, y:2 };
+      Assert.equals(1, getX(removed));
+      Reflect.deleteField(removed, "x");
+      Assert.isNull(getX(removed));
+   }
+
+   public function testSet()
+   {
+      var objects:Array<Dynamic> = [
+         { x:1, y:2 },
+         { y:3, x:2 },
+         new FieldCacheHolder(0),
+         {},
+      ];
+      for(pass in 0...2)
+         for(i in 0...objects.length)
+         {
+            setX(objects[i], "value" + i + pass);
+            Assert.equals("value" + i + pass, Reflect.field(objects[i],"x"));
+            Assert.equals("value" + i + pass, getX(objects[i]));
+         }
+      Assert.equals(2, objects[1].y);
+      Assert.equals(0, objects[2].y);
+   }
+
+   static function setY(o:Dynamic, value:Dynamic):Void
+   {
+      untyped __cpp__("HX_FIELD_CACHE(_hx_cache_set_y)");
+      untyped __cpp__("HX_FIELD_CACHE_SET(_hx_cache_set_y, {0}, HX_CSTRING(\"y\"), {1}, ::hx::paccDynamic)", o, value);
+   }
+
+   static function setList(o:Dynamic, value:Dynamic):Void
+   {
+      untyped __cpp__("HX_FIELD_CACHE(_hx_cache_set_list)");
+      untyped __cpp__("HX_FIELD_CACHE_SET(_hx_cache_set_list, {0}, HX_CSTRING(\"list\"), {1}, ::hx::paccDynamic)", o, value);
+   }
+
+   public function testSetTyped()
+   {
+      var holder = new FieldCacheHolder(0);
+      for(pass in 0...2)
+      {
+         setY(holder, 7 + pass);
+         Assert.equals(7 + pass, holder.y);
+
+         // The value has to be converted to the declared Array<Int> storage
+         var values:Array<Dynamic> = [1, 2, 3 + pass];
+         setList(holder, values);
+         var list:Array<Int> = holder.list;
+         Assert.equals(3, list.length);
+         Assert.equals(3 + pass, list[2]);
+      }
+   }
+
+   public function testNull()
+   {
+      Assert.raises(() -> getX(null));
+   }
+   #end
+}
@@ -38,6 +38,22 @@ extern class SslTest
    extern public static function socket_init():Void;
 }
 
+extern class SocketPoller
+{
+   @:native("_hx_std_socket_poller_new")
+   extern public static function create():Dynamic;
+   @:native("_hx_std_socket_poller_add")
+   extern public static function add(poller:Dynamic, socket:Dynamic, events:Int):Void;
+   @:native("_hx_std_socket_poller_modify")
+   extern public static function modify(poller:Dynamic, socket:Dynamic, events:Int):Void;
+   @:native("_hx_std_socket_poller_remove")
+   extern public static function remove(poller:Dynamic, socket:Dynamic):Void;
+   @:native("_hx_std_socket_poller_wait")
+   extern public static function wait(poller:Dynamic, sockets:Array<Dynamic>, events:Array<Int>, timeout:Float):Int;
+   @:native("_hx_std_socket_poller_close")
+   extern public static function close(poller:Dynamic):Void;
+}
+
 class Test extends utest.Test
 {
    var x:Int;
@@ -152,6 +168,37 @@ class Test extends utest.Test
       var decompressed = Uncompress.run(compressed);
       v("decompressed size:" + decompressed.length + "/" + bytes.length);
       Assert.equals(0, decompressed.compare(bytes), "Compress/Uncompress mismatch");
+
+      v("reuse pooled stream...");
+      final again = Compress.run(bytes,9);
+      Assert.equals(0, again.compare(compressed), "Pooled stream output differs");
+   }
+
+   function testGzipParallel()
+   {
+      log("Test parallel gzip");
+      final text = thisFile();
+      final bytes = Bytes.alloc(1000000);
+      for(i in 0...bytes.length)
+         bytes.set(i, text.get(i % text.length));
+
+      for(threads in [1,4])
+      {
+         final data:BytesData = untyped __global__._hx_gzip_compress(bytes.getData(),0,bytes.length,6,threads);
+         final gz = Bytes.ofData(data);
+         Assert.equals(0x1f, gz.get(0));
+         Assert.equals(0x8b, gz.get(1));
+         v("gzip " + threads + " threads: " + gz.length);
+
+         final uncompress = new Uncompress(31);
+         final buffer = Bytes.alloc(bytes.length + 1);
+         final r = uncompress.execute(gz,0,buffer,0);
+         uncompress.close();
+         Assert.isTrue(r.done, "gzip stream not finished");
+         Assert.equals(gz.length, r.read);
+         Assert.equals(bytes.length, r.write);
+         Assert.equals(0, buffer.sub(0,r.write).compare(bytes), "gzip round trip mismatch");
+      }
    }
 
 
@@ -198,6 +245,164 @@ class Test extends utest.Test
       }
    }
 
+   function testRegexpCache()
+   {
+      log("Test Regexp cache");
+
+      var count = 0;
+      for(i in 0...1000)
+         if (new EReg("^line (\\d+):", "i").match("LINE " + i + ": text"))
+            count++;
+      Assert.equals(1000, count);
+
+      // The shared pattern still keeps its own match state
+      var a = new EReg("(\\w+)@", "");
+      var b = new EReg("(\\w+)@", "");
+      Assert.isTrue(a.match("first@x"));
+      Assert.isTrue(b.match("second@y"));
+      Assert.equals("first", a.matched(1));
+      Assert.equals("second", b.matched(1));
+
+      // Errors are not cached
+      for(i in 0...2)
+      {
+         var failed = false;
+         try { new EReg("(unclosed", ""); } catch(e:Dynamic) { failed = true; }
+         Assert.isTrue(failed, "bad pattern should throw");
+      }
+
+      // Too deep for the jit stack, so this falls back to the interpreter
+      var deep = StringTools.lpad("", "a", 200000);
+      Assert.isFalse(~/(a|b)*c/.match(deep));
+      Assert.isTrue(~/(a|b)*c/.match(deep + "c"));
+
+      untyped __global__._hx_regexp_set_cache_size(0);
+      Assert.isTrue(new EReg("^line (\\d+):", "i").match("line 1:"));
+      untyped __global__._hx_regexp_set_cache_size(64);
+   }
+
+   function testRegexpWholeString()
+   {
+      log("Test Regexp match_all/replace/split");
+
+      var offsets = new Array<Int>();
+      var r = new EReg("(\\w)(\\d)?", "");
+      Assert.equals(3, untyped __global__._hx_regexp_match_all(r, "a1 b c2", 0, 7, offsets));
+      Assert.equals("0,2,0,1,1,2,3,4,3,4,-1,-1,5,7,5,6,6,7", offsets.join(","));
+      Assert.equals(0, untyped __global__._hx_regexp_match_all(r, "!!", 0, 2, offsets));
+      Assert.equals(0, offsets.length);
+
+      var replace = function(pattern:String, s:String, by:String, global:Bool) : String
+         return untyped __global__._hx_regexp_replace(new EReg(pattern,""), s, by, global);
+      Assert.equals("-a-b-c-", replace("x*", "abc", "-", true));
+      Assert.equals("here at me there at you", replace("(\\w+)@(\\w+)", "me@here you@there", "$2 at $1", true));
+      Assert.equals("f$0$3$$0$3$ b$0$3$$0$3$", replace("o", "foo boo", "$$0$3$", true));
+      Assert.equals("aXcb", replace("b", "abcb", "X", false));
+      Assert.equals("cafe e", replace("é", "café é", "e", true));
+      Assert.equals("x€y€", replace("-", "x-y-", "€", true));
+
+      var split = function(pattern:String, s:String, global:Bool) : String
+         return (untyped __global__._hx_regexp_split(new EReg(pattern,""), s, global):Array<String>).join("|");
+      Assert.equals("|a|b|", split("\\s+", " a  b ", true));
+      Assert.equals("a|b c", split(" ", "a b c", false));
+      Assert.equals("né|ö", split(",", "né,ö", true));
+   }
+
+   function testUtf8Transcoding()
+   {
+      log("Test utf8 transcoding");
+
+      // Multibyte sequences either side of the 16 and 32 byte vector boundaries
+      for(offset in [0, 1, 14, 15, 16, 17, 30, 31, 32, 33])
+      {
+         final prefix = StringTools.lpad("", "a", offset);
+         for(seq in ["é", "κό", "€", "😀", "é😀x"])
+         {
+            final s = prefix + seq + " tail";
+            final bytes = Bytes.ofString(s);
+            Assert.equals(offset + Bytes.ofString(seq).length + 5, bytes.length);
+            Assert.equals(s, bytes.getString(0,bytes.length), "Bad utf8 round trip at " + offset);
+         }
+
+         // Invalid and truncated input decodes the same wherever it starts
+         for(tail in [ [0xc3], [0xe2,0x82], [0xf0,0x9f,0x98], [0x80,0x41], [0xe2,0x41,0x42,0x43] ])
+         {
+            final alone = Bytes.alloc(tail.length);
+            final bytes = Bytes.alloc(offset + tail.length);
+            bytes.fill(0, offset, "a".code);
+            for(i in 0...tail.length)
+            {
+               alone.set(i, tail[i]);
+               bytes.set(offset+i, tail[i]);
+            }
+            Assert.equals(prefix + alone.getString(0,alone.length), bytes.getString(0,bytes.length), "Bad invalid utf8 at " + offset);
+         }
+      }
+
+      final buf = new StringBuf();
+      for(i in 0...4096)
+         buf.add(i%16==0 ? "Grüße, κόσμε 😀 " : "plain ascii text, ");
+      final str = buf.toString();
+      final utf8 = Bytes.ofString(str);
+      final data = utf8.getData();
+      Assert.equals(str, utf8.getString(0,utf8.length), "Bad utf8 round trip");
+
+      // Time the conversions alone, into buffers that are reused between passes
+      final passes = 200;
+      untyped __cpp__("hx::strbuf utf8Buffer");
+      untyped __cpp__("hx::strbuf utf16Buffer");
+      var t0 = Sys.time();
+      for(i in 0...passes)
+         untyped __cpp__("{0}.utf8_str(&utf8Buffer)", str);
+      final toUtf8 = Sys.time() - t0;
+      t0 = Sys.time();
+      for(i in 0...passes)
+         untyped __cpp__("_hx_utf8_to_utf16_buffer((const unsigned char *){0}->GetBase(), {1}, &utf16Buffer)", data, utf8.length);
+      final toUtf16 = Sys.time() - t0;
+
+      final gb = utf8.length * passes / 1e9;
+      if (toUtf8>0 && toUtf16>0)
+         v("utf16->utf8 " + Std.int(gb/toUtf8*100)/100 + "GB/s, utf8->utf16 " + Std.int(gb/toUtf16*100)/100 + "GB/s");
+   }
+
+   function testStringAppend()
+   {
+      log("Test string append");
+
+      final t0 = Sys.time();
+      var s = "";
+      for(i in 0...200000)
+         s += "<li>" + i + "</li>";
+      final t = Sys.time() - t0;
+      Assert.equals("<li>0</li><li>1</li>", s.substr(0,20));
+      Assert.isTrue(StringTools.endsWith(s, "<li>199999</li>"));
+      if (t>0)
+         v("string append " + Std.int(s.length/t/1000000) + "MB/s");
+
+      // Appending leaves the operands intact and null-terminated
+      var a = StringTools.lpad("", "a", 100);
+      var b = a + "X";
+      var c = b + "Y";
+      var d = b + "Z";
+      Assert.equals(100, a.length);
+      Assert.equals(a + "XY", c);
+      Assert.equals(a + "XZ", d);
+      Assert.equals(b, c.substr(0,101));
+      Assert.isTrue(a < b);
+      Assert.isTrue(b < c);
+      Assert.equals(100, haxe.io.Bytes.ofString(a).length);
+      Assert.equals("a", a.charAt(99));
+      Assert.isTrue(a.charAt(100)=="");
+      Assert.isTrue(untyped __cpp__("{0}.raw_ptr()[{0}.length]==0", a));
+      Assert.isTrue(untyped __cpp__("{0}.raw_ptr()[{0}.length]==0", b));
+
+      var w = b + "é";
+      var w2 = w + "😀";
+      Assert.equals(b + "é😀", w2);
+      Assert.equals(a + "Xé", w);
+      Assert.equals(b + "é!", w + "!");
+   }
+
    function testSqlite()
    {
       log("Test sqlite");
@@ -209,6 +414,86 @@ class Test extends utest.Test
       cnx.close();
    }
 
+   function testSqliteStatements()
+   {
+      log("Test sqlite prepared statements");
+      var db:Dynamic = untyped __global__._hx_sqlite_connect("hxcpp_stmt.db");
+      untyped __global__._hx_sqlite_request(db, "DROP TABLE IF EXISTS Items");
+      untyped __global__._hx_sqlite_request(db, "CREATE TABLE Items (id INTEGER, name TEXT, price DOUBLE, data BLOB)");
+
+      var insert = "INSERT INTO Items (id,name,price,data) VALUES (?,?,?,?)";
+      var rows = new Array<Dynamic>();
+      for(i in 0...1000)
+         rows.push( ([i, "item" + i, i*0.5, i%2==0 ? null : Bytes.ofString("b"+i).getData()]:Array<Dynamic>) );
+      var stmt:Dynamic = untyped __global__._hx_sqlite_prepare(db, insert);
+      Assert.equals(1000, untyped __global__._hx_sqlite_stmt_execute_batch(stmt, rows));
+      untyped __global__._hx_sqlite_stmt_close(stmt);
+      // Closing twice does nothing, and a closed handle can not be used
+      untyped __global__._hx_sqlite_stmt_close(stmt);
+      Assert.raises(() -> untyped __global__._hx_sqlite_stmt_bind_int(stmt, 1, 0));
+
+      // Same sql comes back from the cache, under a fresh handle
+      var again:Dynamic = untyped __global__._hx_sqlite_prepare(db, insert);
+      var other:Dynamic = untyped __global__._hx_sqlite_prepare(db, insert);
+      Assert.isFalse(again==stmt);
+      Assert.isFalse(again==other);
+      untyped __global__._hx_sqlite_stmt_close(other);
+      Assert.raises(() -> untyped __global__._hx_sqlite_stmt_bind_int(stmt, 1, 0));
+      untyped __global__._hx_sqlite_stmt_bind_int(again, 1, 1000);
+      untyped __global__._hx_sqlite_stmt_bind_string(again, 2, "Grüße");
+      untyped __global__._hx_sqlite_stmt_bind_float(again, 3, 1.25);
+      untyped __global__._hx_sqlite_stmt_bind_null(again, 4);
+      Assert.isNull(untyped __global__._hx_sqlite_stmt_step(again));
+      Assert.equals(1, untyped __global__._hx_sqlite_stmt_changes(again));
+      untyped __global__._hx_sqlite_stmt_close(again);
+
+      var select:Dynamic = untyped __global__._hx_sqlite_prepare(db, "SELECT name, price FROM Items WHERE id=?");
+      for(id in [7, 1000])
+      {
+         untyped __global__._hx_sqlite_stmt_reset(select);
+         untyped __global__._hx_sqlite_stmt_bind_int(select, 1, id);
+         var row:Dynamic = untyped __global__._hx_sqlite_stmt_step(select);
+         Assert.equals(id==7 ? "item7" : "Grüße", row.name);
+         Assert.equals(id==7 ? 3.5 : 1.25, row.price);
+         Assert.isNull(untyped __global__._hx_sqlite_stmt_step(select));
+      }
+      untyped __global__._hx_sqlite_stmt_close(select);
+
+      // Bulk fetch into reused column arrays
+      var ids = new Array<Int>();
+      var names = new Array<String>();
+      var prices = new Array<Float>();
+      var data = new Array<Dynamic>();
+      var columns:Array<Dynamic> = [ids, names, prices, data];
+      var result:Dynamic = untyped __global__._hx_sqlite_request(db, "SELECT id, name, price, data FROM Items ORDER BY id");
+      var total = 0;
+      while(true)
+      {
+         var n:Int = untyped __global__._hx_sqlite_result_fetch_columns(result, columns, 300);
+         if (n==0)
+            break;
+         Assert.equals(n, ids.length);
+         Assert.equals(total, ids[0]);
+         Assert.equals("item" + (total+1), names[1]);
+         Assert.equals((total+1)*0.5, prices[1]);
+         Assert.isNull(data[0]);
+         Assert.notNull(data[1]);
+         total += n;
+      }
+      Assert.equals(1001, total);
+
+      var row = new Array<Dynamic>();
+      result = untyped __global__._hx_sqlite_request(db, "SELECT id, name FROM Items WHERE id<2 ORDER BY id");
+      Assert.isTrue(untyped __global__._hx_sqlite_result_fetch_row(result, row));
+      Assert.equals(0, row[0]);
+      Assert.equals("item0", row[1]);
+      Assert.isTrue(untyped __global__._hx_sqlite_result_fetch_row(result, row));
+      Assert.equals(1, row[0]);
+      Assert.isFalse(untyped __global__._hx_sqlite_result_fetch_row(result, row));
+
+      untyped __global__._hx_sqlite_close(db);
+   }
+
 
    function testMysql()
    {
@@ -243,6 +528,227 @@ class Test extends utest.Test
       }
    }
 
+   static function mysqlPacket(out:haxe.io.Output, seq:Int, data:Bytes)
+   {
+      out.writeUInt24(data.length);
+      out.writeByte(seq);
+      out.write(data);
+   }
+
+   static function mysqlLenStr(buf:haxe.io.BytesBuffer, s:String)
+   {
+      buf.addByte(s.length);
+      buf.addString(s);
+   }
+
+   static function mysqlColumn(name:String, type:Int)
+   {
+      var col = new haxe.io.BytesBuffer();
+      for(s in ["def","db","t","t",name,name])
+         mysqlLenStr(col,s);
+      col.addByte(0x0c);
+      col.addByte(0x21); col.addByte(0);
+      col.addInt32(11);
+      col.addByte(type);
+      col.addByte(0); col.addByte(0);
+      col.addByte(0);
+      col.addByte(0); col.addByte(0);
+      return col.getBytes();
+   }
+
+   // Speaks just enough of the wire protocol to serve "SELECT <n>" as a 2 column result set,
+   //  and prepared statements that echo an Int and a String parameter as a row
+   static function fakeMysqlServer(server:Socket)
+   {
+      var sock = server.accept();
+      var input = sock.input;
+      var out = sock.output;
+      var hs = new haxe.io.BytesBuffer();
+      hs.addByte(10);
+      hs.addString("5.7.0"); hs.addByte(0);
+      hs.addInt32(1);
+      hs.addString("abcdefgh"); hs.addByte(0);
+      hs.addByte(0x00); hs.addByte(0x82);
+      hs.addByte(33);
+      hs.addByte(2); hs.addByte(0);
+      hs.addByte(0); hs.addByte(0);
+      hs.addByte(21);
+      for(i in 0...10) hs.addByte(0);
+      hs.addString("ijklmnopqrst"); hs.addByte(0);
+      mysqlPacket(out, 0, hs.getBytes());
+      var okBytes = Bytes.ofHex("00000002000000");
+      var eofBytes = Bytes.ofHex("fe00000200");
+
+      var readPacket = function() {
+         var len = input.readUInt24();
+         input.readByte();
+         return input.read(len);
+      }
+      readPacket();
+      mysqlPacket(out, 2, okBytes);
+      while(true)
+      {
+         var q = readPacket();
+         var command = q.get(0);
+         if (command==0x01) // COM_QUIT
+            break;
+         if (command==0x19) // COM_STMT_CLOSE has no answer
+            continue;
+         if (command==0x16) // COM_STMT_PREPARE
+         {
+            var seq = 1;
+            mysqlPacket(out, seq++, Bytes.ofHex("000100000002000200000000"));
+            // parameters, then columns
+            for(def in 0...2)
+            {
+               for(i in 0...2)
+                  mysqlPacket(out, seq++, mysqlColumn("?",253));
+               mysqlPacket(out, seq++, eofBytes);
+            }
+         }
+         else if (command==0x17) // COM_STMT_EXECUTE
+         {
+            // command, statement id, flags, iteration count
+            var pos = 10;
+            var nulls = q.get(pos++);
+            if (q.get(pos++)==1)
+               pos += 4; // types
+            var i = q.getInt32(pos);
+            pos += 4;
+            var s = (nulls & 2)!=0 ? null : q.getString(pos+1, q.get(pos));
+
+            var seq = 1;
+            mysqlPacket(out, seq++, Bytes.ofHex("02"));
+            mysqlPacket(out, seq++, mysqlColumn("i",3));
+            mysqlPacket(out, seq++, mysqlColumn("s",253));
+            mysqlPacket(out, seq++, eofBytes);
+            var row = new haxe.io.BytesBuffer();
+            row.addByte(0);
+            row.addByte(s==null ? 1<<3 : 0);
+            row.addInt32(i);
+            if (s!=null)
+               mysqlLenStr(row, s);
+            mysqlPacket(out, seq++, row.getBytes());
+            mysqlPacket(out, seq++, eofBytes);
+         }
+         else if (StringTools.startsWith(q.getString(1, q.length-1),"SELECT"))
+         {
+            var rows = Std.parseInt(q.getString(8, q.length-8));
+            var seq = 1;
+            mysqlPacket(out, seq++, Bytes.ofHex("02"));
+            mysqlPacket(out, seq++, mysqlColumn("id",3));
+            mysqlPacket(out, seq++, mysqlColumn("name",253));
+            mysqlPacket(out, seq++, eofBytes);
+            for(i in 0...rows)
+            {
+               var row = new haxe.io.BytesBuffer();
+               mysqlLenStr(row, Std.string(i));
+               if (i%3==2)
+                  row.addByte(251);
+               else
+                  mysqlLenStr(row, "row" + i);
+               mysqlPacket(out, seq++, row.getBytes());
+            }
+            mysqlPacket(out, seq++, eofBytes);
+         }
+         else
+            mysqlPacket(out, 1, Bytes.ofHex("00030002000000"));
+         out.flush();
+      }
+      sock.close();
+   }
+
+   function testMysqlStreaming()
+   {
+      log("Test mysql streaming");
+      var host = new Host("127.0.0.1");
+      var server = new Socket();
+      server.bind(host,0xccce);
+      server.listen(1);
+      var done = new Deque<Bool>();
+      Thread.create(function() {
+         fakeMysqlServer(server);
+         done.add(true);
+      });
+
+      var cnx:Dynamic = untyped __global__._hx_mysql_connect({ host:"127.0.0.1", port:0xccce, user:"u", pass:"", socket:null });
+
+      // Only read the first few rows of a large result
+      var r:Dynamic = untyped __global__._hx_mysql_request_stream(cnx,"SELECT 1000");
+      var names = new Array<String>();
+      for(i in 0...5)
+      {
+         var row:Dynamic = untyped __global__._hx_mysql_result_next(r);
+         Assert.equals(i, row.id);
+         names.push(row.name);
+      }
+      Assert.equals("row0,row1,null,row3,row4", names.join(","));
+
+      // The rest of the stream is skipped before the next command
+      Assert.equals(3, untyped __global__._hx_mysql_request(cnx,"UPDATE x"));
+
+      var r:Dynamic = untyped __global__._hx_mysql_request_stream(cnx,"SELECT 7");
+      var row = new Array<Dynamic>();
+      var count = 0;
+      while(untyped __global__._hx_mysql_result_fetch_row(r,row))
+         count++;
+      Assert.equals(7, count);
+      Assert.equals(6, row[0]);
+      Assert.equals("row6", row[1]);
+
+      untyped __global__._hx_mysql_close(cnx);
+      done.pop(true);
+      server.close();
+   }
+
+   function testMysqlStatements()
+   {
+      log("Test mysql statements");
+      var host = new Host("127.0.0.1");
+      var server = new Socket();
+      server.bind(host,0xcccf);
+      server.listen(1);
+      var done = new Deque<Bool>();
+      Thread.create(function() {
+         fakeMysqlServer(server);
+         done.add(true);
+      });
+
+      var cnx:Dynamic = untyped __global__._hx_mysql_connect({ host:"127.0.0.1", port:0xcccf, user:"u", pass:"", socket:null });
+
+      var stmt:Dynamic = untyped __global__._hx_mysql_prepare(cnx,"SELECT ?,?");
+      var r:Dynamic = untyped __global__._hx_mysql_stmt_execute(stmt,([7,"seven"]:Array<Dynamic>));
+      var row:Dynamic = untyped __global__._hx_mysql_result_next(r);
+      Assert.equals(7, row.i);
+      Assert.equals("seven", row.s);
+      Assert.isNull(untyped __global__._hx_mysql_result_next(r));
+
+      var r:Dynamic = untyped __global__._hx_mysql_stmt_execute(stmt,([-8,null]:Array<Dynamic>));
+      var values = new Array<Dynamic>();
+      Assert.isTrue(untyped __global__._hx_mysql_result_fetch_row(r,values));
+      Assert.equals(-8, values[0]);
+      Assert.isNull(values[1]);
+
+      Assert.equals(0, untyped __global__._hx_mysql_stmt_execute_batch(stmt,
+            ([ [1,"a"], [2,"b"] ]:Array<Dynamic>) ));
+
+      var failed = false;
+      try {
+         untyped __global__._hx_mysql_stmt_execute(stmt,([1]:Array<Dynamic>));
+      } catch(e:Dynamic) {
+         failed = true;
+      }
+      Assert.isTrue(failed, "wrong parameter count");
+
+      // The close is sent ahead of the next command, which still gets its own answer
+      untyped __global__._hx_mysql_stmt_close(stmt);
+      Assert.equals(3, untyped __global__._hx_mysql_request(cnx,"UPDATE x"));
+
+      untyped __global__._hx_mysql_close(cnx);
+      done.pop(true);
+      server.close();
+   }
+
    function testRandom()
    {
       log("Test Random");
@@ -502,6 +1008,47 @@ class Test extends utest.Test
    }
 
 
+   function testPoller()
+   {
+      log("Test poller");
+
+      var poller = SocketPoller.create();
+      var ready = new Array<Dynamic>();
+      var events = new Array<Int>();
+      Assert.equals(0, SocketPoller.wait(poller, ready, events, 0.01));
+
+      var host = new Host("localhost");
+      var server = new Socket();
+      server.bind(host,0xcccd);
+      server.listen(1);
+      SocketPoller.add(poller, server, 1);
+
+      var client = new Socket();
+      client.connect(host,0xcccd);
+      Assert.equals(1, SocketPoller.wait(poller, ready, events, 1.0));
+      Assert.equals(server, ready[0]);
+      Assert.equals(1, events[0] & 1);
+
+      var connected = server.accept();
+      SocketPoller.add(poller, connected, 1);
+      SocketPoller.modify(poller, server, 0);
+      client.output.writeString("x");
+      client.output.flush();
+      Assert.equals(1, SocketPoller.wait(poller, ready, events, 1.0));
+      Assert.equals(connected, ready[0]);
+      Assert.equals(1, ready.length);
+
+      SocketPoller.remove(poller, connected);
+      SocketPoller.remove(poller, server);
+      Assert.equals(0, SocketPoller.wait(poller, ready, events, 0.01));
+      Assert.equals(0, ready.length);
+
+      SocketPoller.close(poller);
+      connected.close();
+      client.close();
+      server.close();
+   }
+
    function testUdpSocket()
    {
       log("Test UdpSocket");
@@ -695,6 +1242,59 @@ class Test extends utest.Test
       Assert.equals(1, a);
    }
 
+   function testDequeOrder()
+   {
+      log("Test deque order");
+
+      var q = new Deque<Int>();
+      Assert.equals(null, q.pop(false));
+
+      // More than fits in the lock-free ring
+      for(i in 0...1000)
+         q.add(i);
+      q.push(-1);
+      for(i in 0...1000)
+         q.add(1000+i);
+
+      Assert.equals(-1, q.pop(false));
+      var ordered = true;
+      for(i in 0...2000)
+         if (q.pop(false)!=i)
+            ordered = false;
+      Assert.isTrue(ordered);
+      Assert.equals(null, q.pop(false));
+
+      // Several producers and consumers
+      var done = new Deque<Int>();
+      var producers = 4;
+      var count = 10000;
+      for(p in 0...producers)
+         Thread.create(function() {
+            for(i in 0...count)
+               q.add(1);
+            done.add(0);
+         });
+      for(c in 0...2)
+         Thread.create(function() {
+            var total = 0;
+            while(true)
+            {
+               var value = q.pop(true);
+               if (value==0)
+                  break;
+               total += value;
+            }
+            done.add(total);
+         });
+
+      for(p in 0...producers)
+         done.pop(true);
+      q.add(0);
+      q.add(0);
+      var total = done.pop(true) + done.pop(true);
+      Assert.equals(producers*count, total);
+   }
+
    function testFloatReads()
    {
       log("Test float bytes");